@@ -0,0 +1,107 @@
+// Attach latency benchmark: a workload process with many idle threads is
+// started, filetrace attaches to it with --pid, traces for one second and
+// detaches. Reports the seize latency and total attach time filetrace
+// logs, and checks that the workload survives the detach.
+//
+// Usage: bench_attach [threads] [filetrace-binary]
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_utils.hpp"
+#include "process_attach.hpp"
+
+// Start the threads, signal readiness through the pipe and idle until killed
+static int run_workload(int threads, int ready_fd) {
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back([]() {
+            for (;;) {
+                pause();
+            }
+        });
+    }
+    char ready = 1;
+    if (write(ready_fd, &ready, 1) != 1) {
+        return 1;
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 3 && std::strcmp(argv[1], "--workload") == 0) {
+        return run_workload(std::atoi(argv[2]), std::atoi(argv[3]));
+    }
+
+    int threads = argc > 1 ? std::atoi(argv[1]) : 1000;
+    std::string filetrace = argc > 2 ? argv[2] : FILETRACE_BINARY;
+    const std::string html = "/tmp/bench_attach.html";
+    const std::string log_path = "/tmp/bench_attach.log";
+
+    int ready_pipe[2];
+    if (pipe(ready_pipe) == -1) {
+        std::cerr << "pipe failed: " << strerror(errno) << std::endl;
+        return 1;
+    }
+    pid_t workload = fork();
+    if (workload == 0) {
+        close(ready_pipe[0]);
+        std::string self = bench_utils::self_path();
+        std::string threads_arg = std::to_string(threads);
+        std::string fd_arg = std::to_string(ready_pipe[1]);
+        execl(self.c_str(), self.c_str(), "--workload", threads_arg.c_str(), fd_arg.c_str(), nullptr);
+        _exit(127);
+    }
+    close(ready_pipe[1]);
+    char ready;
+    if (read(ready_pipe[0], &ready, 1) != 1) {
+        std::cerr << "workload failed to start" << std::endl;
+        return 1;
+    }
+
+    bench_utils::RunResult traced = bench_utils::run_command(
+        {filetrace, "-a", "-o", html, "-p", std::to_string(workload), "--duration", "1"}, log_path);
+
+    // filetrace logs "Attached to N tasks in P processes in X ms (seize
+    // latency: mean Y us, max Z us)"
+    std::ifstream log(log_path);
+    std::string line, attach_line;
+    while (std::getline(log, line)) {
+        auto pos = line.find("Attached to ");
+        if (pos != std::string::npos) {
+            attach_line = line.substr(pos);
+        }
+    }
+
+    size_t tasks_after = process_attach::list_tasks(workload).size();
+    bool alive = kill(workload, 0) == 0;
+    kill(workload, SIGKILL);
+    waitpid(workload, nullptr, 0);
+
+    std::cout << "Workload: 1 process with " << threads + 1 << " threads" << std::endl;
+    std::cout << "  " << (attach_line.empty() ? "no attach statistics logged" : attach_line) << std::endl;
+    std::cout << "  session wall:    " << traced.seconds * 1000.0 << " ms (1 s traced)" << std::endl;
+    std::cout << "  after detach:    " << (alive ? "running" : "gone") << ", "
+              << tasks_after << " threads" << std::endl;
+
+    if (traced.exit_code != 0 || attach_line.empty() || !alive ||
+        tasks_after != static_cast<size_t>(threads + 1)) {
+        std::cout << "FAILED: attach session did not leave the workload intact" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+// Compares the ptrace, preload, seccomp-notify, fanotify and eBPF backends on a local compile workload:
+// a handful of small C++ translation units including standard headers are
+// compiled one after another, so the compiler opens hundreds of headers.
+// The fanotify backend needs CAP_SYS_ADMIN, the eBPF backend CAP_BPF and
+// CAP_PERFMON.
+//
+// Usage: bench_backends [units] [filetrace-binary]
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_utils.hpp"
+
+using bench_utils::RunResult;
+
+static const char* const unit_source =
+    "#include <map>\n"
+    "#include <string>\n"
+    "#include <vector>\n"
+    "#include <algorithm>\n"
+    "#include <iostream>\n"
+    "int unit_function(int n) {\n"
+    "    std::map<std::string, std::vector<int>> m;\n"
+    "    for (int i = 0; i < n; i++) m[std::to_string(i % 7)].push_back(i);\n"
+    "    int total = 0;\n"
+    "    for (auto& entry : m) total += *std::max_element(entry.second.begin(), entry.second.end());\n"
+    "    return total;\n"
+    "}\n";
+
+// Compile each unit with the system C++ compiler in its own process
+static int run_workload(const std::string& dir, int units) {
+    for (int i = 0; i < units; i++) {
+        std::string source = dir + "/unit_" + std::to_string(i) + ".cpp";
+        std::string object = dir + "/unit_" + std::to_string(i) + ".o";
+        pid_t child = fork();
+        if (child == 0) {
+            execlp("c++", "c++", "-O1", "-c", source.c_str(), "-o", object.c_str(), nullptr);
+            _exit(127);
+        }
+        int status;
+        waitpid(child, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void print_row(const std::string& mode, const RunResult& result, double baseline) {
+    std::cout << std::left << std::setw(22) << mode
+              << std::right << std::setw(12) << std::fixed << std::setprecision(1) << result.seconds * 1000.0
+              << std::setw(12) << std::setprecision(2) << result.seconds / baseline << "x"
+              << std::setw(12) << result.stops
+              << std::setw(12) << result.operations
+              << (result.exit_code != 0 ? "  (failed, see log)" : "") << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 3 && std::strcmp(argv[1], "--workload") == 0) {
+        return run_workload(argv[2], std::atoi(argv[3]));
+    }
+
+    int units = argc > 1 ? std::atoi(argv[1]) : 8;
+    std::string filetrace = argc > 2 ? argv[2] : FILETRACE_BINARY;
+
+    char dir_template[] = "/tmp/bench_backends_XXXXXX";
+    if (mkdtemp(dir_template) == nullptr) {
+        std::cerr << "mkdtemp failed" << std::endl;
+        return 1;
+    }
+    std::string dir = dir_template;
+    for (int i = 0; i < units; i++) {
+        std::ofstream(dir + "/unit_" + std::to_string(i) + ".cpp") << unit_source;
+    }
+
+    std::vector<std::string> workload = {bench_utils::self_path(), "--workload", dir, std::to_string(units)};
+    const std::string html = dir + "/trace.html";
+    const std::string log_path = dir + "/trace.log";
+
+    RunResult native = bench_utils::run_command(workload, log_path);
+    RunResult ptrace_mode = bench_utils::run_command(
+        bench_utils::traced_command(filetrace, {}, workload, html), log_path);
+    RunResult seccomp_mode = bench_utils::run_command(
+        bench_utils::traced_command(filetrace, {"--seccomp"}, workload, html), log_path);
+    RunResult preload_mode = bench_utils::run_command(
+        bench_utils::traced_command(filetrace, {"--backend=preload"}, workload, html), log_path);
+    RunResult notify_mode = bench_utils::run_command(
+        bench_utils::traced_command(filetrace, {"--backend=seccomp-notify"}, workload, html), log_path);
+    RunResult fanotify_mode = bench_utils::run_command(
+        bench_utils::traced_command(filetrace, {"--backend=fanotify"}, workload, html), log_path);
+    RunResult ebpf_mode = bench_utils::run_command(
+        bench_utils::traced_command(filetrace, {"--backend=ebpf"}, workload, html), log_path);
+
+    std::cout << "Workload: " << units << " C++ translation units compiled sequentially" << std::endl;
+    std::cout << std::left << std::setw(22) << "backend"
+              << std::right << std::setw(12) << "wall ms"
+              << std::setw(13) << "overhead"
+              << std::setw(12) << "stops"
+              << std::setw(12) << "operations" << std::endl;
+    print_row("native", native, native.seconds);
+    print_row("ptrace", ptrace_mode, native.seconds);
+    print_row("ptrace + seccomp", seccomp_mode, native.seconds);
+    print_row("preload", preload_mode, native.seconds);
+    print_row("seccomp-notify", notify_mode, native.seconds);
+    print_row("fanotify", fanotify_mode, native.seconds);
+    print_row("ebpf", ebpf_mode, native.seconds);
+
+    std::string cleanup = "rm -rf " + dir;
+    return std::system(cleanup.c_str()) == 0 && native.exit_code == 0 ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+// Compares the word-by-word PTRACE_PEEKDATA path reader with the bulk
+// ProcessMemoryReader on short and long paths in a stopped tracee.
+//
+// Usage: bench_path_read [iterations]
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/ptrace.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "process_memory.hpp"
+
+// Previous reader: one PTRACE_PEEKDATA per word
+static std::string peekdata_read_string(pid_t pid, unsigned long addr) {
+    char buffer[4096];
+    size_t i = 0;
+    union {
+        long val;
+        char chars[sizeof(long)];
+    } data;
+
+    while (i < sizeof(buffer) - sizeof(long)) {
+        errno = 0;
+        data.val = ptrace(PTRACE_PEEKDATA, pid, addr + i, nullptr);
+        if (errno != 0) {
+            break;
+        }
+        for (size_t j = 0; j < sizeof(long) && i + j < sizeof(buffer) - 1; j++) {
+            buffer[i + j] = data.chars[j];
+            if (data.chars[j] == '\0') {
+                return std::string(buffer);
+            }
+        }
+        i += sizeof(long);
+    }
+    buffer[i] = '\0';
+    return std::string(buffer);
+}
+
+template<typename Fn>
+static double time_per_read_ns(long iterations, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+int main(int argc, char* argv[]) {
+    long iterations = argc > 1 ? std::atol(argv[1]) : 20000;
+
+    std::string short_path = "/usr/include/x86_64-linux-gnu/bits/types/struct_timespec.h";
+    std::string long_path = "/";
+    while (long_path.size() < 3000) {
+        long_path += "very_deeply_nested_build_directory/";
+    }
+    long_path += "generated.h";
+
+    pid_t child = fork();
+    if (child == 0) {
+        ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+        raise(SIGSTOP);
+        _exit(0);
+    }
+    int status;
+    waitpid(child, &status, 0);
+
+    process_memory::ProcessMemoryReader vm_reader(true);
+    process_memory::ProcessMemoryReader mem_reader(false);
+
+    std::cout << std::left << std::setw(12) << "path"
+              << std::right << std::setw(8) << "bytes"
+              << std::setw(16) << "peekdata ns"
+              << std::setw(16) << "vm_readv ns"
+              << std::setw(16) << "proc/mem ns" << std::endl;
+
+    for (const auto* path : {&short_path, &long_path}) {
+        unsigned long addr = reinterpret_cast<unsigned long>(path->c_str());
+        std::string out;
+        double peek = time_per_read_ns(iterations, [&]() { out = peekdata_read_string(child, addr); });
+        double vm = time_per_read_ns(iterations, [&]() { vm_reader.read_string(child, addr, out); });
+        double mem = time_per_read_ns(iterations, [&]() { mem_reader.read_string(child, addr, out); });
+
+        std::cout << std::left << std::setw(12) << (path == &short_path ? "short" : "long")
+                  << std::right << std::setw(8) << path->size()
+                  << std::fixed << std::setprecision(0)
+                  << std::setw(16) << peek
+                  << std::setw(16) << vm
+                  << std::setw(16) << mem << std::endl;
+    }
+
+    kill(child, SIGKILL);
+    waitpid(child, nullptr, 0);
+    return 0;
+}
@@ -0,0 +1,94 @@
+// Stress test for thread/process creation under the tracer: hundreds of
+// threads are spawned concurrently, each opening a file and forking once
+// per batch. Reports tracer throughput and checks that no open was lost.
+//
+// Usage: bench_thread_spawn [threads] [filetrace-binary]
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_utils.hpp"
+
+// Spawn all threads at once, release them together and have each open a
+// file; every tenth thread also forks a short-lived child that opens one
+static int run_workload(int threads) {
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back([i, &go]() {
+            while (!go) {
+                std::this_thread::yield();
+            }
+            int fd = open("/etc/hostname", O_RDONLY);
+            if (fd != -1) {
+                close(fd);
+            }
+            if (i % 10 == 0) {
+                pid_t child = fork();
+                if (child == 0) {
+                    int child_fd = open("/etc/hostname", O_RDONLY);
+                    if (child_fd != -1) {
+                        close(child_fd);
+                    }
+                    _exit(0);
+                }
+                waitpid(child, nullptr, 0);
+            }
+        });
+    }
+    go = true;
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 2 && std::strcmp(argv[1], "--workload") == 0) {
+        return run_workload(std::atoi(argv[2]));
+    }
+
+    int threads = argc > 1 ? std::atoi(argv[1]) : 400;
+    std::string filetrace = argc > 2 ? argv[2] : FILETRACE_BINARY;
+    std::vector<std::string> workload = {bench_utils::self_path(), "--workload", std::to_string(threads)};
+    const std::string html = "/tmp/bench_thread_spawn.html";
+    const std::string log_path = "/tmp/bench_thread_spawn.log";
+
+    bench_utils::RunResult native = bench_utils::run_command(workload, log_path);
+    bench_utils::RunResult traced = bench_utils::run_command(
+        bench_utils::traced_command(filetrace, {}, workload, html), log_path);
+
+    // One open per thread plus one per forked child
+    unsigned long long expected_opens = threads + (threads + 9) / 10;
+    unsigned long long tasks = threads + (threads + 9) / 10;
+
+    std::cout << "Workload: " << threads << " concurrent threads, "
+              << (threads + 9) / 10 << " forked children" << std::endl;
+    std::cout << std::fixed << std::setprecision(1)
+              << "  native wall:     " << native.seconds * 1000.0 << " ms" << std::endl
+              << "  traced wall:     " << traced.seconds * 1000.0 << " ms ("
+              << std::setprecision(2) << traced.seconds / native.seconds << "x)" << std::endl
+              << std::setprecision(0)
+              << "  tasks/s traced:  " << tasks / traced.seconds << std::endl
+              << "  stops:           " << traced.stops << " ("
+              << (traced.seconds > 0 ? traced.stops / traced.seconds : 0) << " stops/s)" << std::endl
+              << "  operations:      " << traced.operations << " recorded (at least "
+              << expected_opens << " expected)" << std::endl;
+
+    if (traced.exit_code != 0 || traced.operations < expected_opens) {
+        std::cout << "FAILED: tracer lost events or exited with " << traced.exit_code << std::endl;
+        return 1;
+    }
+    return 0;
+}
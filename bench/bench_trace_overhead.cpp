@@ -0,0 +1,83 @@
+// Compares tracing overhead of the PTRACE_SYSCALL loop against the seccomp
+// pre-filter mode and the seccomp-notify backend on a syscall-heavy workload.
+//
+// Usage: bench_trace_overhead [iterations] [filetrace-binary]
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_utils.hpp"
+
+using bench_utils::RunResult;
+
+// Syscall-heavy workload: mostly reads, with an open every 100 iterations
+static int run_workload(long iterations) {
+    int zero_fd = open("/dev/zero", O_RDONLY);
+    if (zero_fd == -1) {
+        return 1;
+    }
+    char byte;
+    for (long i = 0; i < iterations; i++) {
+        if (read(zero_fd, &byte, 1) != 1) {
+            return 1;
+        }
+        if (i % 100 == 0) {
+            int fd = open("/etc/hostname", O_RDONLY);
+            if (fd != -1) {
+                close(fd);
+            }
+        }
+    }
+    close(zero_fd);
+    return 0;
+}
+
+static void print_row(const std::string& mode, const RunResult& result, double baseline) {
+    std::cout << std::left << std::setw(24) << mode
+              << std::right << std::setw(12) << std::fixed << std::setprecision(1) << result.seconds * 1000.0
+              << std::setw(12) << std::setprecision(2) << result.seconds / baseline << "x"
+              << std::setw(12) << result.stops
+              << std::setw(14) << std::setprecision(0)
+              << (result.seconds > 0 ? result.stops / result.seconds : 0) << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 2 && std::strcmp(argv[1], "--workload") == 0) {
+        return run_workload(std::atol(argv[2]));
+    }
+
+    long iterations = argc > 1 ? std::atol(argv[1]) : 200000;
+    std::string filetrace = argc > 2 ? argv[2] : FILETRACE_BINARY;
+    std::vector<std::string> workload = {bench_utils::self_path(), "--workload", std::to_string(iterations)};
+    const std::string html = "/tmp/bench_trace_overhead.html";
+    std::vector<std::string> traced = bench_utils::traced_command(filetrace, {}, workload, html);
+    std::vector<std::string> seccomp = bench_utils::traced_command(filetrace, {"--seccomp"}, workload, html);
+    std::vector<std::string> notify =
+        bench_utils::traced_command(filetrace, {"--backend=seccomp-notify"}, workload, html);
+
+    const std::string log_path = "/tmp/bench_trace_overhead.log";
+    RunResult native = bench_utils::run_command(workload, log_path);
+    RunResult syscall_mode = bench_utils::run_command(traced, log_path);
+    RunResult seccomp_mode = bench_utils::run_command(seccomp, log_path);
+    RunResult notify_mode = bench_utils::run_command(notify, log_path);
+
+    std::cout << "Workload: " << iterations << " read() calls, "
+              << iterations / 100 << " open() calls" << std::endl;
+    std::cout << std::left << std::setw(24) << "mode"
+              << std::right << std::setw(12) << "wall ms"
+              << std::setw(13) << "overhead"
+              << std::setw(12) << "stops"
+              << std::setw(14) << "stops/s" << std::endl;
+    print_row("native", native, native.seconds);
+    print_row("PTRACE_SYSCALL", syscall_mode, native.seconds);
+    print_row("seccomp pre-filter", seccomp_mode, native.seconds);
+    print_row("seccomp-notify", notify_mode, native.seconds);
+    return 0;
+}
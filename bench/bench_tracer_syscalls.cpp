@@ -0,0 +1,147 @@
+// Counts the syscalls filetrace itself makes per tracee stop. The benchmark
+// traces the filetrace process (not its tracees) and tallies each syscall
+// entry by number, then divides by the stop count filetrace reports.
+//
+// Usage: bench_tracer_syscalls [iterations] [filetrace-binary...]
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "bench_utils.hpp"
+
+// Syscall-heavy workload: mostly reads, with an open every 100 iterations
+static int run_workload(long iterations) {
+    int zero_fd = open("/dev/zero", O_RDONLY);
+    char byte;
+    for (long i = 0; i < iterations; i++) {
+        if (read(zero_fd, &byte, 1) != 1) {
+            return 1;
+        }
+        if (i % 100 == 0) {
+            int fd = open("/etc/hostname", O_RDONLY);
+            if (fd != -1) {
+                close(fd);
+            }
+        }
+    }
+    close(zero_fd);
+    return 0;
+}
+
+// Run command under our own ptrace and count its syscalls by number
+static std::map<long, unsigned long long> count_syscalls(const std::vector<std::string>& command,
+                                                         const std::string& log_path) {
+    std::map<long, unsigned long long> counts;
+    pid_t child = fork();
+    if (child == 0) {
+        int log_fd = open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        dup2(log_fd, STDOUT_FILENO);
+        dup2(log_fd, STDERR_FILENO);
+        std::vector<char*> args;
+        for (const auto& arg : command) {
+            args.push_back(const_cast<char*>(arg.c_str()));
+        }
+        args.push_back(nullptr);
+        ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+        execv(args[0], args.data());
+        _exit(127);
+    }
+
+    int status;
+    waitpid(child, &status, 0);
+    ptrace(PTRACE_SETOPTIONS, child, 0, PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL);
+    ptrace(PTRACE_SYSCALL, child, nullptr, nullptr);
+    while (waitpid(child, &status, 0) == child && WIFSTOPPED(status)) {
+        int sig = 0;
+        if (WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+            struct __ptrace_syscall_info info;
+            if (ptrace(PTRACE_GET_SYSCALL_INFO, child, sizeof(info), &info) > 0 &&
+                info.op == PTRACE_SYSCALL_INFO_ENTRY) {
+                counts[static_cast<long>(info.entry.nr)]++;
+            }
+        } else if (WSTOPSIG(status) != SIGTRAP) {
+            sig = WSTOPSIG(status);
+        }
+        ptrace(PTRACE_SYSCALL, child, nullptr, reinterpret_cast<void*>(static_cast<long>(sig)));
+    }
+    return counts;
+}
+
+static unsigned long long tracer_stops(const std::string& log_path) {
+    std::ifstream log(log_path);
+    std::string line;
+    const std::string marker = "Tracer statistics: ";
+    unsigned long long stops = 0;
+    while (std::getline(log, line)) {
+        auto pos = line.find(marker);
+        if (pos != std::string::npos) {
+            stops = std::strtoull(line.c_str() + pos + marker.size(), nullptr, 10);
+        }
+    }
+    return stops;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 2 && std::strcmp(argv[1], "--workload") == 0) {
+        return run_workload(std::atol(argv[2]));
+    }
+
+    long iterations = argc > 1 ? std::atol(argv[1]) : 20000;
+    std::vector<std::string> binaries;
+    for (int i = 2; i < argc; i++) {
+        binaries.push_back(argv[i]);
+    }
+    if (binaries.empty()) {
+        binaries.push_back(FILETRACE_BINARY);
+    }
+
+    std::vector<std::string> workload = {bench_utils::self_path(), "--workload", std::to_string(iterations)};
+    const std::string log_path = "/tmp/bench_tracer_syscalls.log";
+
+    std::cout << "Workload: " << iterations << " read() calls, "
+              << iterations / 100 << " open() calls" << std::endl;
+    std::cout << std::left << std::setw(40) << "filetrace"
+              << std::right << std::setw(10) << "stops"
+              << std::setw(10) << "ptrace"
+              << std::setw(10) << "wait4"
+              << std::setw(10) << "kill"
+              << std::setw(10) << "other" << "  (syscalls per stop)" << std::endl;
+
+    for (const auto& binary : binaries) {
+        auto counts = count_syscalls(
+            bench_utils::traced_command(binary, {}, workload, "/tmp/bench_tracer_syscalls.html"), log_path);
+        unsigned long long stops = tracer_stops(log_path);
+        unsigned long long ptrace_calls = counts[SYS_ptrace];
+        unsigned long long wait_calls = counts[SYS_wait4];
+        unsigned long long kill_calls = counts[SYS_kill];
+        unsigned long long total = 0;
+        for (const auto& entry : counts) {
+            total += entry.second;
+        }
+        unsigned long long other = total - ptrace_calls - wait_calls - kill_calls;
+        double divisor = stops > 0 ? static_cast<double>(stops) : 1.0;
+
+        std::cout << std::left << std::setw(40) << binary
+                  << std::right << std::setw(10) << stops
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(10) << ptrace_calls / divisor
+                  << std::setw(10) << wait_calls / divisor
+                  << std::setw(10) << kill_calls / divisor
+                  << std::setw(10) << other / divisor << std::endl;
+    }
+    return 0;
+}
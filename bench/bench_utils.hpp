@@ -0,0 +1,96 @@
+#ifndef BENCH_UTILS_HPP
+#define BENCH_UTILS_HPP
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifndef FILETRACE_BINARY
+#define FILETRACE_BINARY "filetrace"
+#endif
+
+namespace bench_utils {
+
+struct RunResult {
+    double seconds;
+    int exit_code;
+    unsigned long long stops;       // From filetrace's "Tracer statistics" line
+    unsigned long long operations;  // Recorded file operations
+};
+
+// Path of the running benchmark binary, for re-running itself as a workload
+inline std::string self_path() {
+    char path[4096];
+    ssize_t len = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (len <= 0) {
+        return "";
+    }
+    path[len] = '\0';
+    return std::string(path);
+}
+
+// Run a command with its output captured in log_path, time it and pick up
+// the statistics filetrace reports at the end of a trace
+inline RunResult run_command(const std::vector<std::string>& command, const std::string& log_path) {
+    auto start = std::chrono::steady_clock::now();
+    pid_t child = fork();
+    if (child == 0) {
+        int log_fd = open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        dup2(log_fd, STDOUT_FILENO);
+        dup2(log_fd, STDERR_FILENO);
+        std::vector<char*> args;
+        for (const auto& arg : command) {
+            args.push_back(const_cast<char*>(arg.c_str()));
+        }
+        args.push_back(nullptr);
+        execv(args[0], args.data());
+        _exit(127);
+    }
+    int status;
+    waitpid(child, &status, 0);
+
+    RunResult result;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    result.stops = 0;
+    result.operations = 0;
+
+    std::ifstream log(log_path);
+    std::string line;
+    const std::string stats_marker = "Tracer statistics: ";
+    const std::string ops_marker = "Generating HTML output with ";
+    while (std::getline(log, line)) {
+        auto pos = line.find(stats_marker);
+        if (pos != std::string::npos) {
+            result.stops = std::strtoull(line.c_str() + pos + stats_marker.size(), nullptr, 10);
+        }
+        pos = line.find(ops_marker);
+        if (pos != std::string::npos) {
+            result.operations = std::strtoull(line.c_str() + pos + ops_marker.size(), nullptr, 10);
+        }
+    }
+    return result;
+}
+
+// filetrace invocation tracing command with all files recorded
+inline std::vector<std::string> traced_command(const std::string& filetrace,
+                                               const std::vector<std::string>& extra_args,
+                                               const std::vector<std::string>& command,
+                                               const std::string& output_html) {
+    std::vector<std::string> traced = {filetrace, "-a", "-o", output_html};
+    traced.insert(traced.end(), extra_args.begin(), extra_args.end());
+    traced.push_back("--");
+    traced.insert(traced.end(), command.begin(), command.end());
+    return traced;
+}
+
+} // namespace bench_utils
+
+#endif // BENCH_UTILS_HPP
@@ -7,6 +7,7 @@
 #include <map>
 #include <filesystem>
 #include <sstream>
+#include <cstring>
 #include "path_utils.hpp"
 
 // SVG icons for folder and file
@@ -21,19 +22,29 @@ public:
     int sequence_number;
     pid_t thread_id;
     std::string thread_name;
+    int error;  // errno of a failed open, 0 if the open succeeded
+    std::string operation;  // Syscall that recorded the file, empty for opens
+    // Sampling mode: when the file was first and last seen open or mapped,
+    // in ms since sampling started, and in how many samples
+    double first_seen_ms;
+    double last_seen_ms;
+    unsigned long observations;
     std::map<std::string, std::shared_ptr<DirectoryNode>> children;
 
     DirectoryNode(const std::string& n, const std::string& path, bool file = false)
-        : name(n), full_path(path), is_file(file), sequence_number(-1) {}
+        : name(n), full_path(path), is_file(file), sequence_number(-1), error(0),
+          first_seen_ms(0), last_seen_ms(0), observations(0) {}
 };
 
 class DirectoryTree {
 public:
     DirectoryTree() : root(std::make_shared<DirectoryNode>("/", "/", false)) {}
 
-    void insert_file(const std::string& path, int sequence, pid_t thread_id, const std::string& thread_name) {
-        // Normalize the path first
-        std::string normalized_path = path_utils::normalize_path(path);
+    void insert_file(const std::string& path, int sequence, pid_t thread_id, const std::string& thread_name, int error = 0,
+                     const std::string& operation = "") {
+        // Paths arrive absolute; normalize them lexically so the tree shows
+        // them as the tracee spelled them, symlinks included
+        std::string normalized_path = path_utils::lexical_normalize(path);
         std::filesystem::path fs_path(normalized_path);
         std::shared_ptr<DirectoryNode> current = root;
         
@@ -85,12 +96,38 @@ public:
                 current->sequence_number = sequence;
                 current->thread_id = thread_id;
                 current->thread_name = thread_name;
+                current->error = error;
+                current->operation = operation;
                 std::cerr << "Updated file metadata for: " << comp_str 
                          << " [" << sequence << "]" << std::endl;
             }
         }
     }
 
+    // Attach sampling statistics to a file inserted earlier. Returns false
+    // if the path is not in the tree, e.g. because it was filtered out.
+    bool annotate_observations(const std::string& path, double first_seen_ms, double last_seen_ms,
+                               unsigned long observations) {
+        std::filesystem::path fs_path(path_utils::lexical_normalize(path));
+        std::shared_ptr<DirectoryNode> current = root;
+        for (const auto& component : fs_path) {
+            std::string comp_str = component.string();
+            if (comp_str == "/" || comp_str.empty()) continue;
+            auto it = current->children.find(comp_str);
+            if (it == current->children.end()) {
+                return false;
+            }
+            current = it->second;
+        }
+        if (!current->is_file) {
+            return false;
+        }
+        current->first_seen_ms = first_seen_ms;
+        current->last_seen_ms = last_seen_ms;
+        current->observations = observations;
+        return true;
+    }
+
     void generate_html(std::ostream& out) const {
         out << "<div class='directory-tree'>\n";
         generate_html_node(root, out, 0);
@@ -102,7 +139,8 @@ private:
 
     void generate_html_node(const std::shared_ptr<DirectoryNode>& node, std::ostream& out, int depth) const {
         std::string indent(depth * 2, ' ');
-        out << indent << "<div class='tree-node" << (node->is_file ? " file" : " directory") << "'>\n";
+        out << indent << "<div class='tree-node" << (node->is_file ? " file" : " directory")
+            << (node->error != 0 ? " failed" : "") << "'>\n";
         
         // Output node content
         out << indent << "  <div class='node-content'>\n";
@@ -116,9 +154,21 @@ private:
             if (node->sequence_number > 0) {
                 out << indent << "    <span class='sequence'>[" << node->sequence_number << "]</span>\n";
             }
+            if (!node->operation.empty()) {
+                out << indent << "    <span class='operation-info'>" << node->operation << "</span>\n";
+            }
             if (!node->thread_name.empty()) {
                 out << indent << "    <span class='thread-info'>(Thread: " << node->thread_id << " - " << node->thread_name << ")</span>\n";
             }
+            if (node->error != 0) {
+                out << indent << "    <span class='error-info'>(" << strerror(node->error) << ")</span>\n";
+            }
+            if (node->observations > 0) {
+                out << indent << "    <span class='sample-info'>(seen in " << node->observations
+                    << (node->observations == 1 ? " sample" : " samples") << ", "
+                    << static_cast<long>(node->first_seen_ms) << "-" << static_cast<long>(node->last_seen_ms)
+                    << " ms)</span>\n";
+            }
         }
         out << indent << "  </div>\n";
 
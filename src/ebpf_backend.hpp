@@ -0,0 +1,669 @@
+#ifndef EBPF_BACKEND_HPP
+#define EBPF_BACKEND_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <linux/bpf.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+
+namespace ebpf_backend {
+
+// Event records written by the BPF programs into the ring buffer. Every
+// record starts with the fixed header; OPEN and CHDIR records carry the
+// path after it.
+enum EventType : uint32_t {
+    EVENT_OPEN = 1,    // open/openat entry: value = dirfd, flags = open flags
+    EVENT_CHDIR = 2,   // chdir entry
+    EVENT_FCHDIR = 3,  // fchdir entry: value = fd
+    EVENT_RESULT = 4,  // Exit of any of the above: value = return value
+    EVENT_FORK = 5     // fork/clone of a traced task: value = new task id
+};
+
+struct EventHeader {
+    uint32_t type;
+    uint32_t pid;   // Thread group id
+    uint32_t tid;
+    uint32_t pad;
+    int64_t value;
+    uint64_t flags;
+    char comm[16];
+};
+
+constexpr size_t path_size = PATH_MAX;
+constexpr size_t path_event_size = sizeof(EventHeader) + path_size;
+
+// Tracepoint record offsets, read from the tracefs format files at load
+// time since they differ between kernel versions
+struct TracepointOffsets {
+    int open_filename = -1;
+    int open_flags = -1;
+    int openat_dfd = -1;
+    int openat_filename = -1;
+    int openat_flags = -1;
+    int chdir_filename = -1;
+    int fchdir_fd = -1;
+    int exit_ret = -1;          // Same for every sys_exit_* tracepoint
+    int fork_child_pid = -1;
+    int exec_pid = -1;
+    int exec_old_pid = -1;
+};
+
+// Minimal eBPF assembler: one helper per instruction class in use
+namespace insn {
+
+inline bpf_insn make(uint8_t code, uint8_t dst, uint8_t src, int16_t off, int32_t imm) {
+    bpf_insn result = {};
+    result.code = code;
+    result.dst_reg = dst;
+    result.src_reg = src;
+    result.off = off;
+    result.imm = imm;
+    return result;
+}
+
+inline bpf_insn mov_reg(uint8_t dst, uint8_t src) { return make(BPF_ALU64 | BPF_MOV | BPF_X, dst, src, 0, 0); }
+inline bpf_insn mov_imm(uint8_t dst, int32_t imm) { return make(BPF_ALU64 | BPF_MOV | BPF_K, dst, 0, 0, imm); }
+inline bpf_insn add_imm(uint8_t dst, int32_t imm) { return make(BPF_ALU64 | BPF_ADD | BPF_K, dst, 0, 0, imm); }
+inline bpf_insn rsh_imm(uint8_t dst, int32_t imm) { return make(BPF_ALU64 | BPF_RSH | BPF_K, dst, 0, 0, imm); }
+inline bpf_insn load(uint8_t size, uint8_t dst, uint8_t src, int16_t off) { return make(BPF_LDX | size | BPF_MEM, dst, src, off, 0); }
+inline bpf_insn store(uint8_t size, uint8_t dst, uint8_t src, int16_t off) { return make(BPF_STX | size | BPF_MEM, dst, src, off, 0); }
+inline bpf_insn store_imm(uint8_t size, uint8_t dst, int16_t off, int32_t imm) { return make(BPF_ST | size | BPF_MEM, dst, 0, off, imm); }
+inline bpf_insn jump_if_zero(uint8_t reg, int16_t off) { return make(BPF_JMP | BPF_JEQ | BPF_K, reg, 0, off, 0); }
+inline bpf_insn jump_if_signed_greater(uint8_t reg, int32_t imm, int16_t off) { return make(BPF_JMP | BPF_JSGT | BPF_K, reg, 0, off, imm); }
+inline bpf_insn jump_if_signed_less_equal(uint8_t reg, int32_t imm, int16_t off) { return make(BPF_JMP | BPF_JSLE | BPF_K, reg, 0, off, imm); }
+inline bpf_insn jump_if_negative(uint8_t reg, int16_t off) { return make(BPF_JMP | BPF_JSLT | BPF_K, reg, 0, off, 0); }
+inline bpf_insn atomic_add(uint8_t dst, uint8_t src, int16_t off) { return make(BPF_STX | BPF_DW | BPF_ATOMIC, dst, src, off, BPF_ADD); }
+inline bpf_insn call(int32_t helper) { return make(BPF_JMP | BPF_CALL, 0, 0, 0, helper); }
+inline bpf_insn exit() { return make(BPF_JMP | BPF_EXIT, 0, 0, 0, 0); }
+
+// 64-bit immediate load of a map, two instruction slots
+inline void load_map(std::vector<bpf_insn>& prog, uint8_t dst, int map_fd) {
+    prog.push_back(make(BPF_LD | BPF_DW | BPF_IMM, dst, BPF_PSEUDO_MAP_FD, 0, map_fd));
+    prog.push_back(make(0, 0, 0, 0, 0));
+}
+
+} // namespace insn
+
+// Maps shared by all programs
+struct MapFds {
+    int traced;   // Hash of traced task ids
+    int events;   // Ring buffer
+    int scratch;  // Per-CPU buffer where path events are assembled
+    int dropped;  // Array holding the count of events lost to a full ring
+};
+
+// Programs share a prologue and epilogue. The prologue keeps ctx in r6 and
+// pid_tgid in r7 and returns early unless the current task is traced; the
+// record being written is kept in r8. Jumps to the common exit and to the
+// dropped-event counter are patched once the program is complete.
+class ProgramBuilder {
+public:
+    explicit ProgramBuilder(const MapFds& map_fds) : maps(map_fds) {}
+
+    void filter_traced_process() {
+        prog.push_back(insn::mov_reg(BPF_REG_6, BPF_REG_1));
+        prog.push_back(insn::call(BPF_FUNC_get_current_pid_tgid));
+        prog.push_back(insn::mov_reg(BPF_REG_7, BPF_REG_0));
+        // Keyed by task id rather than thread group id: each task's entry
+        // goes when that task exits, so a thread group stays traced while
+        // any of its threads runs, even after its leader called pthread_exit
+        prog.push_back(insn::store(BPF_W, BPF_REG_10, BPF_REG_0, -4));
+        lookup_traced(-4);
+    }
+
+    // Prologue variant keeping only ctx in r6: returns early unless the
+    // task whose id is the 32-bit tracepoint field at ctx_offset is traced
+    void filter_traced_field(int ctx_offset) {
+        prog.push_back(insn::mov_reg(BPF_REG_6, BPF_REG_1));
+        prog.push_back(insn::load(BPF_W, BPF_REG_1, BPF_REG_6, static_cast<int16_t>(ctx_offset)));
+        prog.push_back(insn::store(BPF_W, BPF_REG_10, BPF_REG_1, -4));
+        lookup_traced(-4);
+    }
+
+    // Reserve a fixed-size record in the ring buffer and fill in its header
+    void reserve_event(uint32_t type, size_t size) {
+        insn::load_map(prog, BPF_REG_1, maps.events);
+        prog.push_back(insn::mov_imm(BPF_REG_2, static_cast<int32_t>(size)));
+        prog.push_back(insn::mov_imm(BPF_REG_3, 0));
+        prog.push_back(insn::call(BPF_FUNC_ringbuf_reserve));
+        jump_to(drop_jumps, insn::jump_if_zero(BPF_REG_0, 0));
+        prog.push_back(insn::mov_reg(BPF_REG_8, BPF_REG_0));
+        fill_header(type);
+    }
+
+    // Start a variable-size record in the per-CPU scratch buffer, so that
+    // only the used part of the path is copied into the ring buffer
+    void begin_scratch_event(uint32_t type) {
+        prog.push_back(insn::store_imm(BPF_W, BPF_REG_10, -8, 0));
+        insn::load_map(prog, BPF_REG_1, maps.scratch);
+        prog.push_back(insn::mov_reg(BPF_REG_2, BPF_REG_10));
+        prog.push_back(insn::add_imm(BPF_REG_2, -8));
+        prog.push_back(insn::call(BPF_FUNC_map_lookup_elem));
+        jump_to(exit_jumps, insn::jump_if_zero(BPF_REG_0, 0));
+        prog.push_back(insn::mov_reg(BPF_REG_8, BPF_REG_0));
+        fill_header(type);
+    }
+
+    // Fill in type, pid, tid and comm of the record in r8
+    void fill_header(uint32_t type) {
+        prog.push_back(insn::store_imm(BPF_W, BPF_REG_8, offsetof(EventHeader, type), static_cast<int32_t>(type)));
+        prog.push_back(insn::store(BPF_W, BPF_REG_8, BPF_REG_7, offsetof(EventHeader, tid)));
+        prog.push_back(insn::mov_reg(BPF_REG_1, BPF_REG_7));
+        prog.push_back(insn::rsh_imm(BPF_REG_1, 32));
+        prog.push_back(insn::store(BPF_W, BPF_REG_8, BPF_REG_1, offsetof(EventHeader, pid)));
+        prog.push_back(insn::store_imm(BPF_W, BPF_REG_8, offsetof(EventHeader, pad), 0));
+        prog.push_back(insn::store_imm(BPF_DW, BPF_REG_8, offsetof(EventHeader, value), 0));
+        prog.push_back(insn::store_imm(BPF_DW, BPF_REG_8, offsetof(EventHeader, flags), 0));
+        prog.push_back(insn::mov_reg(BPF_REG_1, BPF_REG_8));
+        prog.push_back(insn::add_imm(BPF_REG_1, offsetof(EventHeader, comm)));
+        prog.push_back(insn::mov_imm(BPF_REG_2, sizeof(EventHeader::comm)));
+        prog.push_back(insn::call(BPF_FUNC_get_current_comm));
+    }
+
+    // Copy a tracepoint field of the given size into the record
+    void copy_field(uint8_t size, int ctx_offset, int16_t event_offset) {
+        prog.push_back(insn::load(size, BPF_REG_1, BPF_REG_6, static_cast<int16_t>(ctx_offset)));
+        prog.push_back(insn::store(size, BPF_REG_8, BPF_REG_1, event_offset));
+    }
+
+    void store_value(int32_t value, int16_t event_offset) {
+        prog.push_back(insn::store_imm(BPF_DW, BPF_REG_8, event_offset, value));
+    }
+
+    // Copy the user string the tracepoint field points to after the header
+    void copy_user_path(int ctx_offset) {
+        prog.push_back(insn::mov_reg(BPF_REG_1, BPF_REG_8));
+        prog.push_back(insn::add_imm(BPF_REG_1, sizeof(EventHeader)));
+        prog.push_back(insn::mov_imm(BPF_REG_2, path_size));
+        prog.push_back(insn::load(BPF_DW, BPF_REG_3, BPF_REG_6, static_cast<int16_t>(ctx_offset)));
+        prog.push_back(insn::call(BPF_FUNC_probe_read_user_str));
+    }
+
+    // Add the 32-bit tracepoint field at ctx_offset to the traced map
+    void trace_task_from_field(int ctx_offset) {
+        prog.push_back(insn::load(BPF_W, BPF_REG_1, BPF_REG_6, static_cast<int16_t>(ctx_offset)));
+        prog.push_back(insn::store(BPF_W, BPF_REG_10, BPF_REG_1, -8));
+        prog.push_back(insn::store_imm(BPF_W, BPF_REG_10, -12, 1));
+        insn::load_map(prog, BPF_REG_1, maps.traced);
+        prog.push_back(insn::mov_reg(BPF_REG_2, BPF_REG_10));
+        prog.push_back(insn::add_imm(BPF_REG_2, -8));
+        prog.push_back(insn::mov_reg(BPF_REG_3, BPF_REG_10));
+        prog.push_back(insn::add_imm(BPF_REG_3, -12));
+        prog.push_back(insn::mov_imm(BPF_REG_4, BPF_ANY));
+        prog.push_back(insn::call(BPF_FUNC_map_update_elem));
+    }
+
+    // Remove the task whose id is the 32-bit tracepoint field at
+    // ctx_offset from the traced map
+    void untrace_task_from_field(int ctx_offset) {
+        prog.push_back(insn::load(BPF_W, BPF_REG_1, BPF_REG_6, static_cast<int16_t>(ctx_offset)));
+        prog.push_back(insn::store(BPF_W, BPF_REG_10, BPF_REG_1, -8));
+        insn::load_map(prog, BPF_REG_1, maps.traced);
+        prog.push_back(insn::mov_reg(BPF_REG_2, BPF_REG_10));
+        prog.push_back(insn::add_imm(BPF_REG_2, -8));
+        prog.push_back(insn::call(BPF_FUNC_map_delete_elem));
+    }
+
+    // Remove the current thread from the traced map
+    void untrace_current_thread() {
+        prog.push_back(insn::call(BPF_FUNC_get_current_pid_tgid));
+        prog.push_back(insn::store(BPF_W, BPF_REG_10, BPF_REG_0, -4));
+        insn::load_map(prog, BPF_REG_1, maps.traced);
+        prog.push_back(insn::mov_reg(BPF_REG_2, BPF_REG_10));
+        prog.push_back(insn::add_imm(BPF_REG_2, -4));
+        prog.push_back(insn::call(BPF_FUNC_map_delete_elem));
+    }
+
+    void submit_event() {
+        prog.push_back(insn::mov_reg(BPF_REG_1, BPF_REG_8));
+        prog.push_back(insn::mov_imm(BPF_REG_2, 0));
+        prog.push_back(insn::call(BPF_FUNC_ringbuf_submit));
+    }
+
+    // Copy the scratch record into the ring buffer, trimmed to the path
+    // length probe_read_user_str left in r0
+    void output_scratch_event() {
+        // Bound the length for the verifier; a failed read sends no path
+        prog.push_back(insn::jump_if_signed_greater(BPF_REG_0, 0, 1));
+        prog.push_back(insn::mov_imm(BPF_REG_0, 0));
+        prog.push_back(insn::jump_if_signed_less_equal(BPF_REG_0, path_size, 1));
+        prog.push_back(insn::mov_imm(BPF_REG_0, 0));
+        prog.push_back(insn::add_imm(BPF_REG_0, sizeof(EventHeader)));
+        prog.push_back(insn::mov_reg(BPF_REG_3, BPF_REG_0));
+        prog.push_back(insn::mov_reg(BPF_REG_2, BPF_REG_8));
+        insn::load_map(prog, BPF_REG_1, maps.events);
+        prog.push_back(insn::mov_imm(BPF_REG_4, 0));
+        prog.push_back(insn::call(BPF_FUNC_ringbuf_output));
+        jump_to(drop_jumps, insn::jump_if_negative(BPF_REG_0, 0));
+    }
+
+    // Append the common exit and the dropped-event counter, and resolve
+    // pending jumps to them
+    std::vector<bpf_insn> finish() {
+        resolve(exit_jumps);
+        prog.push_back(insn::mov_imm(BPF_REG_0, 0));
+        prog.push_back(insn::exit());
+        if (!drop_jumps.empty()) {
+            resolve(drop_jumps);
+            prog.push_back(insn::store_imm(BPF_W, BPF_REG_10, -8, 0));
+            insn::load_map(prog, BPF_REG_1, maps.dropped);
+            prog.push_back(insn::mov_reg(BPF_REG_2, BPF_REG_10));
+            prog.push_back(insn::add_imm(BPF_REG_2, -8));
+            prog.push_back(insn::call(BPF_FUNC_map_lookup_elem));
+            prog.push_back(insn::jump_if_zero(BPF_REG_0, 2));
+            prog.push_back(insn::mov_imm(BPF_REG_1, 1));
+            prog.push_back(insn::atomic_add(BPF_REG_0, BPF_REG_1, 0));
+            prog.push_back(insn::mov_imm(BPF_REG_0, 0));
+            prog.push_back(insn::exit());
+        }
+        return prog;
+    }
+
+private:
+    MapFds maps;
+    std::vector<bpf_insn> prog;
+    std::vector<int> exit_jumps;
+    std::vector<int> drop_jumps;
+
+    // Look up the task id stored at stack_offset in the traced map and
+    // jump to the common exit if it is not there
+    void lookup_traced(int16_t stack_offset) {
+        insn::load_map(prog, BPF_REG_1, maps.traced);
+        prog.push_back(insn::mov_reg(BPF_REG_2, BPF_REG_10));
+        prog.push_back(insn::add_imm(BPF_REG_2, stack_offset));
+        prog.push_back(insn::call(BPF_FUNC_map_lookup_elem));
+        jump_to(exit_jumps, insn::jump_if_zero(BPF_REG_0, 0));
+    }
+
+    void jump_to(std::vector<int>& jumps, const bpf_insn& jump) {
+        jumps.push_back(static_cast<int>(prog.size()));
+        prog.push_back(jump);
+    }
+
+    // Point the given jumps at the next instruction
+    void resolve(const std::vector<int>& jumps) {
+        int target = static_cast<int>(prog.size());
+        for (int index : jumps) {
+            prog[index].off = static_cast<int16_t>(target - index - 1);
+        }
+    }
+};
+
+// sys_enter_* taking a path: record dirfd, flags and the path.
+// dfd_offset is -1 for syscalls that always resolve against the cwd,
+// flags_offset is -1 for syscalls without flags.
+inline std::vector<bpf_insn> build_path_entry_program(const MapFds& maps, EventType type,
+                                                      int dfd_offset, int filename_offset, int flags_offset) {
+    ProgramBuilder builder(maps);
+    builder.filter_traced_process();
+    builder.begin_scratch_event(type);
+    if (dfd_offset >= 0) {
+        builder.copy_field(BPF_DW, dfd_offset, offsetof(EventHeader, value));
+    } else {
+        builder.store_value(-100 /* AT_FDCWD */, offsetof(EventHeader, value));
+    }
+    if (flags_offset >= 0) {
+        builder.copy_field(BPF_DW, flags_offset, offsetof(EventHeader, flags));
+    }
+    builder.copy_user_path(filename_offset);
+    builder.output_scratch_event();
+    return builder.finish();
+}
+
+// sys_enter_* taking a descriptor: record it as the value
+inline std::vector<bpf_insn> build_fd_entry_program(const MapFds& maps, EventType type,
+                                                    int fd_offset) {
+    ProgramBuilder builder(maps);
+    builder.filter_traced_process();
+    builder.reserve_event(type, sizeof(EventHeader));
+    builder.copy_field(BPF_DW, fd_offset, offsetof(EventHeader, value));
+    builder.submit_event();
+    return builder.finish();
+}
+
+// sys_exit_*: record the return value. A thread runs one syscall at a
+// time, so user space pairs it with the thread's last entry event.
+inline std::vector<bpf_insn> build_exit_result_program(const MapFds& maps, int ret_offset) {
+    ProgramBuilder builder(maps);
+    builder.filter_traced_process();
+    builder.reserve_event(EVENT_RESULT, sizeof(EventHeader));
+    builder.copy_field(BPF_DW, ret_offset, offsetof(EventHeader, value));
+    builder.submit_event();
+    return builder.finish();
+}
+
+// sched_process_fork: children of traced tasks are traced from their
+// first instruction, without a round trip through user space
+inline std::vector<bpf_insn> build_fork_program(const MapFds& maps, int child_pid_offset) {
+    ProgramBuilder builder(maps);
+    builder.filter_traced_process();
+    builder.trace_task_from_field(child_pid_offset);
+    builder.reserve_event(EVENT_FORK, sizeof(EventHeader));
+    builder.copy_field(BPF_W, child_pid_offset, offsetof(EventHeader, value));
+    builder.submit_event();
+    return builder.finish();
+}
+
+// sched_process_exit: drop the exiting task's entry. Every task's entry
+// is added by the fork program and goes when that task exits.
+inline std::vector<bpf_insn> build_task_exit_program(const MapFds& maps) {
+    ProgramBuilder builder(maps);
+    builder.untrace_current_thread();
+    return builder.finish();
+}
+
+// sched_process_exec: a thread other than the leader that execs takes
+// over the leader's task id, whose entry went with the leader; move the
+// thread's entry to its new id
+inline std::vector<bpf_insn> build_exec_program(const MapFds& maps, int old_pid_offset, int pid_offset) {
+    ProgramBuilder builder(maps);
+    builder.filter_traced_field(old_pid_offset);
+    builder.untrace_task_from_field(old_pid_offset);
+    builder.trace_task_from_field(pid_offset);
+    return builder.finish();
+}
+
+inline long bpf(int cmd, union bpf_attr& attr) {
+    return syscall(SYS_bpf, cmd, &attr, sizeof(attr));
+}
+
+// Directory holding tracepoint ids and formats
+inline std::string tracefs_events_dir() {
+    for (const char* dir : {"/sys/kernel/tracing/events", "/sys/kernel/debug/tracing/events"}) {
+        if (access(dir, R_OK) == 0) {
+            return dir;
+        }
+    }
+    return "";
+}
+
+// Offset of a field in a tracepoint record, -1 if not found
+inline int tracepoint_field_offset(const std::string& tracepoint, const std::string& field) {
+    std::ifstream format(tracefs_events_dir() + "/" + tracepoint + "/format");
+    std::string line;
+    while (std::getline(format, line)) {
+        // "\tfield:const char * filename;\toffset:24;\tsize:8;\tsigned:0;"
+        auto name_end = line.find(';');
+        auto offset_pos = line.find("offset:");
+        if (name_end == std::string::npos || offset_pos == std::string::npos) {
+            continue;
+        }
+        std::string declaration = line.substr(0, name_end);
+        auto name_start = declaration.find_last_of(" \t*");
+        if (declaration.substr(name_start + 1) == field) {
+            return std::stoi(line.substr(offset_pos + 7));
+        }
+    }
+    return -1;
+}
+
+// Maps, programs and perf events of one eBPF tracing session
+class EbpfTracer {
+public:
+    EbpfTracer() = default;
+
+    ~EbpfTracer() {
+        if (ring_consumer != nullptr) {
+            munmap(ring_consumer, page_size);
+        }
+        if (ring_producer != nullptr) {
+            munmap(ring_producer, page_size + 2 * ring_size);
+        }
+        for (int fd : perf_fds) {
+            close(fd);
+        }
+        for (int fd : prog_fds) {
+            close(fd);
+        }
+        for (int fd : {maps.traced, maps.events, maps.scratch, maps.dropped}) {
+            if (fd != -1) {
+                close(fd);
+            }
+        }
+    }
+
+    EbpfTracer(const EbpfTracer&) = delete;
+    EbpfTracer& operator=(const EbpfTracer&) = delete;
+
+    // Create the maps, load the programs and attach them to their
+    // tracepoints; needs CAP_BPF and CAP_PERFMON (or root)
+    bool load(size_t ring_buffer_size = 16 << 20) {
+        page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        ring_size = ring_buffer_size;
+
+        if (tracefs_events_dir().empty()) {
+            last_error = "tracefs is not mounted";
+            return false;
+        }
+        TracepointOffsets offsets;
+        offsets.open_filename = tracepoint_field_offset("syscalls/sys_enter_open", "filename");
+        offsets.open_flags = tracepoint_field_offset("syscalls/sys_enter_open", "flags");
+        offsets.openat_dfd = tracepoint_field_offset("syscalls/sys_enter_openat", "dfd");
+        offsets.openat_filename = tracepoint_field_offset("syscalls/sys_enter_openat", "filename");
+        offsets.openat_flags = tracepoint_field_offset("syscalls/sys_enter_openat", "flags");
+        offsets.chdir_filename = tracepoint_field_offset("syscalls/sys_enter_chdir", "filename");
+        offsets.fchdir_fd = tracepoint_field_offset("syscalls/sys_enter_fchdir", "fd");
+        offsets.exit_ret = tracepoint_field_offset("syscalls/sys_exit_openat", "ret");
+        offsets.fork_child_pid = tracepoint_field_offset("sched/sched_process_fork", "child_pid");
+        offsets.exec_pid = tracepoint_field_offset("sched/sched_process_exec", "pid");
+        offsets.exec_old_pid = tracepoint_field_offset("sched/sched_process_exec", "old_pid");
+        if (offsets.openat_filename < 0 || offsets.openat_dfd < 0 || offsets.openat_flags < 0 ||
+            offsets.chdir_filename < 0 || offsets.fchdir_fd < 0 || offsets.exit_ret < 0 ||
+            offsets.fork_child_pid < 0) {
+            last_error = "syscall tracepoints unavailable (CONFIG_FTRACE_SYSCALLS)";
+            return false;
+        }
+
+        maps.traced = create_map(BPF_MAP_TYPE_HASH, sizeof(uint32_t), sizeof(uint32_t), 65536);
+        maps.events = create_map(BPF_MAP_TYPE_RINGBUF, 0, 0, static_cast<uint32_t>(ring_size));
+        maps.scratch = create_map(BPF_MAP_TYPE_PERCPU_ARRAY, sizeof(uint32_t), path_event_size, 1);
+        maps.dropped = create_map(BPF_MAP_TYPE_ARRAY, sizeof(uint32_t), sizeof(uint64_t), 1);
+        if (maps.traced == -1 || maps.events == -1 || maps.scratch == -1 || maps.dropped == -1) {
+            return false;
+        }
+
+        auto exit_program = [&]() {
+            return build_exit_result_program(maps, offsets.exit_ret);
+        };
+        bool attached =
+            attach("syscalls/sys_enter_openat", build_path_entry_program(maps, EVENT_OPEN,
+                   offsets.openat_dfd, offsets.openat_filename, offsets.openat_flags)) &&
+            attach("syscalls/sys_exit_openat", exit_program()) &&
+            attach("syscalls/sys_enter_chdir", build_path_entry_program(maps, EVENT_CHDIR,
+                   -1, offsets.chdir_filename, -1)) &&
+            attach("syscalls/sys_exit_chdir", exit_program()) &&
+            attach("syscalls/sys_enter_fchdir", build_fd_entry_program(maps, EVENT_FCHDIR,
+                   offsets.fchdir_fd)) &&
+            attach("syscalls/sys_exit_fchdir", exit_program()) &&
+            attach("sched/sched_process_fork", build_fork_program(maps, offsets.fork_child_pid)) &&
+            attach("sched/sched_process_exit", build_task_exit_program(maps));
+        if (attached && offsets.exec_pid >= 0 && offsets.exec_old_pid >= 0) {
+            attached = attach("sched/sched_process_exec", build_exec_program(maps, offsets.exec_old_pid,
+                                                                               offsets.exec_pid));
+        }
+        // open(2) only exists on some architectures
+        if (attached && offsets.open_filename >= 0) {
+            attached = attach("syscalls/sys_enter_open", build_path_entry_program(maps,
+                              EVENT_OPEN, -1, offsets.open_filename, offsets.open_flags)) &&
+                       attach("syscalls/sys_exit_open", exit_program());
+        }
+        return attached && map_ring_buffer();
+    }
+
+    // Trace the task pid and, through the fork program, everything it
+    // creates. The launched command is traced before it runs, while it
+    // has a single thread.
+    bool trace_process(pid_t pid) {
+        uint32_t key = static_cast<uint32_t>(pid);
+        uint32_t value = 1;
+        union bpf_attr attr = {};
+        attr.map_fd = static_cast<uint32_t>(maps.traced);
+        attr.key = reinterpret_cast<uint64_t>(&key);
+        attr.value = reinterpret_cast<uint64_t>(&value);
+        attr.flags = BPF_ANY;
+        if (bpf(BPF_MAP_UPDATE_ELEM, attr) == -1) {
+            last_error = std::string("BPF_MAP_UPDATE_ELEM: ") + strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    // Ring buffer descriptor; readable when records are available
+    int fd() const {
+        return maps.events;
+    }
+
+    // Pass every committed record to handler(const EventHeader&, const char* path)
+    template<typename Handler>
+    size_t consume(Handler handler) {
+        auto* consumer_pos = reinterpret_cast<uint64_t*>(ring_consumer);
+        auto* producer_pos = reinterpret_cast<uint64_t*>(ring_producer);
+        const char* data = static_cast<const char*>(ring_producer) + page_size;
+        uint64_t mask = ring_size - 1;
+        size_t consumed = 0;
+
+        uint64_t consumer = __atomic_load_n(consumer_pos, __ATOMIC_ACQUIRE);
+        uint64_t producer = __atomic_load_n(producer_pos, __ATOMIC_ACQUIRE);
+        while (consumer < producer) {
+            auto* record_header = reinterpret_cast<const uint32_t*>(data + (consumer & mask));
+            uint32_t len = __atomic_load_n(record_header, __ATOMIC_ACQUIRE);
+            if (len & BPF_RINGBUF_BUSY_BIT) {
+                break;
+            }
+            uint32_t sample_len = len & ~(BPF_RINGBUF_BUSY_BIT | BPF_RINGBUF_DISCARD_BIT);
+            const char* sample = reinterpret_cast<const char*>(record_header) + BPF_RINGBUF_HDR_SZ;
+            if (!(len & BPF_RINGBUF_DISCARD_BIT) && sample_len >= sizeof(EventHeader)) {
+                const auto* header = reinterpret_cast<const EventHeader*>(sample);
+                const char* path = sample_len > sizeof(EventHeader) ? sample + sizeof(EventHeader) : nullptr;
+                handler(*header, path);
+                consumed++;
+            }
+            consumer += (sample_len + BPF_RINGBUF_HDR_SZ + 7) & ~7ULL;
+            __atomic_store_n(consumer_pos, consumer, __ATOMIC_RELEASE);
+            if (consumer == producer) {
+                producer = __atomic_load_n(producer_pos, __ATOMIC_ACQUIRE);
+            }
+        }
+        return consumed;
+    }
+
+    // Events the programs could not fit into the ring buffer
+    uint64_t dropped() const {
+        uint32_t key = 0;
+        uint64_t count = 0;
+        union bpf_attr attr = {};
+        attr.map_fd = static_cast<uint32_t>(maps.dropped);
+        attr.key = reinterpret_cast<uint64_t>(&key);
+        attr.value = reinterpret_cast<uint64_t>(&count);
+        return bpf(BPF_MAP_LOOKUP_ELEM, attr) == 0 ? count : 0;
+    }
+
+    const std::string& get_last_error() const {
+        return last_error;
+    }
+
+private:
+    MapFds maps = {-1, -1, -1, -1};
+    std::vector<int> prog_fds;
+    std::vector<int> perf_fds;
+    void* ring_consumer = nullptr;
+    void* ring_producer = nullptr;
+    size_t page_size = 0;
+    size_t ring_size = 0;
+    std::string last_error;
+
+    int create_map(uint32_t type, uint32_t key_size, uint32_t value_size, uint32_t max_entries) {
+        union bpf_attr attr = {};
+        attr.map_type = type;
+        attr.key_size = key_size;
+        attr.value_size = value_size;
+        attr.max_entries = max_entries;
+        attr.map_flags = 0;
+        int fd = static_cast<int>(bpf(BPF_MAP_CREATE, attr));
+        if (fd == -1) {
+            last_error = std::string("BPF_MAP_CREATE: ") + strerror(errno);
+        }
+        return fd;
+    }
+
+    // Load a tracepoint program and attach it through a perf event
+    bool attach(const std::string& tracepoint, const std::vector<bpf_insn>& program) {
+        static const char license[] = "GPL";
+        std::vector<char> log(64 * 1024);
+        union bpf_attr attr = {};
+        attr.prog_type = BPF_PROG_TYPE_TRACEPOINT;
+        attr.insns = reinterpret_cast<uint64_t>(program.data());
+        attr.insn_cnt = static_cast<uint32_t>(program.size());
+        attr.license = reinterpret_cast<uint64_t>(license);
+        attr.log_buf = reinterpret_cast<uint64_t>(log.data());
+        attr.log_size = static_cast<uint32_t>(log.size());
+        attr.log_level = 1;
+        int prog_fd = static_cast<int>(bpf(BPF_PROG_LOAD, attr));
+        if (prog_fd == -1) {
+            last_error = "BPF_PROG_LOAD " + tracepoint + ": " + strerror(errno) + "\n" + log.data();
+            return false;
+        }
+        prog_fds.push_back(prog_fd);
+
+        std::ifstream id_file(tracefs_events_dir() + "/" + tracepoint + "/id");
+        uint64_t id = 0;
+        if (!(id_file >> id)) {
+            last_error = "Unknown tracepoint " + tracepoint;
+            return false;
+        }
+
+        // A tracepoint program runs on every CPU, whichever CPU the perf
+        // event is opened on
+        struct perf_event_attr perf_attr = {};
+        perf_attr.type = PERF_TYPE_TRACEPOINT;
+        perf_attr.size = sizeof(perf_attr);
+        perf_attr.config = id;
+        perf_attr.sample_period = 1;
+        perf_attr.wakeup_events = 1;
+        int perf_fd = static_cast<int>(syscall(SYS_perf_event_open, &perf_attr, -1, 0, -1, PERF_FLAG_FD_CLOEXEC));
+        if (perf_fd == -1) {
+            last_error = "perf_event_open " + tracepoint + ": " + strerror(errno);
+            return false;
+        }
+        perf_fds.push_back(perf_fd);
+        if (ioctl(perf_fd, PERF_EVENT_IOC_SET_BPF, prog_fd) == -1 ||
+            ioctl(perf_fd, PERF_EVENT_IOC_ENABLE, 0) == -1) {
+            last_error = "Attaching to " + tracepoint + ": " + strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    // Map the consumer position read-write and the producer position plus
+    // the data area (mapped twice back to back by the kernel) read-only
+    bool map_ring_buffer() {
+        ring_consumer = mmap(nullptr, page_size, PROT_READ | PROT_WRITE, MAP_SHARED, maps.events, 0);
+        if (ring_consumer == MAP_FAILED) {
+            ring_consumer = nullptr;
+            last_error = std::string("mmap ring buffer: ") + strerror(errno);
+            return false;
+        }
+        ring_producer = mmap(nullptr, page_size + 2 * ring_size, PROT_READ, MAP_SHARED,
+                             maps.events, static_cast<off_t>(page_size));
+        if (ring_producer == MAP_FAILED) {
+            ring_producer = nullptr;
+            last_error = std::string("mmap ring buffer: ") + strerror(errno);
+            return false;
+        }
+        return true;
+    }
+};
+
+} // namespace ebpf_backend
+
+#endif // EBPF_BACKEND_HPP
@@ -0,0 +1,239 @@
+#ifndef FANOTIFY_BACKEND_HPP
+#define FANOTIFY_BACKEND_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <sys/fanotify.h>
+#include <sys/statfs.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+
+namespace fanotify_backend {
+
+// File event as reported by fanotify, already resolved to a path
+struct FileEvent {
+    pid_t tid;         // Thread that caused the event (process id without FAN_REPORT_TID)
+    std::string path;
+    bool open;         // FAN_OPEN or FAN_OPEN_EXEC
+    bool exec;         // FAN_OPEN_EXEC: opened for execution
+    bool close_write;  // FAN_CLOSE_WRITE: closed after being opened for writing
+};
+
+// Events filetrace marks mounts for
+constexpr uint64_t event_mask = FAN_OPEN | FAN_OPEN_EXEC | FAN_CLOSE_WRITE;
+
+// Mount points listed in /proc/self/mountinfo, with octal escapes decoded
+inline std::vector<std::string> list_mount_points() {
+    std::vector<std::string> mount_points;
+    std::ifstream mountinfo("/proc/self/mountinfo");
+    std::string line;
+    while (std::getline(mountinfo, line)) {
+        std::istringstream fields(line);
+        std::string id, parent, device, root, mount_point;
+        if (!(fields >> id >> parent >> device >> root >> mount_point)) {
+            continue;
+        }
+        std::string decoded;
+        for (size_t i = 0; i < mount_point.size(); i++) {
+            if (mount_point[i] == '\\' && i + 3 < mount_point.size()) {
+                decoded += static_cast<char>(std::stoi(mount_point.substr(i + 1, 3), nullptr, 8));
+                i += 3;
+            } else {
+                decoded += mount_point[i];
+            }
+        }
+        mount_points.push_back(decoded);
+    }
+    return mount_points;
+}
+
+// fanotify notification group watching whole mounts. Events are reported
+// with file handles (FAN_REPORT_FID) and resolved to paths through a
+// descriptor kept open on each marked mount; kernels without FID
+// reporting fall back to an open descriptor per event.
+class FanotifyMonitor {
+public:
+    FanotifyMonitor() = default;
+
+    ~FanotifyMonitor() {
+        for (const auto& mount : mounts) {
+            close(mount.fd);
+        }
+        if (fan_fd != -1) {
+            close(fan_fd);
+        }
+    }
+
+    FanotifyMonitor(const FanotifyMonitor&) = delete;
+    FanotifyMonitor& operator=(const FanotifyMonitor&) = delete;
+
+    // Create the notification group; needs CAP_SYS_ADMIN
+    bool init() {
+        const unsigned int base_flags = FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK;
+        const unsigned int attempts[] = {
+            base_flags | FAN_REPORT_FID | FAN_REPORT_TID,
+            base_flags | FAN_REPORT_FID,
+            base_flags | FAN_REPORT_TID,
+            base_flags
+        };
+        for (unsigned int flags : attempts) {
+            fan_fd = fanotify_init(flags, O_RDONLY | O_CLOEXEC);
+            if (fan_fd != -1) {
+                report_fid = (flags & FAN_REPORT_FID) != 0;
+                report_tid = (flags & FAN_REPORT_TID) != 0;
+                return true;
+            }
+            if (errno != EINVAL) {
+                break;
+            }
+        }
+        last_error = std::string("fanotify_init: ") + strerror(errno);
+        return false;
+    }
+
+    // Watch every file on the mount containing path
+    bool mark_mount(const std::string& path) {
+        if (fanotify_mark(fan_fd, FAN_MARK_ADD | FAN_MARK_MOUNT, event_mask, AT_FDCWD, path.c_str()) == -1) {
+            last_error = "fanotify_mark " + path + ": " + strerror(errno);
+            return false;
+        }
+        if (report_fid) {
+            int mount_fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            struct statfs fs;
+            if (mount_fd == -1 || fstatfs(mount_fd, &fs) == -1) {
+                last_error = "open " + path + ": " + strerror(errno);
+                if (mount_fd != -1) {
+                    close(mount_fd);
+                }
+                return false;
+            }
+            MountRef ref;
+            ref.fd = mount_fd;
+            std::memcpy(ref.fsid, &fs.f_fsid, sizeof(ref.fsid));
+            mounts.push_back(ref);
+        }
+        return true;
+    }
+
+    int fd() const {
+        return fan_fd;
+    }
+
+    bool reports_tid() const {
+        return report_tid;
+    }
+
+    const std::string& get_last_error() const {
+        return last_error;
+    }
+
+    // Read all queued events, passing each resolved event to handler.
+    // wanted(tid) is asked first so that events of unrelated processes are
+    // dropped without resolving their path. Returns false on a read error
+    // other than an empty queue.
+    template<typename Filter, typename Handler>
+    bool read_events(Filter wanted, Handler handler) {
+        alignas(struct fanotify_event_metadata) char buffer[64 * 1024];
+        while (true) {
+            ssize_t len = read(fan_fd, buffer, sizeof(buffer));
+            if (len == -1) {
+                if (errno == EAGAIN || errno == EINTR) {
+                    return true;
+                }
+                last_error = std::string("read: ") + strerror(errno);
+                return false;
+            }
+
+            auto* metadata = reinterpret_cast<struct fanotify_event_metadata*>(buffer);
+            while (FAN_EVENT_OK(metadata, len)) {
+                if (wanted(metadata->pid)) {
+                    FileEvent event;
+                    event.tid = metadata->pid;
+                    // Unread events on the same file are merged, so one
+                    // event can carry both an open and a close
+                    event.open = (metadata->mask & (FAN_OPEN | FAN_OPEN_EXEC)) != 0;
+                    event.exec = (metadata->mask & FAN_OPEN_EXEC) != 0;
+                    event.close_write = (metadata->mask & FAN_CLOSE_WRITE) != 0;
+                    if (resolve_path(metadata, event.path)) {
+                        handler(event);
+                    }
+                }
+                if (metadata->fd >= 0) {
+                    close(metadata->fd);
+                }
+                metadata = FAN_EVENT_NEXT(metadata, len);
+            }
+        }
+    }
+
+private:
+    struct MountRef {
+        int fd;
+        int fsid[2];
+    };
+
+    int fan_fd = -1;
+    bool report_fid = false;
+    bool report_tid = false;
+    std::vector<MountRef> mounts;
+    std::string last_error;
+
+    static bool readlink_fd(int fd, std::string& path) {
+        char link[64];
+        char buf[PATH_MAX];
+        snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+        ssize_t len = readlink(link, buf, sizeof(buf) - 1);
+        if (len == -1) {
+            return false;
+        }
+        path.assign(buf, len);
+        return true;
+    }
+
+    bool resolve_path(const struct fanotify_event_metadata* metadata, std::string& path) {
+        if (!report_fid) {
+            return metadata->fd >= 0 && readlink_fd(metadata->fd, path);
+        }
+
+        // Info records follow the fixed metadata
+        const char* record = reinterpret_cast<const char*>(metadata) + metadata->metadata_len;
+        const char* end = reinterpret_cast<const char*>(metadata) + metadata->event_len;
+        while (record + sizeof(struct fanotify_event_info_header) <= end) {
+            auto* header = reinterpret_cast<const struct fanotify_event_info_header*>(record);
+            if (header->len == 0) {
+                break;
+            }
+            if (header->info_type == FAN_EVENT_INFO_TYPE_FID) {
+                auto* fid = reinterpret_cast<const struct fanotify_event_info_fid*>(record);
+                auto* handle = reinterpret_cast<struct file_handle*>(const_cast<unsigned char*>(fid->handle));
+                for (const auto& mount : mounts) {
+                    if (std::memcmp(mount.fsid, &fid->fsid, sizeof(mount.fsid)) != 0) {
+                        continue;
+                    }
+                    int file_fd = open_by_handle_at(mount.fd, handle, O_PATH | O_CLOEXEC);
+                    if (file_fd == -1) {
+                        // Deleted before the event was read
+                        return false;
+                    }
+                    bool resolved = readlink_fd(file_fd, path);
+                    close(file_fd);
+                    return resolved;
+                }
+                return false;
+            }
+            record += header->len;
+        }
+        return false;
+    }
+};
+
+} // namespace fanotify_backend
+
+#endif // FANOTIFY_BACKEND_HPP
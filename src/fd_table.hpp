@@ -0,0 +1,92 @@
+#ifndef FD_TABLE_HPP
+#define FD_TABLE_HPP
+
+#include <string>
+#include <unordered_map>
+
+namespace fd_table {
+
+// Paths behind the open descriptors of one descriptor table. Tasks created
+// with CLONE_FILES share a single FdTable; fork and exec get their own copy.
+class FdTable {
+public:
+    // Record the path behind a newly opened descriptor
+    void set(int fd, const std::string& path, bool cloexec) {
+        entries[fd] = Entry{path, cloexec};
+    }
+
+    // Path behind fd, or nullptr if the table has never seen it
+    const std::string* find(int fd) const {
+        auto it = entries.find(fd);
+        return it == entries.end() ? nullptr : &it->second.path;
+    }
+
+    void set_cloexec(int fd, bool cloexec) {
+        auto it = entries.find(fd);
+        if (it != entries.end()) {
+            it->second.cloexec = cloexec;
+        }
+    }
+
+    // newfd now refers to the same file as oldfd (dup/dup2/dup3/F_DUPFD)
+    void duplicate(int oldfd, int newfd, bool cloexec) {
+        if (oldfd == newfd) {
+            return;
+        }
+        auto it = entries.find(oldfd);
+        if (it == entries.end()) {
+            // Whatever newfd referred to before was closed by the dup
+            entries.erase(newfd);
+            return;
+        }
+        entries[newfd] = Entry{it->second.path, cloexec};
+    }
+
+    void close(int fd) {
+        entries.erase(fd);
+    }
+
+    // close_range(first, last, flags); with cloexec_only the descriptors
+    // stay open and are only marked close-on-exec
+    void close_range(unsigned int first, unsigned int last, bool cloexec_only) {
+        for (auto it = entries.begin(); it != entries.end();) {
+            unsigned int fd = static_cast<unsigned int>(it->first);
+            if (fd >= first && fd <= last) {
+                if (cloexec_only) {
+                    it->second.cloexec = true;
+                } else {
+                    it = entries.erase(it);
+                    continue;
+                }
+            }
+            ++it;
+        }
+    }
+
+    // Descriptor table as left by a successful execve
+    void drop_cloexec() {
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (it->second.cloexec) {
+                it = entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+private:
+    struct Entry {
+        std::string path;
+        bool cloexec;
+    };
+
+    std::unordered_map<int, Entry> entries;
+};
+
+} // namespace fd_table
+
+#endif // FD_TABLE_HPP
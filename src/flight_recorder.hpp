@@ -0,0 +1,148 @@
+#ifndef FLIGHT_RECORDER_HPP
+#define FLIGHT_RECORDER_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <signal.h>
+
+namespace flight_recorder {
+
+// Capacity when only a time window is given
+constexpr size_t window_capacity = 1 << 16;
+
+// Most events a limit may ask for. Every slot is allocated up front, so a
+// larger count would only exhaust memory.
+constexpr size_t max_events = 1 << 20;
+
+// How much a flight recorder keeps: the last events, or those recorded
+// within window (up to window_capacity of them)
+struct Limit {
+    size_t events = 0;
+    std::chrono::milliseconds window{0};
+};
+
+// Parse a --flight-recorder limit: a number of events ("50000") or a
+// duration with a unit of ms, s, m or h ("30s")
+inline bool parse_limit(const std::string& spec, Limit& limit, std::string& error) {
+    size_t digits = 0;
+    while (digits < spec.size() && spec[digits] >= '0' && spec[digits] <= '9') {
+        digits++;
+    }
+    if (digits == 0 || digits > 12) {
+        error = "Invalid flight recorder limit: " + spec;
+        return false;
+    }
+    unsigned long long count = std::stoull(spec.substr(0, digits));
+    std::string unit = spec.substr(digits);
+    if (count == 0) {
+        error = "Flight recorder limit must be more than zero: " + spec;
+        return false;
+    }
+    if (unit.empty()) {
+        if (count > max_events) {
+            error = "Flight recorder limit must be at most " + std::to_string(max_events) + " events: " + spec;
+            return false;
+        }
+        limit.events = static_cast<size_t>(count);
+        limit.window = std::chrono::milliseconds(0);
+        return true;
+    }
+    unsigned long long scale = unit == "ms" ? 1 : unit == "s" ? 1000 : unit == "m" ? 60000 :
+                               unit == "h" ? 3600000 : 0;
+    if (scale == 0) {
+        error = "Unknown flight recorder unit \"" + unit + "\"; use ms, s, m or h";
+        return false;
+    }
+    limit.events = window_capacity;
+    limit.window = std::chrono::milliseconds(count * scale);
+    return true;
+}
+
+// Signals whose default action dumps core: a tracee killed by one crashed
+inline bool is_crash_signal(int sig) {
+    switch (sig) {
+    case SIGQUIT:
+    case SIGILL:
+    case SIGTRAP:
+    case SIGABRT:
+    case SIGBUS:
+    case SIGFPE:
+    case SIGSEGV:
+    case SIGXCPU:
+    case SIGXFSZ:
+    case SIGSYS:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// The most recent items of an unbounded stream, in a ring of slots
+// allocated once. Recording copies into the oldest slot, whose storage is
+// reused, so memory stays the same however long the stream runs. Not
+// thread-safe.
+template<typename T>
+class FlightRecorder {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Keep the last capacity items; with a non-zero window, only those of
+    // them recorded within it are visited
+    explicit FlightRecorder(size_t capacity, Clock::duration window = Clock::duration::zero())
+        : slots(std::max<size_t>(capacity, 1)), window(window) {}
+
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    void record(const T& item, Clock::time_point now = Clock::now()) {
+        Slot& slot = slots[next % slots.size()];
+        slot.item = item;
+        slot.time = now;
+        next++;
+    }
+
+    // Call visit(item) on the items kept, oldest first; returns how many
+    template<typename Visit>
+    size_t for_each(Visit visit, Clock::time_point now = Clock::now()) const {
+        size_t visited = 0;
+        for (unsigned long long i = next - size(); i < next; i++) {
+            const Slot& slot = slots[i % slots.size()];
+            if (window != Clock::duration::zero() && now - slot.time > window) {
+                continue;
+            }
+            visit(slot.item);
+            visited++;
+        }
+        return visited;
+    }
+
+    size_t size() const {
+        return static_cast<size_t>(std::min<unsigned long long>(next, slots.size()));
+    }
+
+    size_t capacity() const {
+        return slots.size();
+    }
+
+    // Items recorded since the recorder was created, kept or not
+    unsigned long long total_recorded() const {
+        return next;
+    }
+
+private:
+    struct Slot {
+        T item;
+        Clock::time_point time;
+    };
+
+    std::vector<Slot> slots;
+    Clock::duration window;
+    unsigned long long next = 0;
+};
+
+} // namespace flight_recorder
+
+#endif // FLIGHT_RECORDER_HPP
@@ -43,7 +43,11 @@ public:
             << ".directory { color: var(--primary-color); cursor: pointer; }\n"
             << ".directory .name { font-weight: 600; }\n"
             << ".sequence { color: var(--primary-color); margin-left: var(--spacing-unit); font-weight: 600; opacity: 0.8; }\n"
+            << ".operation-info { color: var(--primary-color); margin-left: var(--spacing-unit); font-style: italic; opacity: 0.8; }\n"
             << ".thread-info { color: var(--text-color); margin-left: var(--spacing-unit); opacity: 0.7; }\n"
+            << ".failed .name { text-decoration: line-through; opacity: 0.6; }\n"
+            << ".error-info { color: #cc3333; margin-left: var(--spacing-unit); opacity: 0.8; }\n"
+            << ".sample-info { color: var(--text-color); margin-left: var(--spacing-unit); opacity: 0.6; }\n"
             << ".debug-info { color: var(--text-color); margin-left: var(--spacing-unit); opacity: 0.7; transition: all 0.3s ease; }\n"
             << ".debug-info.collapsed { max-height: 0; overflow: hidden; opacity: 0; }\n"
             << ".debug-info-header { cursor: pointer; display: flex; align-items: center; }\n"
@@ -0,0 +1,460 @@
+#ifndef IO_URING_TRACKER_HPP
+#define IO_URING_TRACKER_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/types.h>
+#include "process_memory.hpp"
+#include "syscall_table.hpp"
+
+// Setup flags newer than some kernel headers
+#ifndef IORING_SETUP_NO_MMAP
+#define IORING_SETUP_NO_MMAP (1U << 14)
+#endif
+#ifndef IORING_SETUP_NO_SQARRAY
+#define IORING_SETUP_NO_SQARRAY (1U << 16)
+#endif
+
+namespace io_uring_tracker {
+
+// Ring descriptors a thread can register at once (IO_RINGFD_REG_MAX)
+constexpr unsigned int max_registered_rings = 16;
+
+// Field of a submission queue entry an operation takes an argument from
+enum class Field : uint8_t {
+    NONE,
+    FD,     // sqe->fd
+    LEN,    // sqe->len, a second directory descriptor for renameat and linkat
+    ADDR,   // sqe->addr
+    ADDR2,  // sqe->addr2
+};
+
+// One path of an operation and the directory descriptor it is relative to
+struct SqePath {
+    Field path = Field::NONE;
+    Field dirfd = Field::NONE;
+};
+
+// What an io_uring opcode that takes paths records; the ring counterpart
+// of syscall_table::SyscallDescriptor
+struct OpDescriptor {
+    uint8_t opcode;
+    const char* name;
+    syscall_table::Category category;
+    SqePath paths[2];
+    bool how = false;  // addr2 holds a struct open_how (openat2)
+};
+
+constexpr OpDescriptor operations[] = {
+    {IORING_OP_OPENAT, "io_uring openat", syscall_table::OPEN, {{Field::ADDR, Field::FD}, {}}},
+    {IORING_OP_OPENAT2, "io_uring openat2", syscall_table::OPEN, {{Field::ADDR, Field::FD}, {}}, true},
+    {IORING_OP_STATX, "io_uring statx", syscall_table::STAT, {{Field::ADDR, Field::FD}, {}}},
+    {IORING_OP_RENAMEAT, "io_uring renameat", syscall_table::RENAME,
+     {{Field::ADDR, Field::FD}, {Field::ADDR2, Field::LEN}}},
+    {IORING_OP_UNLINKAT, "io_uring unlinkat", syscall_table::UNLINK, {{Field::ADDR, Field::FD}, {}}},
+    {IORING_OP_MKDIRAT, "io_uring mkdirat", syscall_table::MKDIR, {{Field::ADDR, Field::FD}, {}}},
+    // The symlink target in addr is stored, not looked up
+    {IORING_OP_SYMLINKAT, "io_uring symlinkat", syscall_table::LINK, {{Field::ADDR2, Field::FD}, {}}},
+    {IORING_OP_LINKAT, "io_uring linkat", syscall_table::LINK,
+     {{Field::ADDR, Field::FD}, {Field::ADDR2, Field::LEN}}},
+};
+
+// Descriptor of opcode, nullptr for opcodes that take no path
+inline const OpDescriptor* describe_op(uint8_t opcode) {
+    for (const OpDescriptor& op : operations) {
+        if (op.opcode == opcode) {
+            return &op;
+        }
+    }
+    return nullptr;
+}
+
+inline unsigned long long field(const struct io_uring_sqe& sqe, Field which) {
+    switch (which) {
+        case Field::FD:
+            return static_cast<unsigned long long>(static_cast<long long>(sqe.fd));
+        case Field::LEN:
+            return static_cast<unsigned long long>(static_cast<long long>(static_cast<int32_t>(sqe.len)));
+        case Field::ADDR:
+            return sqe.addr;
+        case Field::ADDR2:
+            return sqe.addr2;
+        case Field::NONE:
+            break;
+    }
+    return 0;
+}
+
+// A path operation read from the submission queue, held until its
+// completion queue entry shows the result
+struct Submission {
+    pid_t tid;                 // Thread whose io_uring_enter submitted it
+    uint64_t user_data;        // Echoed in its completion
+    const OpDescriptor* op;
+    std::string path;
+    std::string second_path;   // Second path of renameat and linkat
+    uint64_t open_flags;
+    bool fixed_slot;           // Opened into the ring's fixed file table, no descriptor
+    uint32_t cq_tail;          // CQ tail at submission; its completion comes at or after it
+};
+
+// A ring as set up by io_uring_setup and mapped by its creator
+struct Ring {
+    struct io_uring_params params;
+    unsigned long sq_ring = 0;  // Tracee addresses, 0 until mapped
+    unsigned long cq_ring = 0;
+    unsigned long sqes = 0;
+    std::vector<Submission> in_flight;
+    uint32_t cq_seen = 0;       // CQ entries before this position were scanned
+
+    bool mapped() const {
+        return sq_ring != 0 && cq_ring != 0 && sqes != 0;
+    }
+
+    size_t sqe_size() const {
+        return (params.flags & IORING_SETUP_SQE128) ? 128 : 64;
+    }
+
+    size_t cqe_size() const {
+        return (params.flags & IORING_SETUP_CQE32) ? 32 : 16;
+    }
+};
+
+// user_addr of a ring offsets structure: the 64-bit field after resv1,
+// named resv2 by headers older than IORING_SETUP_NO_MMAP
+template<typename Offsets>
+unsigned long user_addr(const Offsets& offsets) {
+    uint64_t addr;
+    std::memcpy(&addr, reinterpret_cast<const char*>(&offsets) + offsetof(Offsets, resv1) + sizeof(uint32_t),
+                sizeof(addr));
+    return static_cast<unsigned long>(addr);
+}
+
+// The io_uring instances of one descriptor table. Rings are found through
+// their descriptor or, for io_uring_enter with IORING_ENTER_REGISTERED_RING,
+// through the index the submitting thread registered them under; a ring
+// stays usable through its index after its descriptor is closed.
+class RingTable {
+public:
+    // Ring fd was created with the parameters io_uring_setup returned.
+    // IORING_SETUP_NO_MMAP rings live in memory the caller provided.
+    void add(int fd, const struct io_uring_params& params) {
+        close(fd);
+        int id = next_id++;
+        Ring& ring = rings[id];
+        ring.params = params;
+        if (params.flags & IORING_SETUP_NO_MMAP) {
+            // cq_off names the memory of both rings, sq_off that of the SQEs
+            ring.sq_ring = user_addr(params.cq_off);
+            ring.cq_ring = ring.sq_ring;
+            ring.sqes = user_addr(params.sq_off);
+        }
+        by_fd[fd] = id;
+    }
+
+    Ring* find(int fd) {
+        auto it = by_fd.find(fd);
+        return it == by_fd.end() ? nullptr : &rings[it->second];
+    }
+
+    Ring* find_registered(pid_t tid, unsigned int index) {
+        auto it = by_index.find({tid, index});
+        return it == by_index.end() ? nullptr : &rings[it->second];
+    }
+
+    // The creator mapped part of ring fd at addr (mmap at offset)
+    bool map(int fd, unsigned long long offset, unsigned long addr) {
+        Ring* ring = find(fd);
+        if (ring == nullptr) {
+            return false;
+        }
+        switch (offset) {
+            case IORING_OFF_SQ_RING:
+                ring->sq_ring = addr;
+                // One mapping holds both rings
+                if (ring->params.features & IORING_FEAT_SINGLE_MMAP) {
+                    ring->cq_ring = addr;
+                }
+                return true;
+            case IORING_OFF_CQ_RING:
+                ring->cq_ring = addr;
+                return true;
+            case IORING_OFF_SQES:
+                ring->sqes = addr;
+                return true;
+        }
+        return false;
+    }
+
+    // IORING_REGISTER_RING_FDS: tid can now enter ring fd by index
+    void register_index(pid_t tid, unsigned int index, int fd) {
+        auto it = by_fd.find(fd);
+        if (it != by_fd.end()) {
+            by_index[{tid, index}] = it->second;
+        }
+    }
+
+    void unregister_index(pid_t tid, unsigned int index) {
+        auto it = by_index.find({tid, index});
+        if (it != by_index.end()) {
+            int id = it->second;
+            by_index.erase(it);
+            release(id);
+        }
+    }
+
+    void close(int fd) {
+        auto it = by_fd.find(fd);
+        if (it != by_fd.end()) {
+            int id = it->second;
+            by_fd.erase(it);
+            release(id);
+        }
+    }
+
+    void close_range(unsigned int first, unsigned int last) {
+        std::vector<int> closed;
+        for (const auto& entry : by_fd) {
+            unsigned int fd = static_cast<unsigned int>(entry.first);
+            if (fd >= first && fd <= last) {
+                closed.push_back(entry.first);
+            }
+        }
+        for (int fd : closed) {
+            close(fd);
+        }
+    }
+
+    // Whether fd is a ring descriptor; rings are rare, so most mmap calls
+    // are passed over on this check alone
+    bool is_ring(int fd) const {
+        return !by_fd.empty() && by_fd.count(fd) != 0;
+    }
+
+    // Copy for a forked child: the rings and their mappings are inherited,
+    // the parent's submissions and registered indexes are not
+    RingTable inherited() const {
+        RingTable copy;
+        copy.rings = rings;
+        copy.by_fd = by_fd;
+        copy.next_id = next_id;
+        for (auto& entry : copy.rings) {
+            entry.second.in_flight.clear();
+        }
+        return copy;
+    }
+
+    // Visit every ring, for flushing in-flight submissions
+    template<typename Visitor>
+    void for_each(Visitor visit) {
+        for (auto& entry : rings) {
+            visit(entry.second);
+        }
+    }
+
+private:
+    std::unordered_map<int, Ring> rings;
+    std::unordered_map<int, int> by_fd;
+    std::map<std::pair<pid_t, unsigned int>, int> by_index;
+    int next_id = 0;
+
+    // Forget a ring nothing refers to any more, unless submissions still
+    // wait for their completions
+    void release(int id) {
+        for (const auto& entry : by_fd) {
+            if (entry.second == id) {
+                return;
+            }
+        }
+        for (const auto& entry : by_index) {
+            if (entry.second == id) {
+                return;
+            }
+        }
+        auto it = rings.find(id);
+        if (it != rings.end() && it->second.in_flight.empty()) {
+            rings.erase(it);
+        }
+    }
+};
+
+// Read count slots of size bytes from a ring of entries slots at base,
+// starting at position, into out; at most two reads, one per side of the
+// wrap-around
+inline bool read_slots(process_memory::ProcessMemoryReader& reader, pid_t pid, unsigned long base,
+                       size_t size, uint32_t entries, uint32_t position, uint32_t count, char* out) {
+    uint32_t first = position & (entries - 1);
+    uint32_t run = std::min(count, entries - first);
+    ssize_t want = static_cast<ssize_t>(run * size);
+    if (reader.read(pid, base + first * size, out, run * size) != want) {
+        return false;
+    }
+    if (count > run) {
+        want = static_cast<ssize_t>((count - run) * size);
+        if (reader.read(pid, base, out + run * size, (count - run) * size) != want) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Read a 32-bit ring index at addr
+inline bool read_index(process_memory::ProcessMemoryReader& reader, pid_t pid, unsigned long addr,
+                       uint32_t& value) {
+    return reader.read(pid, addr, &value, sizeof(value)) == static_cast<ssize_t>(sizeof(value));
+}
+
+// Read the entries io_uring_enter(to_submit) is about to consume: those
+// between the SQ head and tail, at most to_submit of them. cq_tail is set
+// to the CQ tail, which their completions will come after. Rings with an
+// SQ polling thread are not read: the kernel consumes their entries
+// without io_uring_enter.
+inline bool read_submissions(process_memory::ProcessMemoryReader& reader, pid_t pid, const Ring& ring,
+                             uint32_t to_submit, std::vector<struct io_uring_sqe>& sqes, uint32_t& cq_tail) {
+    sqes.clear();
+    const struct io_uring_params& params = ring.params;
+    if (!ring.mapped() || (params.flags & IORING_SETUP_SQPOLL) || to_submit == 0) {
+        return false;
+    }
+
+    // Head and tail sit within a few cache lines; read them together
+    uint32_t low = std::min(params.sq_off.head, params.sq_off.tail);
+    uint32_t high = std::max(params.sq_off.head, params.sq_off.tail) + sizeof(uint32_t);
+    char header[256];
+    if (high - low > sizeof(header) ||
+        reader.read(pid, ring.sq_ring + low, header, high - low) != static_cast<ssize_t>(high - low)) {
+        return false;
+    }
+    uint32_t head, tail;
+    std::memcpy(&head, header + (params.sq_off.head - low), sizeof(head));
+    std::memcpy(&tail, header + (params.sq_off.tail - low), sizeof(tail));
+    uint32_t count = std::min({to_submit, tail - head, params.sq_entries});
+    if (count == 0 || !read_index(reader, pid, ring.cq_ring + params.cq_off.tail, cq_tail)) {
+        return false;
+    }
+
+    // Which SQEs the pending slots name. Without the indirection array
+    // slot i is SQE i.
+    uint32_t mask = params.sq_entries - 1;
+    std::vector<uint32_t> indexes(count);
+    if (params.flags & IORING_SETUP_NO_SQARRAY) {
+        for (uint32_t i = 0; i < count; i++) {
+            indexes[i] = (head + i) & mask;
+        }
+    } else if (!read_slots(reader, pid, ring.sq_ring + params.sq_off.array, sizeof(uint32_t), params.sq_entries,
+                           head, count, reinterpret_cast<char*>(indexes.data()))) {
+        return false;
+    }
+
+    // Applications fill SQEs in ring order, so one or two reads usually
+    // cover them all; anything else is read entry by entry
+    size_t size = ring.sqe_size();
+    bool in_order = true;
+    for (uint32_t i = 0; i < count && in_order; i++) {
+        in_order = indexes[i] == ((indexes[0] + i) & mask);
+    }
+    std::vector<char> buffer(count * size);
+    if (in_order) {
+        if (!read_slots(reader, pid, ring.sqes, size, params.sq_entries, indexes[0], count, buffer.data())) {
+            return false;
+        }
+    } else {
+        for (uint32_t i = 0; i < count; i++) {
+            if (reader.read(pid, ring.sqes + (indexes[i] & mask) * size, buffer.data() + i * size, size) !=
+                static_cast<ssize_t>(size)) {
+                return false;
+            }
+        }
+    }
+    sqes.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        std::memcpy(&sqes[i], buffer.data() + i * size, sizeof(struct io_uring_sqe));
+    }
+    return true;
+}
+
+// Match completions posted since the last call against the ring's
+// submissions and hand each matched one to done(Submission&, true, res).
+// Completion entries stay in the ring after the application consumed them
+// until the kernel reuses the slot, so completions reaped without a
+// syscall are still seen. Submissions whose completion slot was reused
+// before it could be read are handed over with done(..., false, 0).
+template<typename Done>
+void reap_completions(process_memory::ProcessMemoryReader& reader, pid_t pid, Ring& ring, Done done) {
+    if (ring.in_flight.empty()) {
+        return;
+    }
+    const struct io_uring_params& params = ring.params;
+    uint32_t tail;
+    if (!read_index(reader, pid, ring.cq_ring + params.cq_off.tail, tail)) {
+        return;
+    }
+    uint32_t start = ring.cq_seen;
+    if (tail - start > params.cq_entries) {
+        start = tail - params.cq_entries;
+    }
+    uint32_t count = tail - start;
+    size_t size = ring.cqe_size();
+    std::vector<char> buffer(count * size);
+    if (count > 0 && !read_slots(reader, pid, ring.cq_ring + params.cq_off.cqes, size, params.cq_entries,
+                                 start, count, buffer.data())) {
+        return;
+    }
+    ring.cq_seen = tail;
+
+    for (uint32_t i = 0; i < count && !ring.in_flight.empty(); i++) {
+        struct io_uring_cqe cqe;
+        std::memcpy(&cqe, buffer.data() + i * size, sizeof(cqe));
+        uint32_t position = start + i;
+        auto it = std::find_if(ring.in_flight.begin(), ring.in_flight.end(), [&](const Submission& s) {
+            return s.user_data == cqe.user_data && static_cast<int32_t>(position - s.cq_tail) >= 0;
+        });
+        if (it != ring.in_flight.end()) {
+            done(*it, true, cqe.res);
+            ring.in_flight.erase(it);
+        }
+    }
+
+    auto lost = std::stable_partition(ring.in_flight.begin(), ring.in_flight.end(), [&](const Submission& s) {
+        return tail - s.cq_tail <= params.cq_entries;
+    });
+    for (auto it = lost; it != ring.in_flight.end(); ++it) {
+        done(*it, false, 0);
+    }
+    ring.in_flight.erase(lost, ring.in_flight.end());
+}
+
+// Start waiting for the completion of submission. A ring can have no more
+// completions outstanding than its CQ holds; past that the oldest are
+// handed to done(..., false, 0) rather than kept.
+template<typename Done>
+void track(Ring& ring, Submission submission, Done done) {
+    if (ring.in_flight.empty()) {
+        ring.cq_seen = submission.cq_tail;
+    }
+    while (ring.in_flight.size() >= ring.params.cq_entries) {
+        done(ring.in_flight.front(), false, 0);
+        ring.in_flight.erase(ring.in_flight.begin());
+    }
+    ring.in_flight.push_back(std::move(submission));
+}
+
+// Hand every submission still waiting to done(..., false, 0)
+template<typename Done>
+void flush(Ring& ring, Done done) {
+    for (Submission& submission : ring.in_flight) {
+        done(submission, false, 0);
+    }
+    ring.in_flight.clear();
+}
+
+} // namespace io_uring_tracker
+
+#endif // IO_URING_TRACKER_HPP
@@ -3,10 +3,17 @@
 #include <sys/wait.h>
 #include <sys/user.h>
 #include <sys/syscall.h>
-#include <sys/stat.h>
+#include <sys/mman.h>
+#include <linux/close_range.h>
+#include <sched.h>
 #include <fcntl.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/prctl.h>
 
 // Standard library headers
 #include <iostream>
@@ -19,6 +26,10 @@
 #include <map>
 #include <sstream>
 #include <mutex>
+#include <chrono>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
 
 // Third party libraries
 #include <cxxopts.hpp>
@@ -28,6 +39,23 @@
 #include "directory_tree.hpp"
 #include "html_generator.hpp"
 #include "logger.hpp"
+#include "seccomp_filter.hpp"
+#include "process_memory.hpp"
+#include "syscall_decoder.hpp"
+#include "syscall_table.hpp"
+#include "fd_table.hpp"
+#include "io_uring_tracker.hpp"
+#include "retry_queue.hpp"
+#include "tracer_events.hpp"
+#include "recording_trigger.hpp"
+#include "flight_recorder.hpp"
+#include "process_attach.hpp"
+#include "spsc_ring.hpp"
+#include "fanotify_backend.hpp"
+#include "ebpf_backend.hpp"
+#include "preload_backend.hpp"
+#include "notify_backend.hpp"
+#include "proc_sampler.hpp"
 
 // Version information
 #define FILETRACE_VERSION "1.0.0"
@@ -38,6 +66,23 @@ enum class ProcessType {
     THREAD
 };
 
+// Structure to store a syscall parked at entry until its exit stop
+struct PendingSyscall {
+    long nr;                // Syscall number, -1 if nothing is pending
+    syscall_table::Abi abi; // ABI nr belongs to
+    unsigned long args[6];  // Entry arguments
+    std::string path;       // Resolved (first) path argument
+    std::string second_path;  // Resolved second path of rename and link
+    unsigned long open_flags; // Flags of an open, for O_CLOEXEC
+};
+
+// Where a tracee is in its syscall cycle while stopped or running
+enum class TraceeState {
+    RUNNING,     // Outside a syscall; its next syscall stop is an entry
+    IN_SYSCALL,  // Between syscall-entry and syscall-exit stop
+    RETRYING     // Held in a stop until stop_retries services it again
+};
+
 // Structure to store thread information
 struct ThreadInfo {
     pid_t thread_id;
@@ -49,6 +94,21 @@ struct ThreadInfo {
     std::vector<pid_t> child_threads;
     time_t creation_time;
     int exit_status;
+    TraceeState state;
+    PendingSyscall pending;
+    std::shared_ptr<fd_table::FdTable> fds;  // Shared between CLONE_FILES tasks
+    std::shared_ptr<std::string> cwd;        // Shared between CLONE_FS tasks, empty if unknown
+    std::shared_ptr<io_uring_tracker::RingTable> rings;  // io_uring instances, shared like fds
+    bool preloaded;  // Opens are reported by the preload library, not syscall stops
+};
+
+// Enum to distinguish the outcome of a recorded file operation
+enum class OperationKind {
+    OPEN,        // An open returned a file descriptor
+    OPEN_FAILED, // An open failed
+    CLOSE_WRITE, // Closed after being written (fanotify backend)
+    SYSCALL,       // Another path syscall selected with --syscalls succeeded
+    SYSCALL_FAILED // ... or failed
 };
 
 // Structure to store file operation details
@@ -58,12 +118,131 @@ struct FileOperation {
     int sequence;
     pid_t thread_id;
     std::string thread_name;
-    bool is_actual_open;  // Distinguish between actual opens and execve lookups
+    OperationKind kind;
+    int fd;     // Descriptor returned by a successful open, -1 otherwise
+    int error;  // errno of a failed open, 0 otherwise
+    const char* syscall = nullptr;  // Name of a SYSCALL/SYSCALL_FAILED operation
 };
 
-// Global thread tracking map and mutex for thread-safe access
-std::map<pid_t, ThreadInfo> thread_map;
-std::mutex thread_map_mutex;
+// Operations handed from a tracing thread to its report worker. The
+// tracing thread only captures; filtering and tree building happen on the
+// worker while the tracee runs. Tracing state is per thread from here on:
+// ptrace ties each tracee to the thread that traces it, so the tracer
+// threads of a --jobs batch each keep their own.
+thread_local spsc_ring::SpscRing<FileOperation> operation_ring(1 << 14);
+thread_local std::atomic<bool> capture_done{false};
+
+// Thread tracking map and mutex for thread-safe access
+thread_local std::map<pid_t, ThreadInfo> thread_map;
+thread_local std::mutex thread_map_mutex;
+
+// Bulk reader for tracee memory, shared by the thread's tracees
+thread_local process_memory::ProcessMemoryReader memory_reader;
+
+// Part of a syscall stop a retry starts again from
+enum class StopStage {
+    DECODE,  // Read the stop's registers and handle the syscall
+    RESUME   // Handled; only the resume failed
+};
+
+struct StopRetry {
+    StopStage stage;
+    bool is_syscall_stop;  // PTRACE_SYSCALL stop rather than a seccomp stop
+    TraceeState state = TraceeState::RUNNING;  // The tracee's state when queued
+};
+
+// Stops waiting to be retried, and retries that ran out of attempts
+thread_local retry_queue::RetryQueue<StopRetry> stop_retries;
+thread_local unsigned long long abandoned_retries = 0;
+
+// Tracing mode: stop only on seccomp-filtered syscalls instead of every syscall
+bool use_seccomp_filter = false;
+
+// Syscall categories recorded, chosen with --syscalls
+uint32_t recorded_categories = syscall_table::default_categories;
+
+// Tracees were seized with --pid rather than launched by filetrace; they
+// are left running when filetrace stops tracing them
+bool attach_mode = false;
+
+// Set from SIGINT or the --duration alarm to end an attach session
+volatile sig_atomic_t detach_requested = 0;
+
+// Recording, or pass-through: tracees run without syscall stops and only
+// process creation and exec are followed, so that thread_map is current
+// when recording resumes. Switched with SIGUSR1 and --control-fifo.
+std::atomic<bool> recording{true};
+
+// Opens and execs that switch recording on and off, from --start-on-open,
+// --start-on-exec, --stop-on-open and --stop-on-exec. With a start-on-open
+// trigger, paused tracees keep their syscall stops so that opens can be
+// checked against it.
+recording_trigger::Triggers recording_triggers;
+
+// Flight recorder dumps asked for with SIGUSR2 or by a traced process
+// crashing; the report worker writes one per increment it sees
+std::atomic<unsigned int> flight_dumps_requested{0};
+
+// Preload backend: tracees whose image loads the preload library run
+// without syscall stops; the rest are traced as usual
+bool use_preload = false;
+std::string preload_library;
+std::string preload_ring_name;
+
+// Function to check whether a tracee's opens come from the preload library
+bool is_preloaded(pid_t pid) {
+    if (!use_preload) {
+        return false;
+    }
+    auto thread_it = thread_map.find(pid);
+    return thread_it != thread_map.end() && thread_it->second.preloaded;
+}
+
+// Function to get the ptrace options applied to every tracee
+long get_ptrace_options() {
+    long options = PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACEFORK | PTRACE_O_TRACEVFORK | PTRACE_O_TRACECLONE |
+                   PTRACE_O_TRACEEXIT | PTRACE_O_TRACEEXEC;
+    if (use_seccomp_filter) {
+        options |= PTRACE_O_TRACESECCOMP;
+    }
+    return options;
+}
+
+// Function to collect the argument tests of filtered syscalls that only
+// need a stop for some argument values
+std::vector<seccomp_filter::ArgumentTest> seccomp_argument_tests(const std::vector<long>& syscalls) {
+    std::vector<seccomp_filter::ArgumentTest> tests;
+    for (long nr : syscalls) {
+        const syscall_table::SyscallDescriptor& descriptor = syscall_table::describe(syscall_table::X86_64, nr);
+        if (descriptor.filter_arg >= 0) {
+            tests.push_back({nr, static_cast<unsigned int>(descriptor.filter_arg), descriptor.filter_bits});
+        }
+    }
+    return tests;
+}
+
+// Function to resume a stopped tracee until its next traced syscall,
+// optionally delivering a pending signal. want_exit also stops at the exit
+// of the current syscall when the seccomp pre-filter is active. Preloaded
+// tracees, and all tracees in pass-through, only stop for events and
+// signals, unless a start-on-open trigger is being watched for.
+long resume_tracee(pid_t pid, int sig = 0, bool want_exit = false) {
+    bool stop_at_syscalls = (!use_seccomp_filter && !is_preloaded(pid)) || want_exit;
+    if (!recording.load(std::memory_order_relaxed)) {
+        // The syscall in progress is not followed to its exit
+        bool watching = recording_triggers.watches_opens() && !is_preloaded(pid);
+        auto thread_it = thread_map.find(pid);
+        if (thread_it != thread_map.end() && thread_it->second.state == TraceeState::IN_SYSCALL) {
+            thread_it->second.pending.nr = -1;
+            if (!watching) {
+                thread_it->second.state = TraceeState::RUNNING;
+            }
+        }
+        stop_at_syscalls = watching && !use_seccomp_filter;
+    }
+    return ptrace(stop_at_syscalls ? PTRACE_SYSCALL : PTRACE_CONT, pid, nullptr,
+                  reinterpret_cast<void*>(static_cast<long>(sig)));
+}
 
 // Function to get thread name
 std::string get_thread_name(pid_t tid) {
@@ -79,6 +258,14 @@ std::string get_thread_name(pid_t tid) {
     return name;
 }
 
+// Function to get the path of the binary a process runs
+std::string get_executable_path(pid_t pid) {
+    std::string exe_link = "/proc/" + std::to_string(pid) + "/exe";
+    char buf[PATH_MAX];
+    ssize_t len = readlink(exe_link.c_str(), buf, sizeof(buf) - 1);
+    return len == -1 ? std::string() : std::string(buf, static_cast<size_t>(len));
+}
+
 // Function to handle thread creation
 void handle_thread_creation(pid_t parent_pid, pid_t thread_id, bool is_process = false) {
     // Enhanced thread/process creation handling
@@ -88,11 +275,19 @@ void handle_thread_creation(pid_t parent_pid, pid_t thread_id, bool is_process =
     auto existing_it = thread_map.find(thread_id);
     if (existing_it != thread_map.end()) {
         auto& existing = existing_it->second;
+        // A tracee whose first stop arrived before its creator's fork/clone
+        // event was registered without a parent; adopt it now
+        bool adopt = existing.parent_pid == 0 && parent_pid != 0;
+
         // Update existing thread info if needed
-        if (!existing.active) {
-            existing.active = true;
-            existing.exit_status = -1;
-            existing.creation_time = time(nullptr);
+        if (!existing.active || adopt) {
+            if (!existing.active) {
+                existing.active = true;
+                existing.exit_status = -1;
+                existing.creation_time = time(nullptr);
+                existing.state = TraceeState::RUNNING;
+                existing.pending.nr = -1;
+            }
             
             // Update parent relationship if changed
             if (existing.parent_pid != parent_pid) {
@@ -110,6 +305,16 @@ void handle_thread_creation(pid_t parent_pid, pid_t thread_id, bool is_process =
                     }
                 }
                 existing.parent_pid = parent_pid;
+                existing.process_type = is_process ? ProcessType::PROCESS : ProcessType::THREAD;
+
+                // Add to new parent's children list
+                auto new_parent_it = thread_map.find(parent_pid);
+                if (new_parent_it != thread_map.end()) {
+                    auto& children = is_process ?
+                        new_parent_it->second.child_processes :
+                        new_parent_it->second.child_threads;
+                    children.push_back(thread_id);
+                }
             }
         }
         return;
@@ -123,6 +328,12 @@ void handle_thread_creation(pid_t parent_pid, pid_t thread_id, bool is_process =
     info.process_type = is_process ? ProcessType::PROCESS : ProcessType::THREAD;
     info.creation_time = time(nullptr);
     info.exit_status = -1;
+    info.state = TraceeState::RUNNING;
+    info.pending.nr = -1;
+    info.fds = std::make_shared<fd_table::FdTable>();
+    info.cwd = std::make_shared<std::string>();
+    info.rings = std::make_shared<io_uring_tracker::RingTable>();
+    info.preloaded = false;
     
     // Initialize empty vectors for child processes and threads
     info.child_processes = std::vector<pid_t>();
@@ -147,6 +358,12 @@ void handle_thread_creation(pid_t parent_pid, pid_t thread_id, bool is_process =
             parent_info.process_type = ProcessType::PROCESS;
             parent_info.creation_time = time(nullptr);
             parent_info.exit_status = -1;
+            parent_info.state = TraceeState::RUNNING;
+            parent_info.pending.nr = -1;
+            parent_info.fds = std::make_shared<fd_table::FdTable>();
+            parent_info.cwd = std::make_shared<std::string>();
+            parent_info.rings = std::make_shared<io_uring_tracker::RingTable>();
+            parent_info.preloaded = false;
             parent_info.child_processes = is_process ? 
                 std::vector<pid_t>{thread_id} : std::vector<pid_t>();
             parent_info.child_threads = is_process ? 
@@ -176,12 +393,13 @@ void handle_thread_exit(pid_t thread_id, int exit_status = 0) {
 
     thread_info.active = false;
     thread_info.exit_status = exit_status;
+    stop_retries.cancel(thread_id);
     
     // Recursively handle cleanup of child processes/threads
     for (pid_t child_pid : thread_info.child_processes) {
         if (thread_map.find(child_pid) != thread_map.end() && thread_map[child_pid].active) {
             // For processes, we need to ensure they're properly terminated
-            if (thread_map[child_pid].process_type == ProcessType::PROCESS) {
+            if (thread_map[child_pid].process_type == ProcessType::PROCESS && !attach_mode) {
                 kill(child_pid, SIGTERM);
             }
             handle_thread_exit(child_pid, -1);
@@ -197,12 +415,42 @@ void handle_thread_exit(pid_t thread_id, int exit_status = 0) {
 
     // Clean up ptrace attachment if needed
     ptrace(PTRACE_DETACH, thread_id, nullptr, nullptr);
+    memory_reader.forget(thread_id);
+}
+
+// Function to get a tracee's working directory. It is read from
+// /proc/<pid>/cwd once and then followed through chdir/fchdir.
+std::string tracee_cwd(pid_t pid) {
+    auto thread_it = thread_map.find(pid);
+    if (thread_it != thread_map.end() && !thread_it->second.cwd->empty()) {
+        return *thread_it->second.cwd;
+    }
+
+    std::string cwd_link = "/proc/" + std::to_string(pid) + "/cwd";
+    char buf[PATH_MAX];
+    ssize_t len = readlink(cwd_link.c_str(), buf, sizeof(buf) - 1);
+    if (len == -1) {
+        return "";
+    }
+    std::string result(buf, len);
+    if (thread_it != thread_map.end()) {
+        *thread_it->second.cwd = result;
+    }
+    return result;
 }
 
-// Function to resolve file descriptor path
+// Function to resolve file descriptor path. The tracee's descriptor table
+// answers most lookups; /proc/<pid>/fd is only read when the table misses.
 std::string resolve_fd_path(pid_t pid, int fd) {
     if (fd == AT_FDCWD) {
-        return ".";
+        return tracee_cwd(pid);
+    }
+
+    auto thread_it = thread_map.find(pid);
+    if (thread_it != thread_map.end()) {
+        if (const std::string* path = thread_it->second.fds->find(fd)) {
+            return *path;
+        }
     }
 
     std::stringstream fd_path;
@@ -215,7 +463,36 @@ std::string resolve_fd_path(pid_t pid, int fd) {
     }
     
     buf[len] = '\0';
-    return std::string(buf);
+    std::string result(buf);
+
+    // Remember filesystem paths so the next lookup of this descriptor hits
+    if (thread_it != thread_map.end() && result[0] == '/') {
+        thread_it->second.fds->set(fd, result, false);
+    }
+    return result;
+}
+
+// Function to get the flags of the clone/clone3 a creation event is
+// reported for; fork and vfork share neither files nor fs and yield 0
+unsigned long long get_clone_flags(pid_t pid) {
+    struct user_regs_struct regs;
+    if (ptrace(PTRACE_GETREGS, pid, nullptr, &regs) == -1) {
+        return 0;
+    }
+    unsigned long long flags = 0;
+    // 32-bit callers pass the first argument in ebx
+    bool compat = syscall_decoder::abi_of(regs) == syscall_table::I386;
+    long nr = compat ? static_cast<int32_t>(regs.orig_rax) : static_cast<long>(regs.orig_rax);
+    unsigned long long first_arg = compat ? static_cast<uint32_t>(regs.rbx) : regs.rdi;
+    if (nr == (compat ? syscall_table::nr_i386::clone : SYS_clone)) {
+        flags = first_arg;
+    } else if (nr == (compat ? syscall_table::nr_i386::clone3 : SYS_clone3)) {
+        // struct clone_args starts with the 64-bit flags field
+        if (memory_reader.read(pid, first_arg, &flags, sizeof(flags)) != sizeof(flags)) {
+            return 0;
+        }
+    }
+    return flags;
 }
 
 // Function to resolve relative path for openat
@@ -229,231 +506,2080 @@ std::string resolve_relative_path(const std::string& base_path, const std::strin
         resolved += "/";
     }
     resolved += relative_path;
-    return path_utils::normalize_path(resolved);
+    return path_utils::lexical_normalize(resolved);
 }
 
 // Function to safely read string from process memory
 std::string read_process_string(pid_t pid, unsigned long addr) {
-    char buffer[4096];
-    size_t i = 0;
-    union {
-        long val;
-        char chars[sizeof(long)];
-    } data;
-
-    while (i < sizeof(buffer) - sizeof(long)) {
-        errno = 0;
-        data.val = ptrace(PTRACE_PEEKDATA, pid, addr + i, nullptr);
-        if (errno != 0) {
-            break;
+    std::string result;
+    if (!memory_reader.read_string(pid, addr, result)) {
+        Logger::debug("Failed to read path from ", pid, " (unreadable or longer than PATH_MAX)");
+        return "";
+    }
+    return result;
+}
+
+// Function to park a syscall until its exit stop reports the result
+void park_syscall(ThreadInfo& thread, const syscall_decoder::SyscallStop& stop,
+                  const std::string& path = "") {
+    thread.pending.nr = stop.nr;
+    thread.pending.abi = stop.abi;
+    std::copy(std::begin(stop.args), std::end(stop.args), std::begin(thread.pending.args));
+    thread.pending.path = path;
+}
+
+// Function to read a path from tracee memory and make it absolute against
+// a directory descriptor or the tracee's working directory
+std::string read_path_at(pid_t pid, unsigned long addr, int dirfd) {
+    std::string path = read_process_string(pid, addr);
+    if (!path.empty() && path[0] != '/') {
+        std::string base_path = resolve_fd_path(pid, dirfd);
+        if (!base_path.empty()) {
+            path = resolve_relative_path(base_path, path);
+        }
+    }
+    return path;
+}
+
+// Function to read a path argument of a syscall
+std::string read_path_argument(pid_t pid, const syscall_decoder::SyscallStop& stop,
+                               const syscall_table::PathArg& arg) {
+    int dirfd = arg.dirfd >= 0 ? static_cast<int>(stop.args[arg.dirfd]) : AT_FDCWD;
+    return read_path_at(pid, stop.args[arg.path], dirfd);
+}
+
+// Function to hand a recorded path syscall to the report worker
+void push_operation(pid_t pid, const ThreadInfo& thread, std::string path, const char* syscall,
+                    const syscall_decoder::SyscallStop& stop) {
+    FileOperation op;
+    op.pid = pid;
+    op.path = std::move(path);
+    op.sequence = 0;  // Numbered by the report worker once filtered
+    op.thread_id = pid;
+    op.thread_name = thread.name;
+    op.syscall = syscall;
+    if (stop.is_error) {
+        op.kind = syscall != nullptr ? OperationKind::SYSCALL_FAILED : OperationKind::OPEN_FAILED;
+        op.fd = -1;
+        op.error = static_cast<int>(-stop.ret);
+    } else {
+        op.kind = syscall != nullptr ? OperationKind::SYSCALL : OperationKind::OPEN;
+        op.fd = syscall != nullptr ? -1 : static_cast<int>(stop.ret);
+        op.error = 0;
+    }
+
+    // The ring only fills up if the worker falls behind; wait for it
+    // rather than drop the operation
+    while (!operation_ring.try_push(std::move(op))) {
+        std::this_thread::yield();
+    }
+}
+
+// Function to record an operation submitted through io_uring once its
+// completion was read (known) or can no longer be. Opens with an unknown
+// result are recorded like the seccomp-notify backend's, without a
+// descriptor.
+void push_ring_operation(io_uring_tracker::Submission& submission, bool known, int32_t res) {
+    auto thread_it = thread_map.find(submission.tid);
+    if (thread_it == thread_map.end()) {
+        return;
+    }
+    ThreadInfo& thread = thread_it->second;
+    syscall_decoder::SyscallStop result;
+    result.is_error = known && res < 0;
+    result.ret = known ? res : -1;
+    if (submission.op->category == syscall_table::OPEN) {
+        if (submission.fixed_slot && !result.is_error) {
+            result.ret = -1;
+        } else if (known && res >= 0) {
+            thread.fds->set(res, submission.path, (submission.open_flags & O_CLOEXEC) != 0);
         }
+        push_operation(submission.tid, thread, std::move(submission.path), nullptr, result);
+        return;
+    }
+    if (!submission.path.empty()) {
+        push_operation(submission.tid, thread, std::move(submission.path), submission.op->name, result);
+    }
+    if (!submission.second_path.empty()) {
+        push_operation(submission.tid, thread, std::move(submission.second_path), submission.op->name, result);
+    }
+}
+
+// Function to record the ring operations whose completions were posted
+void reap_ring(pid_t pid, io_uring_tracker::Ring& ring) {
+    io_uring_tracker::reap_completions(memory_reader, pid, ring, push_ring_operation);
+}
+
+// Function to record every ring operation still waiting for its completion
+void flush_rings(io_uring_tracker::RingTable& rings) {
+    rings.for_each([](io_uring_tracker::Ring& ring) {
+        io_uring_tracker::flush(ring, push_ring_operation);
+    });
+}
 
-        for (size_t j = 0; j < sizeof(long) && i + j < sizeof(buffer) - 1; j++) {
-            buffer[i + j] = data.chars[j];
-            if (data.chars[j] == '\0') {
-                return std::string(buffer);
+// Function to get an io_uring_register opcode without the flag marking
+// a registered ring index in place of the ring descriptor
+unsigned int ring_register_opcode(unsigned long arg) {
+    return static_cast<unsigned int>(arg) & ~(1U << 31);
+}
+
+// Function to find the ring an io_uring_enter call names, by descriptor
+// or by registered index
+io_uring_tracker::Ring* find_ring(pid_t pid, ThreadInfo& thread, const unsigned long args[6], bool registered) {
+    int fd = static_cast<int>(args[0]);
+    return registered ? thread.rings->find_registered(pid, static_cast<unsigned int>(fd)) : thread.rings->find(fd);
+}
+
+// Function to read the operations an io_uring_enter submits. Path
+// operations in the recorded categories wait on their ring until their
+// completions show the result.
+void submit_ring_operations(pid_t pid, io_uring_tracker::Ring& ring, uint32_t to_submit) {
+    std::vector<struct io_uring_sqe> sqes;
+    uint32_t cq_tail;
+    if (!io_uring_tracker::read_submissions(memory_reader, pid, ring, to_submit, sqes, cq_tail)) {
+        return;
+    }
+    for (const struct io_uring_sqe& sqe : sqes) {
+        const io_uring_tracker::OpDescriptor* op = io_uring_tracker::describe_op(sqe.opcode);
+        if (op == nullptr || !(op->category & recorded_categories)) {
+            continue;
+        }
+        io_uring_tracker::Submission submission;
+        submission.tid = pid;
+        submission.user_data = sqe.user_data;
+        submission.op = op;
+        std::string* paths[2] = {&submission.path, &submission.second_path};
+        for (int i = 0; i < 2; i++) {
+            const io_uring_tracker::SqePath& arg = op->paths[i];
+            if (arg.path != io_uring_tracker::Field::NONE) {
+                *paths[i] = read_path_at(pid, io_uring_tracker::field(sqe, arg.path),
+                                         static_cast<int>(io_uring_tracker::field(sqe, arg.dirfd)));
+            }
+        }
+        if (submission.path.empty() && submission.second_path.empty()) {
+            continue;
+        }
+        submission.open_flags = sqe.open_flags;
+        if (op->how) {
+            // struct open_how starts with the 64-bit flags field
+            uint64_t flags;
+            if (memory_reader.read(pid, sqe.addr2, &flags, sizeof(flags)) == sizeof(flags)) {
+                submission.open_flags = flags;
             }
         }
-        i += sizeof(long);
+        submission.fixed_slot = op->category == syscall_table::OPEN && sqe.file_index != 0;
+        submission.cq_tail = cq_tail;
+        io_uring_tracker::track(ring, std::move(submission), push_ring_operation);
     }
-    buffer[i] = '\0';
-    return std::string(buffer);
 }
 
-// Function to handle system call entry
-void handle_syscall_entry(pid_t pid, const user_regs_struct& regs, std::vector<FileOperation>& operations, const std::string& base_dir = "") {
-    // Handle clone/fork syscalls for thread tracking
-    if (regs.orig_rax == SYS_clone || regs.orig_rax == SYS_fork || regs.orig_rax == SYS_vfork) {
-        // Wait for the clone syscall to complete
-        if (ptrace(PTRACE_SYSCALL, pid, nullptr, nullptr) == -1) {
-            Logger::error("Failed to continue process for clone: ", strerror(errno));
+// Function to handle system call entry. The syscall table says what each
+// syscall needs; anything it does not describe, or in a category that is
+// not recorded, is passed over.
+void handle_syscall_entry(pid_t pid, const syscall_decoder::SyscallStop& stop) {
+    const syscall_table::SyscallDescriptor& descriptor = syscall_table::describe(stop.abi, stop.nr);
+    if (!syscall_table::is_traced(descriptor, recorded_categories)) {
+        return;
+    }
+    if (thread_map.find(pid) == thread_map.end()) {
+        // If thread not in map, create new entry
+        handle_thread_creation(pid, pid);
+    }
+    ThreadInfo& thread = thread_map[pid];
+    fd_table::FdTable& fds = *thread.fds;
+
+    switch (descriptor.handling) {
+        // Descriptor table maintenance. close releases the descriptor even
+        // when it fails, so it is applied at entry; the dup family only
+        // knows its new descriptor at exit.
+        case syscall_table::Handling::CLOSE: {
+            int fd = static_cast<int>(stop.args[0]);
+            fds.close(fd);
+            if (io_uring_tracker::Ring* ring = thread.rings->is_ring(fd) ? thread.rings->find(fd) : nullptr) {
+                // Last chance to read completions the application reaped
+                // from the ring without entering the kernel
+                reap_ring(pid, *ring);
+                thread.rings->close(fd);
+            }
             return;
         }
-        
-        int status;
-        if (waitpid(pid, &status, 0) == -1) {
-            Logger::error("Failed to wait for clone: ", strerror(errno));
+        case syscall_table::Handling::CLOSE_RANGE: {
+            unsigned int flags = static_cast<unsigned int>(stop.args[2]);
+            if (flags & CLOSE_RANGE_UNSHARE) {
+                thread.fds = std::make_shared<fd_table::FdTable>(fds);
+            }
+            thread.fds->close_range(static_cast<unsigned int>(stop.args[0]),
+                                    static_cast<unsigned int>(stop.args[1]),
+                                    (flags & CLOSE_RANGE_CLOEXEC) != 0);
+            if (!(flags & CLOSE_RANGE_CLOEXEC)) {
+                thread.rings->close_range(static_cast<unsigned int>(stop.args[0]),
+                                          static_cast<unsigned int>(stop.args[1]));
+            }
             return;
         }
-
-        // Get the return value (new thread ID) from RAX register
-        struct user_regs_struct post_regs;
-        if (ptrace(PTRACE_GETREGS, pid, nullptr, &post_regs) == -1) {
-            Logger::error("Failed to get registers after clone: ", strerror(errno));
-        } else {
-            long new_tid = post_regs.rax;
-            if (new_tid > 0) {
-                // Check if this is a fork/vfork or a thread creation
-                bool is_process = (regs.orig_rax == SYS_fork || regs.orig_rax == SYS_vfork) || 
-                                ((regs.orig_rax == SYS_clone) && (regs.rdi & CLONE_THREAD) == 0);
-                handle_thread_creation(pid, new_tid, is_process);
+        case syscall_table::Handling::FCNTL: {
+            int cmd = static_cast<int>(stop.args[1]);
+            if (cmd == F_SETFD) {
+                fds.set_cloexec(static_cast<int>(stop.args[0]), (stop.args[2] & FD_CLOEXEC) != 0);
+            } else if (cmd == F_DUPFD || cmd == F_DUPFD_CLOEXEC) {
+                park_syscall(thread, stop);
             }
+            return;
         }
+        case syscall_table::Handling::DUP:
+            park_syscall(thread, stop);
+            return;
+
+        // Working directory changes, applied at exit if they succeed
+        case syscall_table::Handling::CHDIR:
+            park_syscall(thread, stop, read_path_argument(pid, stop, descriptor.paths[0]));
+            return;
+        case syscall_table::Handling::FCHDIR:
+            park_syscall(thread, stop, resolve_fd_path(pid, static_cast<int>(stop.args[0])));
+            return;
 
-        // Resume execution
-        if (ptrace(PTRACE_SYSCALL, pid, nullptr, nullptr) == -1) {
-            Logger::error("Failed to resume after clone: ", strerror(errno));
+        // io_uring rings: their layout is known once io_uring_setup
+        // returns and their addresses once they are mapped
+        case syscall_table::Handling::URING_SETUP:
+            park_syscall(thread, stop);
+            return;
+        case syscall_table::Handling::URING_REGISTER: {
+            unsigned int opcode = ring_register_opcode(stop.args[1]);
+            if (opcode == IORING_REGISTER_RING_FDS || opcode == IORING_UNREGISTER_RING_FDS) {
+                park_syscall(thread, stop);
+            }
+            return;
+        }
+        case syscall_table::Handling::MMAP: {
+            unsigned long offset = stop.args[5];
+            if ((stop.args[3] & MAP_SHARED) && thread.rings->is_ring(static_cast<int>(stop.args[4])) &&
+                (offset == IORING_OFF_SQ_RING || offset == IORING_OFF_CQ_RING || offset == IORING_OFF_SQES)) {
+                park_syscall(thread, stop);
+            }
+            return;
         }
+        case syscall_table::Handling::URING_ENTER: {
+            unsigned int flags = static_cast<unsigned int>(stop.args[3]);
+            io_uring_tracker::Ring* ring = find_ring(pid, thread, stop.args,
+                                                     (flags & IORING_ENTER_REGISTERED_RING) != 0);
+            if (ring == nullptr || !ring->mapped()) {
+                return;
+            }
+            // Completions posted since the last call first, so that a
+            // reused user_data cannot match the wrong submission
+            reap_ring(pid, *ring);
+            submit_ring_operations(pid, *ring, static_cast<uint32_t>(stop.args[1]));
+            // The exit sees completions the call waited for
+            if (!ring->in_flight.empty()) {
+                park_syscall(thread, stop);
+            }
+            return;
+        }
+
+        case syscall_table::Handling::PATH:
+            break;
+        case syscall_table::Handling::IGNORE:
+            return;
     }
-    
-    // Handle thread/process exit
-    if (regs.orig_rax == SYS_exit || regs.orig_rax == SYS_exit_group) {
-        int exit_status = regs.rdi;  // First argument contains the exit status
-        handle_thread_exit(pid, exit_status);
+
+    // Path syscalls are parked with their paths captured as resolved
+    // here; the report worker normalizes any that are still relative and
+    // applies the base directory filter
+    std::string filepath = read_path_argument(pid, stop, descriptor.paths[0]);
+    std::string second_path;
+    if (descriptor.paths[1].path >= 0) {
+        second_path = read_path_argument(pid, stop, descriptor.paths[1]);
     }
-    
-    // Handle file operations
-    if (regs.orig_rax == SYS_open || regs.orig_rax == SYS_openat || regs.orig_rax == SYS_execve) {
-        std::string filepath;
-        
-        try {
-            if (regs.orig_rax == SYS_open) {
-                filepath = read_process_string(pid, regs.rdi);
-            } else if (regs.orig_rax == SYS_execve) {
-                filepath = read_process_string(pid, regs.rdi);
-            } else { // SYS_openat
-                int dirfd = regs.rdi;
-                filepath = read_process_string(pid, regs.rsi);
-                
-                // Handle relative paths in openat
-                if (!filepath.empty() && filepath[0] != '/') {
-                    std::string base_path = resolve_fd_path(pid, dirfd);
-                    if (!base_path.empty()) {
-                        filepath = resolve_relative_path(base_path, filepath);
-                    }
+    if (filepath.empty() && second_path.empty()) {
+        return;
+    }
+    park_syscall(thread, stop, filepath);
+    thread.pending.second_path = std::move(second_path);
+    thread.pending.open_flags = descriptor.flags_arg >= 0 ? stop.args[descriptor.flags_arg] : 0;
+    if (descriptor.how_arg >= 0) {
+        // struct open_how starts with the 64-bit flags field
+        uint64_t flags;
+        if (memory_reader.read(pid, stop.args[descriptor.how_arg], &flags, sizeof(flags)) == sizeof(flags)) {
+            thread.pending.open_flags = flags;
+        }
+    }
+}
+
+// Function to handle system call exit for a syscall parked at entry
+void handle_syscall_exit(pid_t pid, ThreadInfo& thread, const syscall_decoder::SyscallStop& stop) {
+    PendingSyscall pending = std::move(thread.pending);
+    thread.pending.nr = -1;
+    fd_table::FdTable& fds = *thread.fds;
+    const syscall_table::SyscallDescriptor& descriptor = syscall_table::describe(pending.abi, pending.nr);
+
+    switch (descriptor.handling) {
+        case syscall_table::Handling::CHDIR:
+        case syscall_table::Handling::FCHDIR:
+            if (!stop.is_error && !pending.path.empty() && pending.path[0] == '/') {
+                *thread.cwd = pending.path;
+            } else if (!stop.is_error) {
+                // Unknown target; re-read /proc/<pid>/cwd on next use
+                thread.cwd->clear();
+            }
+            if (descriptor.handling == syscall_table::Handling::CHDIR &&
+                (recorded_categories & syscall_table::CHDIR) && !pending.path.empty()) {
+                push_operation(pid, thread, std::move(pending.path), descriptor.name, stop);
+            }
+            return;
+
+        case syscall_table::Handling::DUP:
+        case syscall_table::Handling::FCNTL:
+            if (!stop.is_error) {
+                bool cloexec = descriptor.handling == syscall_table::Handling::FCNTL ?
+                               static_cast<int>(pending.args[1]) == F_DUPFD_CLOEXEC :
+                               descriptor.flags_arg >= 0 && (pending.args[descriptor.flags_arg] & O_CLOEXEC);
+                fds.duplicate(static_cast<int>(pending.args[0]), static_cast<int>(stop.ret), cloexec);
+            }
+            return;
+
+        case syscall_table::Handling::URING_SETUP:
+            if (!stop.is_error) {
+                struct io_uring_params params;
+                if (memory_reader.read(pid, pending.args[1], &params, sizeof(params)) == sizeof(params)) {
+                    thread.rings->add(static_cast<int>(stop.ret), params);
                 }
             }
-        } catch (const std::exception& e) {
-            Logger::error("Failed to read file path from process memory: ", e.what());
             return;
-        }
-        
-        if (!filepath.empty()) {
-            // Normalize the filepath
-            std::string normalized_path = path_utils::normalize_path(filepath);
-            
-            // Skip if base_dir is specified and path is not within it
-            if (!path_utils::disable_directory_filtering && !base_dir.empty()) {
-                Logger::debug("Checking path: ", normalized_path, " against base: ", base_dir);
-                if (!path_utils::is_within_directory(normalized_path, base_dir)) {
-                    Logger::debug("Skipping file outside base directory: ", normalized_path);
+
+        case syscall_table::Handling::URING_REGISTER:
+            if (!stop.is_error) {
+                // The kernel wrote back the index it picked for each
+                // descriptor; ret says how many entries it processed
+                unsigned int opcode = ring_register_opcode(pending.args[1]);
+                std::vector<struct io_uring_rsrc_update> updates(
+                    std::min(static_cast<unsigned int>(stop.ret), io_uring_tracker::max_registered_rings));
+                size_t size = updates.size() * sizeof(updates[0]);
+                if (memory_reader.read(pid, pending.args[2], updates.data(), size) != static_cast<ssize_t>(size)) {
                     return;
                 }
-            }
-            
-            // Only record actual file opens, not execve lookups
-            if (regs.orig_rax != SYS_execve) {
-                // Check if file exists before adding to tracking
-                struct stat file_stat;
-                if (stat(normalized_path.c_str(), &file_stat) == 0) {
-                    FileOperation op;
-                    op.pid = pid;
-                    op.path = normalized_path;
-                    op.sequence = operations.size() + 1;
-                    op.thread_id = pid;
-                    op.is_actual_open = true;  // This is an actual open operation
-                    
-                    // Get thread name from thread map
-                    if (thread_map.find(pid) != thread_map.end()) {
-                        op.thread_name = thread_map[pid].name;
+                for (const auto& update : updates) {
+                    if (opcode == IORING_REGISTER_RING_FDS) {
+                        thread.rings->register_index(pid, update.offset, static_cast<int>(update.data));
                     } else {
-                        // If thread not in map, create new entry
-                        handle_thread_creation(pid, pid);
-                        op.thread_name = thread_map[pid].name;
+                        thread.rings->unregister_index(pid, update.offset);
                     }
-                    
-                    Logger::debug("Adding file operation: ", op.path, " [", op.sequence, "]");
-                    operations.push_back(op);
-                } else {
-                    Logger::debug("Skipping non-existent file: ", normalized_path);
                 }
             }
+            return;
+
+        case syscall_table::Handling::MMAP:
+            if (!stop.is_error) {
+                thread.rings->map(static_cast<int>(pending.args[4]), pending.args[5],
+                                  static_cast<unsigned long>(stop.ret));
+            }
+            return;
+
+        case syscall_table::Handling::URING_ENTER: {
+            unsigned int flags = static_cast<unsigned int>(pending.args[3]);
+            io_uring_tracker::Ring* ring = find_ring(pid, thread, pending.args,
+                                                     (flags & IORING_ENTER_REGISTERED_RING) != 0);
+            if (ring != nullptr) {
+                reap_ring(pid, *ring);
+            }
+            return;
+        }
+
+        case syscall_table::Handling::PATH:
+            break;
+        default:
+            return;
+    }
+
+    if (descriptor.category == syscall_table::OPEN) {
+        // The descriptor table learns every successful open
+        if (!stop.is_error) {
+            fds.set(static_cast<int>(stop.ret), pending.path, (pending.open_flags & O_CLOEXEC) != 0);
         }
+        // The open that matches a stop trigger is the last one recorded
+        if (recording_triggers.stops_on_open(pending.path)) {
+            Logger::info("Stop trigger: thread ", pid, " opens ", pending.path);
+            recording.store(false);
+        }
+        push_operation(pid, thread, std::move(pending.path), nullptr, stop);
+        return;
+    }
+    if (!pending.path.empty()) {
+        push_operation(pid, thread, std::move(pending.path), descriptor.name, stop);
+    }
+    if (!pending.second_path.empty()) {
+        push_operation(pid, thread, std::move(pending.second_path), descriptor.name, stop);
     }
 }
 
-// Function to generate HTML visualization
-void generate_html_output(const std::vector<FileOperation>& operations, const std::string& output_file) {
-    // Create directory tree
-    DirectoryTree dir_tree;
-    Logger::info("Generating HTML output with ", operations.size(), " operations:");
-    for (const auto& op : operations) {
-        Logger::debug("  - ", op.path, " [", op.sequence, "]");
-        dir_tree.insert_file(op.path, op.sequence, op.thread_id, op.thread_name);
+// Function to forget a tracee's descriptor table and working directory.
+// Nothing is followed while recording is paused, so both are read from
+// /proc again when next needed. Tables shared with other tasks are
+// cleared in place and stay shared.
+void forget_followed_state(ThreadInfo& thread) {
+    *thread.fds = fd_table::FdTable();
+    thread.cwd->clear();
+}
+
+// Function to forget what was followed of every tracee of the calling
+// thread, once recording resumes after a pause
+void forget_followed_state() {
+    for (auto& thread : thread_map) {
+        forget_followed_state(thread.second);
     }
-    
-    // Generate HTML using the HtmlGenerator
-    if (!HtmlGenerator::generate_html_report(dir_tree, output_file)) {
-        Logger::error("Failed to generate HTML report: ", HtmlGenerator::get_last_error());
+}
+
+// Function to check the open a paused tracee is entering against the
+// start-on-open triggers, and start recording if one matches. The path is
+// resolved as the entry handler resolves it, so that start and stop
+// triggers see the same path; nothing was followed while paused, so its
+// directory and descriptors come from /proc.
+bool start_on_open(pid_t pid, ThreadInfo& thread, const syscall_decoder::SyscallStop& stop) {
+    const syscall_table::SyscallDescriptor& descriptor = syscall_table::describe(stop.abi, stop.nr);
+    if (descriptor.category != syscall_table::OPEN || descriptor.handling != syscall_table::Handling::PATH) {
+        return false;
+    }
+    forget_followed_state(thread);
+    std::string path = read_path_argument(pid, stop, descriptor.paths[0]);
+    if (path.empty() || !recording_triggers.starts_on_open(path)) {
+        return false;
     }
+    Logger::info("Start trigger: thread ", pid, " opens ", path);
+    recording.store(true);
+    return true;
 }
 
-// Function to validate output file path
-bool validate_output_file(const std::string& path) {
-    try {
-        // Check if path is empty
-        if (path.empty()) {
-            Logger::error("Output file path cannot be empty");
-            return false;
-        }
+// Outcome of one attempt to service a syscall stop
+enum class StopOutcome {
+    DONE,    // The tracee runs again
+    RETRY,   // The kernel refused for now (EINVAL/EIO); try again later
+    GONE,    // The tracee died; waitpid reports it
+    FAILED   // Unrecoverable; the tracee is given up
+};
 
-        // Create filesystem path and extract parent directory
-        std::filesystem::path fs_path(path);
-        std::filesystem::path parent_path = fs_path.parent_path();
-        
-        // Handle empty parent path (current directory)
-        if (parent_path.empty()) {
-            parent_path = std::filesystem::current_path();
-            Logger::debug("Using current directory as parent path");
-        }
+// Function to decode and handle a syscall stop
+StopOutcome decode_syscall_stop(pid_t pid, ThreadInfo& thread, bool is_syscall_stop) {
+    // Exit stops are only decoded when an entry parked a result to
+    // record. A preloaded tracee only gets here before it is known
+    // to be preloaded; the library reports this syscall.
+    // In pass-through a stop is only resumed, or checked for a start
+    // trigger; a seccomp stop cannot be avoided, the filter was installed
+    // by the tracee itself.
+    bool in_syscall = thread.state == TraceeState::IN_SYSCALL;
+    bool paused = !recording.load(std::memory_order_relaxed);
+    if ((paused && !recording_triggers.watches_opens()) || thread.preloaded ||
+        (is_syscall_stop && in_syscall && thread.pending.nr == -1)) {
+        thread.state = TraceeState::RUNNING;
+        return StopOutcome::DONE;
+    }
 
-        // Check if parent directory exists
-        if (!std::filesystem::exists(parent_path)) {
-            Logger::error("Parent directory does not exist: ", parent_path.string());
-            return false;
+    syscall_decoder::SyscallStop stop;
+    if (!syscall_decoder::fetch(pid, in_syscall, stop)) {
+        if (errno == ESRCH) {
+            Logger::debug("Thread ", pid, " terminated during syscall decoding");
+            return StopOutcome::GONE;
         }
-
-        // Verify parent path is a directory
-        if (!std::filesystem::is_directory(parent_path)) {
-            Logger::error("Parent path is not a directory: ", parent_path.string());
-            return false;
+        if (errno == EINVAL) {
+            Logger::warning("Invalid thread state for ", pid);
+            return StopOutcome::RETRY;
         }
+        Logger::error("Failed to decode syscall for thread ", pid, ": ", strerror(errno));
+        return StopOutcome::FAILED;
+    }
 
-        // Check directory permissions using filesystem status
-        try {
-            auto perms = std::filesystem::status(parent_path).permissions();
-            if ((perms & std::filesystem::perms::owner_write) == std::filesystem::perms::none &&
-                (perms & std::filesystem::perms::group_write) == std::filesystem::perms::none &&
-                (perms & std::filesystem::perms::others_write) == std::filesystem::perms::none) {
-                Logger::error("Parent directory is not writable: ", parent_path.string());
-                return false;
-            }
-        } catch (const std::filesystem::filesystem_error& e) {
-            Logger::error("Failed to check directory permissions: ", e.what());
-            return false;
+    // Paused: only the path of an open is looked at, and the open that
+    // matches a start trigger is the first one recorded
+    if (paused) {
+        thread.pending.nr = -1;
+        if (!stop.is_entry || !start_on_open(pid, thread, stop)) {
+            thread.state = stop.is_entry && is_syscall_stop ? TraceeState::IN_SYSCALL : TraceeState::RUNNING;
+            return StopOutcome::DONE;
         }
-        
-        Logger::debug("Output file validation successful: ", path);
-        return true;
-    } catch (const std::filesystem::filesystem_error& e) {
-        Logger::error("Filesystem error validating output file: ", e.what());
-        return false;
-    } catch (const std::exception& e) {
-        Logger::error("Error validating output file: ", e.what());
-        return false;
-    } catch (...) {
-        Logger::error("Unknown error validating output file");
-        return false;
     }
+
+    if (stop.is_entry) {
+        thread.pending.nr = -1;
+        handle_syscall_entry(pid, stop);
+    } else if (thread.pending.nr != -1) {
+        handle_syscall_exit(pid, thread, stop);
+    }
+
+    // Resynchronise with the kernel's view of entry/exit; a seccomp
+    // stop only gets an exit stop when a result is pending
+    thread.state = stop.is_entry && (is_syscall_stop || thread.pending.nr != -1) ?
+        TraceeState::IN_SYSCALL : TraceeState::RUNNING;
+    return StopOutcome::DONE;
 }
 
-// Function to validate executable command
-bool validate_command(const std::string& command) {
-    try {
-        // Check if command is empty
-        if (command.empty()) {
-            Logger::error("Command cannot be empty");
-            return false;
+// Function to service a syscall stop from retry.stage on: decode it,
+// then resume the tracee. retry.stage is left where a RETRY has to
+// start again.
+StopOutcome service_syscall_stop(pid_t pid, ThreadInfo& thread, StopRetry& retry) {
+    if (retry.stage == StopStage::DECODE) {
+        StopOutcome outcome = decode_syscall_stop(pid, thread, retry.is_syscall_stop);
+        if (outcome != StopOutcome::DONE) {
+            return outcome;
+        }
+        retry.stage = StopStage::RESUME;
+    }
+
+    if (resume_tracee(pid, 0, thread.pending.nr != -1) != -1) {
+        return StopOutcome::DONE;
+    }
+    if (errno == ESRCH) {
+        Logger::debug("Thread ", pid, " terminated during continuation");
+        return StopOutcome::GONE;
+    }
+    if (errno == EINVAL || errno == EIO) {
+        Logger::warning("Failed to continue thread ", pid, ": ", strerror(errno));
+        return StopOutcome::RETRY;
+    }
+    Logger::error("Failed to continue thread ", pid, ": ", strerror(errno));
+    return StopOutcome::FAILED;
+}
+
+// Function to act on the outcome of servicing a stop on the attempt-th
+// retry of its current stage. Refused stops are queued with exponential backoff, up to 5
+// decode or 3 resume attempts, so that one troubled tracee does not hold
+// up the others; after that the tracee is given up.
+void settle_stop(pid_t pid, const StopRetry& retry, StopOutcome outcome, int attempt) {
+    const int max_attempts = retry.stage == StopStage::DECODE ? 5 : 3;
+    if (outcome == StopOutcome::RETRY && attempt + 1 < max_attempts) {
+        // The tracee is held in its stop; the retry restores its state
+        ThreadInfo& thread = thread_map[pid];
+        StopRetry queued = retry;
+        queued.state = thread.state;
+        thread.state = TraceeState::RETRYING;
+        stop_retries.schedule(pid, queued, attempt);
+        return;
+    }
+    if (outcome == StopOutcome::RETRY || outcome == StopOutcome::FAILED) {
+        if (outcome == StopOutcome::RETRY) {
+            abandoned_retries++;
+        }
+        Logger::error(retry.stage == StopStage::DECODE ? "Failed to recover thread " : "Failed to continue thread ",
+                      pid, " after ", attempt + 1, " attempts");
+        handle_thread_exit(pid, -1);
+    }
+}
+
+// Function to retry the stops whose backoff has expired
+void run_due_retries() {
+    stop_retries.run_due([](pid_t pid, StopRetry retry, int attempt) {
+        auto thread_it = thread_map.find(pid);
+        if (thread_it == thread_map.end() || !thread_it->second.active) {
+            return;
+        }
+        thread_it->second.state = retry.state;
+        // Each stage has attempts of its own: a stop whose decode needed
+        // retries still gets every resume retry
+        StopStage stage = retry.stage;
+        StopOutcome outcome = service_syscall_stop(pid, thread_it->second, retry);
+        settle_stop(pid, retry, outcome, retry.stage == stage ? attempt + 1 : 0);
+    });
+}
+
+// Function to request detaching from attached tracees
+void request_detach(int) {
+    detach_requested = 1;
+}
+
+// Function to ask for a flight recorder dump on SIGUSR2
+void request_flight_dump(int) {
+    flight_dumps_requested.fetch_add(1, std::memory_order_release);
+}
+
+// Function to switch between recording and pass-through on SIGUSR1
+void request_recording_toggle(int) {
+    recording.store(!recording.load());
+}
+
+// Function to apply the commands written to the control FIFO: "record",
+// "pass" or "toggle", separated by whitespace
+void read_control_commands(int fd) {
+    char buffer[256];
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+        std::istringstream commands(std::string(buffer, static_cast<size_t>(length)));
+        std::string command;
+        while (commands >> command) {
+            if (command == "record") {
+                recording.store(true);
+            } else if (command == "pass") {
+                recording.store(false);
+            } else if (command == "toggle") {
+                recording.store(!recording.load());
+            } else {
+                Logger::warning("Unknown control command: ", command);
+            }
+        }
+    }
+}
+
+// Function to bring the tracees of the calling thread in line with a
+// switch to recording. Tracees running without syscall stops are stopped
+// once, to be resumed with them: seized ones are interrupted, the others
+// get a SIGSTOP that the tracer suppresses. A stop already queued for
+// retry is resumed with them anyway.
+void stop_passed_through_tracees() {
+    for (const auto& thread : thread_map) {
+        const ThreadInfo& info = thread.second;
+        if (!info.active || info.preloaded || info.state == TraceeState::RETRYING) {
+            continue;
+        }
+        if (attach_mode) {
+            ptrace(PTRACE_INTERRUPT, thread.first, nullptr, nullptr);
+        } else {
+            syscall(SYS_tkill, thread.first, SIGSTOP);
+        }
+    }
+}
+
+// Function to tell a SIGSTOP the tracer caused from one the tracee should
+// receive: the initial stop of a task auto-attached without PTRACE_SEIZE,
+// which the kernel queues without a sender, or one sent by
+// stop_passed_through_tracees. Seized tracees get neither, so any SIGSTOP
+// they stop with is a user's or job control's.
+bool is_tracer_sigstop(pid_t pid) {
+    if (attach_mode) {
+        return false;
+    }
+    siginfo_t info;
+    if (ptrace(PTRACE_GETSIGINFO, pid, nullptr, &info) == -1) {
+        return false;
+    }
+    return info.si_pid == 0 || info.si_pid == getpid();
+}
+
+// Function to seize every thread of a running process and, optionally, of
+// its descendants. Threads created while a process is being walked are
+// picked up by rescanning its task list until no new thread appears; those
+// created after their creator was seized are auto-attached.
+bool attach_process_tree(pid_t root, bool follow_children) {
+    auto attach_start = std::chrono::steady_clock::now();
+    double total_seize_us = 0;
+    double max_seize_us = 0;
+    size_t seized = 0;
+
+    std::vector<std::pair<pid_t, pid_t>> processes = {{root, 0}};  // (pid, parent)
+    for (size_t i = 0; i < processes.size(); i++) {
+        pid_t pid = processes[i].first;
+        pid_t parent = processes[i].second;
+
+        bool found_new = true;
+        while (found_new) {
+            found_new = false;
+            for (pid_t tid : process_attach::list_tasks(pid)) {
+                if (thread_map.find(tid) != thread_map.end()) {
+                    continue;
+                }
+
+                auto seize_start = std::chrono::steady_clock::now();
+                if (!process_attach::seize_task(tid, get_ptrace_options())) {
+                    if (tid == root) {
+                        Logger::error("Failed to attach to process ", root, ": ", strerror(errno));
+                        return false;
+                    }
+                    // Thread exited between listing and seizing
+                    Logger::debug("Failed to attach to thread ", tid, ": ", strerror(errno));
+                    continue;
+                }
+                double seize_us = std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - seize_start).count();
+                total_seize_us += seize_us;
+                max_seize_us = std::max(max_seize_us, seize_us);
+                seized++;
+                found_new = true;
+
+                if (tid == pid) {
+                    handle_thread_creation(parent, tid, true);
+                } else {
+                    if (thread_map.find(pid) == thread_map.end()) {
+                        // Leader already gone (zombie); hang threads off a placeholder
+                        handle_thread_creation(parent, pid, true);
+                    }
+                    handle_thread_creation(pid, tid, false);
+
+                    // Threads share their process's descriptor table and cwd
+                    thread_map[tid].fds = thread_map[pid].fds;
+                    thread_map[tid].cwd = thread_map[pid].cwd;
+                    thread_map[tid].rings = thread_map[pid].rings;
+                }
+            }
+        }
+
+        if (follow_children) {
+            for (pid_t child : process_attach::list_children(pid)) {
+                processes.emplace_back(child, pid);
+            }
+        }
+    }
+
+    if (thread_map.find(root) == thread_map.end()) {
+        Logger::error("Failed to attach to process ", root, ": no such process");
+        return false;
+    }
+
+    double attach_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - attach_start).count();
+    Logger::info("Attached to ", seized, " tasks in ", processes.size(), " processes in ", attach_ms,
+                 " ms (seize latency: mean ", (seized > 0 ? total_seize_us / seized : 0),
+                 " us, max ", max_seize_us, " us)");
+    return true;
+}
+
+// Function to detach from every tracee and leave it running. Each tracee
+// must be stopped to be detached, so all are interrupted first and then
+// detached as their stops arrive; pending signals are handed back.
+void detach_all_tracees() {
+    std::vector<pid_t> remaining;
+    size_t detached = 0;
+    for (const auto& thread : thread_map) {
+        // A tracee waiting for a retry is already stopped and reports no
+        // further stop to wait for
+        if (thread.second.active && thread.second.state == TraceeState::RETRYING) {
+            detached += ptrace(PTRACE_DETACH, thread.first, nullptr, nullptr) != -1;
+            continue;
+        }
+        if (thread.second.active && ptrace(PTRACE_INTERRUPT, thread.first, nullptr, nullptr) != -1) {
+            remaining.push_back(thread.first);
+        }
+    }
+
+    stop_retries.clear();
+    while (!remaining.empty()) {
+        int status;
+        pid_t pid = waitpid(-1, &status, __WALL | __WNOTHREAD);
+        if (pid == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        remaining.erase(std::remove(remaining.begin(), remaining.end(), pid), remaining.end());
+
+        if (WIFEXITED(status) || WIFSIGNALED(status)) {
+            handle_thread_exit(pid, WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+            continue;
+        }
+
+        // Only signal-delivery stops carry a signal the tracee still needs
+        int sig = 0;
+        if ((status >> 16) == 0 && WSTOPSIG(status) != (SIGTRAP | 0x80)) {
+            sig = WSTOPSIG(status);
+        }
+        if (ptrace(PTRACE_DETACH, pid, nullptr, reinterpret_cast<void*>(static_cast<long>(sig))) != -1) {
+            detached++;
+        }
+        memory_reader.forget(pid);
+    }
+    Logger::info("Detached from ", detached, " tasks");
+}
+
+// One ptrace tracing session over the tracees in thread_map. Each waitpid
+// result is classified once and dispatched to the handler for that kind
+// of stop; where a tracee is in its syscall cycle lives in its ThreadInfo,
+// so no handler depends on what the loop saw before. Work that belongs to
+// no single stop, such as due retries and periodic reporting, runs
+// between stops.
+class TraceSession {
+public:
+    // Also take recording commands from the control FIFO open on fd
+    bool watch_control(int fd) {
+        control_fd = fd;
+        if (!events.watch_control(fd)) {
+            last_error = events.get_last_error();
+            return false;
+        }
+        return true;
+    }
+
+    // Set up the event loop. SIGCHLD must already be blocked. A session
+    // that is not the process's only tracer (exclusive unset) cannot tell
+    // whose tracee a SIGCHLD is for, and waits in waitpid instead.
+    bool init(bool is_exclusive = true) {
+        exclusive = is_exclusive;
+        if (!events.init(std::chrono::seconds(1), exclusive)) {
+            last_error = events.get_last_error();
+            return false;
+        }
+        return true;
+    }
+
+    // Trace until every tracee has exited or a detach is requested. root
+    // is the launched command, whose exit ends the session.
+    void run(pid_t root_pid) {
+        root = root_pid;
+        while (true) {
+            if (detach_requested) {
+                Logger::info("Detaching from traced processes...");
+                detach_all_tracees();
+                return;
+            }
+            apply_recording_mode();
+
+            // Stops refused earlier are retried without blocking the
+            // tracees that are ready in the meantime
+            run_due_retries();
+            // __WNOTHREAD: only this thread's tracees, not those of the
+            // other tracer threads of a batch
+            int status;
+            pid_t pid = waitpid(-1, &status, __WALL | __WNOTHREAD | WNOHANG);
+            if (pid == 0 && !exclusive && stop_retries.empty()) {
+                pid = waitpid(-1, &status, __WALL | __WNOTHREAD);
+            } else if (pid == 0) {
+                // No stop to report: sleep in the event loop, using no CPU
+                // while the tracees run. Without SIGCHLD only the earliest
+                // retry ends the sleep.
+                between_stops(true);
+                continue;
+            }
+            if (pid == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (!on_no_tracee_reported()) {
+                    return;
+                }
+                continue;
+            }
+
+            if (WIFSTOPPED(status)) {
+                stop_count++;
+                if ((stop_count & 255) == 0) {
+                    between_stops(false);
+                }
+            }
+            dispatch(pid, status);
+        }
+    }
+
+    unsigned long long stops() const {
+        return stop_count;
+    }
+
+    // Execs of the preload backend that fell back to syscall stops
+    unsigned long long execs_traced() const {
+        return ptrace_execs;
+    }
+
+    const std::string& get_last_error() const {
+        return last_error;
+    }
+
+private:
+    // What a waitpid status reports
+    enum class StopKind {
+        EXITED,      // The tracee exited or was killed
+        CREATED,     // fork, vfork or clone event
+        EXEC,        // execve event
+        SYSCALL,     // PTRACE_SYSCALL entry or exit stop
+        SECCOMP,     // Seccomp pre-filter stop at a syscall entry
+        GROUP_STOP,  // Seized tracee stopped by a stopping signal
+        EVENT,       // Any other ptrace event stop
+        SIGNAL       // Signal-delivery stop
+    };
+
+    tracer_events::TracerEvents events;
+    bool exclusive = true;
+    int control_fd = -1;
+    bool recording_applied = true;  // Mode the tracees were last brought in line with
+    pid_t root = 0;
+    unsigned long long stop_count = 0;
+    unsigned long long ptrace_execs = 0;
+    std::string last_error;
+
+    static StopKind classify(int status) {
+        if (WIFEXITED(status) || WIFSIGNALED(status)) {
+            return StopKind::EXITED;
+        }
+        // PTRACE_O_TRACESYSGOOD marks syscall stops with bit 0x80
+        if (WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+            return StopKind::SYSCALL;
+        }
+        switch (status >> 16) {
+        case 0:
+            return StopKind::SIGNAL;
+        case PTRACE_EVENT_FORK:
+        case PTRACE_EVENT_VFORK:
+        case PTRACE_EVENT_CLONE:
+            return StopKind::CREATED;
+        case PTRACE_EVENT_EXEC:
+            return StopKind::EXEC;
+        case PTRACE_EVENT_SECCOMP:
+            return StopKind::SECCOMP;
+        case PTRACE_EVENT_STOP:
+            return WSTOPSIG(status) == SIGTRAP ? StopKind::EVENT : StopKind::GROUP_STOP;
+        default:
+            return StopKind::EVENT;
+        }
+    }
+
+    void dispatch(pid_t pid, int status) {
+        switch (classify(status)) {
+        case StopKind::EXITED:
+            on_exited(pid, status);
+            break;
+        case StopKind::CREATED:
+            on_created(pid, status >> 16);
+            break;
+        case StopKind::EXEC:
+            on_exec(pid);
+            resume_from_event(pid, 0);
+            break;
+        case StopKind::SYSCALL:
+            on_syscall(pid, true);
+            break;
+        case StopKind::SECCOMP:
+            on_syscall(pid, false);
+            break;
+        case StopKind::GROUP_STOP:
+            // It must stay stopped until SIGCONT, which PTRACE_LISTEN
+            // allows without resuming it
+            if (ptrace(PTRACE_LISTEN, pid, nullptr, nullptr) == -1 && errno != ESRCH) {
+                Logger::error("Failed to listen on stopped thread ", pid, ": ", strerror(errno));
+            }
+            break;
+        case StopKind::EVENT:
+            resume_from_event(pid, 0);
+            break;
+        case StopKind::SIGNAL:
+            // Re-inject real signals so the tracee still receives them
+            resume_from_event(pid, WSTOPSIG(status) == SIGSTOP && is_tracer_sigstop(pid) ? 0 :
+                                   WSTOPSIG(status));
+            break;
+        }
+    }
+
+    // Sleep until something needs the tracer: a tracee stopping or exiting
+    // (SIGCHLD), a watched process exiting, the earliest stop retry falling
+    // due, or the periodic timer. Without block the sources are only
+    // polled, so that periodic work also runs while tracees stop back to
+    // back.
+    void between_stops(bool block) {
+        if (block) {
+            if (stop_retries.empty()) {
+                events.clear_deadline();
+            } else {
+                events.set_deadline(stop_retries.time_to_next());
+            }
+        }
+        std::vector<pid_t> exited;
+        uint32_t woke = events.wait(exited, block);
+        if (woke & tracer_events::CONTROL) {
+            read_control_commands(control_fd);
+        }
+        if (woke & tracer_events::PERIODIC) {
+            size_t active = std::count_if(thread_map.begin(), thread_map.end(),
+                                          [](const auto& thread) { return thread.second.active; });
+            Logger::debug("Tracing: ", stop_count, " stops, ", active, " active threads, ",
+                          stop_retries.size(), " stop retries queued");
+        }
+        for (pid_t pid : exited) {
+            Logger::debug("Watched process ", pid, " exited");
+        }
+    }
+
+    // Act on a switch between recording and pass-through. Stops that come
+    // after the switch follow the new mode through resume_tracee; without
+    // the seccomp filter, tracees let run free need a stop to notice.
+    // Descriptors and working directories changed while paused unseen, so
+    // recording starts from /proc again.
+    void apply_recording_mode() {
+        bool on = recording.load(std::memory_order_relaxed);
+        if (on == recording_applied) {
+            return;
+        }
+        recording_applied = on;
+        if (on) {
+            Logger::info("Recording resumed");
+            forget_followed_state();
+        } else if (recording_triggers.watches_opens()) {
+            Logger::info("Recording paused: watching opens for a start trigger");
+        } else {
+            Logger::info("Recording paused: tracees run without syscall stops");
+        }
+        if (on && !use_seccomp_filter && !recording_triggers.watches_opens()) {
+            stop_passed_through_tracees();
+        }
+    }
+
+    // waitpid failed with something other than EINTR. Returns false when
+    // the session is over.
+    bool on_no_tracee_reported() {
+        if (errno != ECHILD) {
+            Logger::error("waitpid failed: ", strerror(errno));
+            // Try to cleanup remaining threads before breaking
+            for (const auto& thread : thread_map) {
+                if (thread.second.active) {
+                    handle_thread_exit(thread.first, -1);
+                }
+            }
+            return false;
+        }
+
+        Logger::warning("No child processes found (ECHILD). Checking thread states...");
+        bool any_active = false;
+        std::vector<pid_t> threads_to_cleanup;
+
+        // First pass: identify threads that need cleanup
+        for (const auto& thread : thread_map) {
+            if (thread.second.active) {
+                if (kill(thread.first, 0) == -1) {
+                    if (errno == ESRCH) {
+                        threads_to_cleanup.push_back(thread.first);
+                    } else {
+                        Logger::warning("Error checking thread ", thread.first,
+                                      ": ", strerror(errno));
+                    }
+                } else {
+                    any_active = true;
+                }
+            }
+        }
+
+        // Second pass: cleanup terminated threads
+        for (pid_t tid : threads_to_cleanup) {
+            Logger::debug("Cleaning up terminated thread ", tid);
+            handle_thread_exit(tid, -1);
+
+            // Attempt to detach if still attached
+            if (ptrace(PTRACE_DETACH, tid, nullptr, nullptr) == -1 && errno != ESRCH) {
+                Logger::warning("Failed to detach from thread ", tid,
+                              ": ", strerror(errno));
+            }
+        }
+
+        if (!any_active) {
+            Logger::info("All threads have terminated. Exiting...");
+            return false;
+        }
+
+        // Some threads might still be running but not traced: their
+        // processes' pidfds report the exit as it happens. Kernels without
+        // pidfd_open are rechecked every 10 ms. A zombie still answers
+        // kill(), so the exit reported for a process retires its threads
+        // here.
+        std::unordered_map<pid_t, std::vector<pid_t>> process_threads;
+        bool watching = true;
+        for (const auto& thread : thread_map) {
+            if (thread.second.active && kill(thread.first, 0) == 0) {
+                pid_t tgid = process_attach::get_thread_group_id(thread.first);
+                tgid = tgid > 0 ? tgid : thread.first;
+                process_threads[tgid].push_back(thread.first);
+                watching = events.watch_process(tgid) && watching;
+            }
+        }
+        if (!watching) {
+            Logger::debug("Polling untraced threads: ", events.get_last_error());
+            events.set_deadline(std::chrono::milliseconds(10));
+        }
+        std::vector<pid_t> exited;
+        events.wait(exited);
+        for (pid_t process : exited) {
+            for (pid_t tid : process_threads[process]) {
+                handle_thread_exit(tid, -1);
+            }
+        }
+        return true;
+    }
+
+    void on_exited(pid_t pid, int status) {
+        // A process that crashed asks for a flight recorder dump; its
+        // threads are reported dead too, but only the process counts
+        auto exited_it = thread_map.find(pid);
+        if (WIFSIGNALED(status) && flight_recorder::is_crash_signal(WTERMSIG(status)) &&
+            exited_it != thread_map.end() && exited_it->second.process_type == ProcessType::PROCESS) {
+            Logger::info("Process ", pid, " killed by signal ", WTERMSIG(status));
+            flight_dumps_requested.fetch_add(1, std::memory_order_release);
+        }
+        handle_thread_exit(pid, WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+
+        // The launched command exited: cleanup remaining threads
+        if (pid == root) {
+            for (auto& thread : thread_map) {
+                if (thread.second.active && thread.first != root) {
+                    if (ptrace(PTRACE_DETACH, thread.first, nullptr, nullptr) != -1) {
+                        handle_thread_exit(thread.first, -1);
+                    }
+                }
+            }
+        }
+    }
+
+    // The new tracee is auto-attached with our options and reports its
+    // initial SIGSTOP like any other stop, so nothing here waits on it
+    void on_created(pid_t pid, int event) {
+        unsigned long new_pid;
+        if (ptrace(PTRACE_GETEVENTMSG, pid, nullptr, &new_pid) != -1) {
+            bool is_process = event == PTRACE_EVENT_FORK || event == PTRACE_EVENT_VFORK;
+            handle_thread_creation(pid, new_pid, is_process);
+
+            // CLONE_FILES and CLONE_FS children share the creator's
+            // descriptor table and working directory; everything else
+            // starts from a copy
+            unsigned long long clone_flags = get_clone_flags(pid);
+            ThreadInfo& creator = thread_map[pid];
+            ThreadInfo& created = thread_map[new_pid];
+            created.fds = (clone_flags & CLONE_FILES) ?
+                creator.fds : std::make_shared<fd_table::FdTable>(*creator.fds);
+            created.cwd = (clone_flags & CLONE_FS) ?
+                creator.cwd : std::make_shared<std::string>(*creator.cwd);
+            created.rings = (clone_flags & CLONE_FILES) ? creator.rings :
+                std::make_shared<io_uring_tracker::RingTable>(creator.rings->inherited());
+            created.preloaded = creator.preloaded;
+        } else {
+            Logger::error("Failed to get event message for process/thread creation: ",
+                        strerror(errno));
+        }
+
+        // Resume the parent process
+        if (resume_tracee(pid) == -1) {
+            Logger::error("Failed to resume parent process ",
+                        pid, ": ", strerror(errno));
+        }
+    }
+
+    // A successful execve replaces the address space behind any cached
+    // /proc/<pid>/mem descriptor
+    void on_exec(pid_t pid) {
+        memory_reader.forget(pid);
+
+        // execve unshares the descriptor table and closes O_CLOEXEC
+        // descriptors
+        auto exec_it = thread_map.find(pid);
+        if (exec_it == thread_map.end()) {
+            return;
+        }
+        ThreadInfo& exec_thread = exec_it->second;
+        exec_thread.fds = std::make_shared<fd_table::FdTable>(*exec_thread.fds);
+        exec_thread.fds->drop_cloexec();
+        check_exec_triggers(pid);
+        // Rings were mapped into the address space exec replaced
+        flush_rings(*exec_thread.rings);
+        exec_thread.rings = std::make_shared<io_uring_tracker::RingTable>();
+
+        // The new image decides how the process is traced from here on.
+        // Static, secure-execution and foreign-ABI images fall back to
+        // syscall stops, starting with the exit of this execve; their
+        // descriptor table and cwd were not followed while preloaded and
+        // are re-read.
+        if (use_preload) {
+            bool preloaded = preload_backend::preload_applies(pid, preload_library, preload_ring_name);
+            if (exec_thread.preloaded && !preloaded) {
+                exec_thread.fds = std::make_shared<fd_table::FdTable>();
+                exec_thread.cwd = std::make_shared<std::string>();
+            }
+            if (!preloaded) {
+                ptrace_execs++;
+                Logger::debug("Process ", pid, " runs an image the preload library cannot apply to; tracing its syscalls");
+            }
+            // A traced execve keeps its parked entry for the exit stop; a
+            // preloaded image never reaches one
+            if (exec_thread.preloaded || preloaded) {
+                exec_thread.pending.nr = -1;
+            }
+            exec_thread.preloaded = preloaded;
+            exec_thread.state = preloaded ? TraceeState::RUNNING : TraceeState::IN_SYSCALL;
+        }
+    }
+
+    // Start or stop recording when the new image is a trigger binary, so
+    // that its opens are recorded from the first one on, or not at all
+    void check_exec_triggers(pid_t pid) {
+        if (recording_triggers.start_exec.empty() && recording_triggers.stop_exec.empty()) {
+            return;
+        }
+        // The binary is matched by its resolved path and by the name it
+        // was executed as, which comm holds: "sh" may run /usr/bin/dash
+        std::string binary = get_executable_path(pid);
+        std::string name = get_thread_name(pid);
+        bool on = recording.load(std::memory_order_relaxed);
+        if (!on && (recording_triggers.starts_on_exec(binary) || recording_triggers.starts_on_exec(name))) {
+            Logger::info("Start trigger: process ", pid, " executes ", binary);
+            recording.store(true);
+        } else if (on && (recording_triggers.stops_on_exec(binary) || recording_triggers.stops_on_exec(name))) {
+            Logger::info("Stop trigger: process ", pid, " executes ", binary);
+            recording.store(false);
+        }
+    }
+
+    // Pass an event or signal-delivery stop straight through. ESRCH means
+    // the tracee was killed while stopped; waitpid reports its death
+    // separately. A syscall parked at entry still wants its exit stop, as
+    // execve does after PTRACE_EVENT_EXEC.
+    void resume_from_event(pid_t pid, int sig) {
+        auto event_it = thread_map.find(pid);
+        bool want_exit = event_it != thread_map.end() && event_it->second.pending.nr != -1;
+        if (resume_tracee(pid, sig, want_exit) == -1 && errno != ESRCH) {
+            Logger::error("Failed to resume thread ", pid, ": ", strerror(errno));
+        }
+    }
+
+    void on_syscall(pid_t pid, bool is_syscall_stop) {
+        auto thread_it = thread_map.find(pid);
+        if (thread_it == thread_map.end()) {
+            // New thread detected before its creator's fork/clone event;
+            // the event fills in the parent when it arrives
+            handle_thread_creation(0, pid);
+            thread_it = thread_map.find(pid);
+            thread_it->second.preloaded = use_preload &&
+                preload_backend::preload_applies(pid, preload_library, preload_ring_name);
+        }
+
+        if (!thread_it->second.active) {
+            // Thread marked as inactive, detach from it
+            if (ptrace(PTRACE_DETACH, pid, nullptr, nullptr) == -1) {
+                Logger::error("Failed to detach from terminated thread ", pid,
+                            ": ", strerror(errno));
+            }
+            return;
+        }
+
+        // Liveness is tracked through waitpid exit reports and ESRCH from
+        // ptrace itself; a tracee that dies mid-stop is cleaned up when its
+        // WIFEXITED/WIFSIGNALED status arrives. A stop the kernel refuses
+        // to service yet is retried from stop_retries while other tracees
+        // are serviced.
+        StopRetry retry{StopStage::DECODE, is_syscall_stop};
+        settle_stop(pid, retry, service_syscall_stop(pid, thread_it->second, retry), 0);
+    }
+};
+
+// Function to turn a preload library record into a file operation
+FileOperation preload_operation(const preload_backend::EventRecord& event) {
+    FileOperation op;
+    op.pid = event.pid;
+    op.path = path_utils::lexical_normalize(event.path);
+    op.sequence = 0;
+    op.thread_id = event.tid;
+    op.thread_name = std::string(event.comm, strnlen(event.comm, sizeof(event.comm)));
+    op.kind = event.result >= 0 ? OperationKind::OPEN : OperationKind::OPEN_FAILED;
+    op.fd = event.result >= 0 ? event.result : -1;
+    op.error = event.result >= 0 ? 0 : -event.result;
+    return op;
+}
+
+// Where report workers record operations. The tracer threads of a --jobs
+// batch writing one merged report share a target.
+struct ReportTarget {
+    DirectoryTree dir_tree;
+    size_t recorded = 0;
+    std::mutex mutex;  // Held while recording into the tree
+    // With --flight-recorder, only the most recent operations are kept,
+    // here instead of in dir_tree. Dumps are numbered after dump_file.
+    std::unique_ptr<flight_recorder::FlightRecorder<FileOperation>> flight;
+    std::string dump_file;
+};
+
+// Function to write a report of the operations a flight recorder holds.
+// The tree is built for this report only, so the recorder's memory is
+// all that stays allocated between dumps.
+void dump_flight_recorder(const ReportTarget& target, const std::string& output_file) {
+    DirectoryTree tree;
+    size_t kept = target.flight->for_each([&](const FileOperation& op) {
+        tree.insert_file(op.path, op.sequence, op.thread_id, op.thread_name, op.error,
+                         op.syscall != nullptr ? op.syscall : "");
+    });
+    Logger::info("Flight recorder: writing the last ", kept, " of ", target.recorded, " operations to ",
+                 output_file);
+    if (!HtmlGenerator::generate_html_report(tree, output_file)) {
+        Logger::error("Failed to generate HTML report: ", HtmlGenerator::get_last_error());
+    }
+}
+
+// Function to name the n-th flight recorder dump written during the
+// trace: trace.html becomes trace-dump-2.html
+std::string flight_dump_name(const std::string& output_file, unsigned int index) {
+    std::filesystem::path path(output_file);
+    std::filesystem::path name = path.stem().string() + "-dump-" + std::to_string(index) +
+                                 path.extension().string();
+    return (path.parent_path() / name).string();
+}
+
+// Function to keep only the most recent operations in target, within
+// limit, and write a dump of them on SIGUSR2
+void enable_flight_recorder(ReportTarget& target, const flight_recorder::Limit& limit,
+                            const std::string& output_file) {
+    target.flight = std::make_unique<flight_recorder::FlightRecorder<FileOperation>>(limit.events, limit.window);
+    target.dump_file = output_file;
+    struct sigaction dump = {};
+    dump.sa_handler = request_flight_dump;
+    sigemptyset(&dump.sa_mask);
+    dump.sa_flags = SA_RESTART;
+    sigaction(SIGUSR2, &dump, nullptr);
+    Logger::info("Flight recorder: keeping the last ", limit.events, " operations",
+                 limit.window.count() > 0 ? " of the last " + std::to_string(limit.window.count()) + " ms" : "",
+                 "; kill -USR2 ", getpid(), " writes them to ", flight_dump_name(output_file, 1), ", ...");
+}
+
+// Function run by a report worker thread: takes the operations a tracing
+// thread captured off its ring, and off the preload ring if there is one,
+// filters them against the base directory and inserts them into the
+// target's tree as they arrive, or into its flight recorder, which it
+// dumps on request. Returns once done is set and the rings are drained.
+void report_worker(const std::string& base_dir, bool show_failed, ReportTarget& target,
+                   spsc_ring::SpscRing<FileOperation>& ring, const std::atomic<bool>& done_flag,
+                   preload_backend::EventRing* preload_ring) {
+    auto record = [&](FileOperation& op) {
+        // Relative paths whose base could not be resolved at capture
+        if (op.path[0] != '/') {
+            op.path = path_utils::normalize_path(op.path);
+        }
+
+        // Skip if base_dir is specified and path is not within it
+        if (!path_utils::disable_directory_filtering && !base_dir.empty()) {
+            Logger::debug("Checking path: ", op.path, " against base: ", base_dir);
+            if (!path_utils::is_within_directory(op.path, base_dir)) {
+                Logger::debug("Skipping file outside base directory: ", op.path);
+                return;
+            }
+        }
+
+        // Dropped failures take no sequence number and are not counted
+        bool failed = op.kind == OperationKind::OPEN_FAILED || op.kind == OperationKind::SYSCALL_FAILED;
+        if (failed && !show_failed) {
+            Logger::debug("Skipping failed operation: ", op.path, " ", strerror(op.error));
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(target.mutex);
+        op.sequence = static_cast<int>(++target.recorded);
+        Logger::debug("Adding file operation: ", op.path, " [", op.sequence, "] ",
+                      (op.syscall != nullptr ? std::string(op.syscall) + " " : std::string()),
+                      (failed ? std::string(strerror(op.error)) :
+                       op.kind == OperationKind::CLOSE_WRITE ? std::string("written") :
+                       op.kind == OperationKind::SYSCALL ? std::string("succeeded") :
+                       op.fd >= 0 ? "fd " + std::to_string(op.fd) : std::string("opened")));
+        if (target.flight) {
+            target.flight->record(op);
+            return;
+        }
+        target.dir_tree.insert_file(op.path, op.sequence, op.thread_id, op.thread_name, op.error,
+                             op.syscall != nullptr ? op.syscall : "");
+    };
+    auto record_preloaded = [&](const preload_backend::EventRecord& event) {
+        // Preloaded processes report opens without stopping, so pass-through
+        // drops them here instead
+        if (event.path[0] != '\0' && recording.load(std::memory_order_relaxed)) {
+            FileOperation op = preload_operation(event);
+            record(op);
+        }
+    };
+
+    FileOperation op;
+    unsigned int dumps_written = flight_dumps_requested.load();
+    unsigned int dump_count = 0;
+    // Idle polling backs off so a quiet trace does not keep a CPU busy
+    std::chrono::microseconds idle_sleep(50);
+    const std::chrono::microseconds max_idle_sleep(2000);
+    while (true) {
+        // Read before draining, so that everything captured before the
+        // flag was set, or the dump requested, is drained below
+        bool done = done_flag.load(std::memory_order_acquire);
+        unsigned int dumps = flight_dumps_requested.load(std::memory_order_acquire);
+        size_t handled = preload_ring != nullptr ? preload_ring->drain(record_preloaded, done) : 0;
+        while (ring.try_pop(op)) {
+            record(op);
+            handled++;
+        }
+        if (target.flight && dumps != dumps_written) {
+            // Requests that arrived together are served by one dump
+            std::lock_guard<std::mutex> lock(target.mutex);
+            dump_flight_recorder(target, flight_dump_name(target.dump_file, ++dump_count));
+            dumps_written = dumps;
+        }
+        if (done) {
+            return;
+        }
+        if (handled == 0) {
+            std::this_thread::sleep_for(idle_sleep);
+            idle_sleep = std::min(idle_sleep * 2, max_idle_sleep);
+        } else {
+            idle_sleep = std::chrono::microseconds(50);
+        }
+    }
+}
+
+// Function to generate HTML visualization
+void generate_html_output(const ReportTarget& target, const std::string& output_file) {
+    if (target.flight) {
+        dump_flight_recorder(target, output_file);
+        return;
+    }
+    Logger::info("Generating HTML output with ", target.recorded, " operations:");
+    
+    // Generate HTML using the HtmlGenerator
+    if (!HtmlGenerator::generate_html_report(target.dir_tree, output_file)) {
+        Logger::error("Failed to generate HTML report: ", HtmlGenerator::get_last_error());
+    }
+}
+
+// Function to validate output file path
+bool validate_output_file(const std::string& path) {
+    try {
+        // Check if path is empty
+        if (path.empty()) {
+            Logger::error("Output file path cannot be empty");
+            return false;
+        }
+
+        // Create filesystem path and extract parent directory
+        std::filesystem::path fs_path(path);
+        std::filesystem::path parent_path = fs_path.parent_path();
+        
+        // Handle empty parent path (current directory)
+        if (parent_path.empty()) {
+            parent_path = std::filesystem::current_path();
+            Logger::debug("Using current directory as parent path");
+        }
+
+        // Check if parent directory exists
+        if (!std::filesystem::exists(parent_path)) {
+            Logger::error("Parent directory does not exist: ", parent_path.string());
+            return false;
+        }
+
+        // Verify parent path is a directory
+        if (!std::filesystem::is_directory(parent_path)) {
+            Logger::error("Parent path is not a directory: ", parent_path.string());
+            return false;
+        }
+
+        // Check directory permissions using filesystem status
+        try {
+            auto perms = std::filesystem::status(parent_path).permissions();
+            if ((perms & std::filesystem::perms::owner_write) == std::filesystem::perms::none &&
+                (perms & std::filesystem::perms::group_write) == std::filesystem::perms::none &&
+                (perms & std::filesystem::perms::others_write) == std::filesystem::perms::none) {
+                Logger::error("Parent directory is not writable: ", parent_path.string());
+                return false;
+            }
+        } catch (const std::filesystem::filesystem_error& e) {
+            Logger::error("Failed to check directory permissions: ", e.what());
+            return false;
+        }
+        
+        Logger::debug("Output file validation successful: ", path);
+        return true;
+    } catch (const std::filesystem::filesystem_error& e) {
+        Logger::error("Filesystem error validating output file: ", e.what());
+        return false;
+    } catch (const std::exception& e) {
+        Logger::error("Error validating output file: ", e.what());
+        return false;
+    } catch (...) {
+        Logger::error("Unknown error validating output file");
+        return false;
+    }
+}
+
+// Function to start command in a child that blocks before exec until
+// release_held_child is called, so that a backend can start watching it
+// first. Returns the child pid, or -1 on failure.
+pid_t spawn_held_child(const std::vector<std::string>& command, int& release_fd) {
+    int start_pipe[2];
+    if (pipe2(start_pipe, O_CLOEXEC) == -1) {
+        Logger::error("Failed to create pipe: ", strerror(errno));
+        return -1;
+    }
+    pid_t child = fork();
+    if (child == -1) {
+        Logger::error("Fork failed: ", strerror(errno));
+        close(start_pipe[0]);
+        close(start_pipe[1]);
+        return -1;
+    }
+    if (child == 0) {
+        close(start_pipe[1]);
+        char go;
+        if (read(start_pipe[0], &go, 1) != 1) {
+            _exit(1);
+        }
+        std::vector<char*> args;
+        for (const auto& arg : command) {
+            args.push_back(const_cast<char*>(arg.c_str()));
+        }
+        args.push_back(nullptr);
+        execvp(args[0], args.data());
+        Logger::error("Failed to execute ", command[0], ": ", strerror(errno));
+        _exit(127);
+    }
+    close(start_pipe[0]);
+    release_fd = start_pipe[1];
+    return child;
+}
+
+// Function to let a child from spawn_held_child exec its command
+void release_held_child(int release_fd) {
+    char go = 1;
+    if (write(release_fd, &go, 1) != 1) {
+        Logger::error("Failed to start child: ", strerror(errno));
+    }
+    close(release_fd);
+}
+
+// Function to trace a command with the fanotify backend. The command runs
+// untraced at native speed while fanotify reports opens on the marked
+// mounts; events are attributed to the command's process tree by pid and
+// handed to the report worker like ptrace captures.
+bool run_fanotify_trace(const std::vector<std::string>& command, const std::string& base_dir) {
+    fanotify_backend::FanotifyMonitor monitor;
+    if (!monitor.init()) {
+        Logger::error("Failed to initialize fanotify (requires CAP_SYS_ADMIN): ", monitor.get_last_error());
+        return false;
+    }
+
+    // With directory filtering only the base directory's mount matters
+    std::vector<std::string> mount_points;
+    if (path_utils::disable_directory_filtering) {
+        mount_points = fanotify_backend::list_mount_points();
+    } else {
+        mount_points.push_back(base_dir);
+    }
+    size_t marked = 0;
+    for (const auto& mount_point : mount_points) {
+        if (monitor.mark_mount(mount_point)) {
+            marked++;
+        } else {
+            Logger::debug("Not watching ", mount_point, ": ", monitor.get_last_error());
+        }
+    }
+    if (marked == 0) {
+        Logger::error("Failed to watch any mount: ", monitor.get_last_error());
+        return false;
+    }
+    Logger::info("Watching ", marked, " mounts with fanotify");
+
+    // Orphaned descendants are reparented to us, so their /proc entries
+    // stay readable until their events have been attributed
+    prctl(PR_SET_CHILD_SUBREAPER, 1, 0, 0, 0);
+
+    // The child waits until the marks are in place
+    int release_fd;
+    pid_t child = spawn_held_child(command, release_fd);
+    if (child == -1) {
+        return false;
+    }
+    release_held_child(release_fd);
+
+    // Attribution cache per reporting task
+    struct TaskAttribution {
+        bool in_tree;
+        pid_t pid;
+        std::string name;
+    };
+    std::unordered_map<pid_t, TaskAttribution> tasks;
+    std::unordered_map<pid_t, bool> processes = {{child, true}};
+    const pid_t tracer_pid = getpid();
+    unsigned long long event_count = 0;
+    unsigned long long unattributed = 0;
+
+    auto attribute = [&](pid_t tid) -> const TaskAttribution* {
+        auto task_it = tasks.find(tid);
+        if (task_it != tasks.end()) {
+            return &task_it->second;
+        }
+        pid_t pid = monitor.reports_tid() ? process_attach::get_thread_group_id(tid) : tid;
+        if (pid == 0) {
+            // Exited and reaped before its event was read
+            return nullptr;
+        }
+
+        // Walk up the parent chain until a process of known membership.
+        // Orphans are reparented to filetrace as subreaper, so filetrace
+        // itself counts as a tree member for its descendants only.
+        std::vector<pid_t> chain;
+        pid_t current = pid;
+        bool in_tree = false;
+        while (current > 1) {
+            if (current == tracer_pid) {
+                in_tree = current != pid;
+                break;
+            }
+            auto process_it = processes.find(current);
+            if (process_it != processes.end()) {
+                in_tree = process_it->second;
+                break;
+            }
+            chain.push_back(current);
+            current = process_attach::get_parent_pid(current);
+            if (current == 0) {
+                // An ancestor exited mid-walk; membership is unknown
+                return nullptr;
+            }
+        }
+        for (pid_t ancestor : chain) {
+            processes[ancestor] = in_tree;
+        }
+        return &(tasks[tid] = TaskAttribution{in_tree, pid, get_thread_name(tid)});
+    };
+
+    auto in_tree = [&](pid_t tid) {
+        event_count++;
+        const TaskAttribution* task = attribute(tid);
+        if (task == nullptr) {
+            unattributed++;
+            return false;
+        }
+        return task->in_tree;
+    };
+
+    auto handle_event = [&](const fanotify_backend::FileEvent& event) {
+        const TaskAttribution* task = &tasks[event.tid];
+        for (OperationKind kind : {OperationKind::OPEN, OperationKind::CLOSE_WRITE}) {
+            if (!(kind == OperationKind::OPEN ? event.open : event.close_write)) {
+                continue;
+            }
+            FileOperation op;
+            op.pid = task->pid;
+            op.path = event.path;
+            op.sequence = 0;
+            op.thread_id = event.tid;
+            op.thread_name = task->name;
+            op.kind = kind;
+            op.fd = -1;
+            op.error = 0;
+            while (!operation_ring.try_push(std::move(op))) {
+                std::this_thread::yield();
+            }
+        }
+    };
+
+    // Events are drained before children are reaped so that a process is
+    // still in /proc while its last events are attributed
+    bool running = true;
+    while (running) {
+        struct pollfd pfd = {monitor.fd(), POLLIN, 0};
+        poll(&pfd, 1, 100);
+        if (!monitor.read_events(in_tree, handle_event)) {
+            Logger::error("Failed to read fanotify events: ", monitor.get_last_error());
+        }
+
+        siginfo_t info;
+        while (true) {
+            info.si_pid = 0;
+            if (waitid(P_ALL, 0, &info, WEXITED | WNOHANG | WNOWAIT) == -1) {
+                // ECHILD: the whole tree has exited
+                running = false;
+                break;
+            }
+            if (info.si_pid == 0) {
+                break;
+            }
+            monitor.read_events(in_tree, handle_event);
+            waitpid(info.si_pid, nullptr, 0);
+            tasks.erase(info.si_pid);
+            processes.erase(info.si_pid);
+        }
+    }
+    monitor.read_events(in_tree, handle_event);
+
+    Logger::info("fanotify statistics: ", event_count, " events, ", unattributed,
+                 " from tasks that exited before attribution");
+    return true;
+}
+
+// Function to trace a command with the eBPF backend. Tracepoint programs
+// filter by process in the kernel and pass open events through a ring
+// buffer, so the command never stops for the tracer. Paths relative to a
+// directory descriptor are resolved when the event is read, on a best
+// effort basis.
+bool run_ebpf_trace(const std::vector<std::string>& command) {
+    ebpf_backend::EbpfTracer tracer;
+    if (!tracer.load()) {
+        Logger::error("Failed to load eBPF programs (requires CAP_BPF and CAP_PERFMON): ",
+                      tracer.get_last_error());
+        return false;
+    }
+
+    // Reaping orphans keeps every traced process in /proc until its
+    // events have been read
+    prctl(PR_SET_CHILD_SUBREAPER, 1, 0, 0, 0);
+
+    int release_fd;
+    pid_t child = spawn_held_child(command, release_fd);
+    if (child == -1) {
+        return false;
+    }
+    if (!tracer.trace_process(child)) {
+        Logger::error("Failed to trace process ", child, ": ", tracer.get_last_error());
+        kill(child, SIGKILL);
+        waitpid(child, nullptr, 0);
+        close(release_fd);
+        return false;
+    }
+    release_held_child(release_fd);
+
+    // Entries waiting for their exit event, per thread
+    struct PendingEntry {
+        ebpf_backend::EventType type;
+        std::string path;   // Resolved path, empty if unresolvable
+    };
+    std::unordered_map<uint32_t, PendingEntry> pending;
+
+    // Working directory per process, followed through chdir/fchdir and
+    // inherited on fork since events are usually read after the process
+    // has moved on or exited. The child starts in ours.
+    std::unordered_map<uint32_t, std::string> process_cwd = {
+        {static_cast<uint32_t>(child), path_utils::get_current_directory()}};
+    auto cwd_of = [&](const ebpf_backend::EventHeader& event) -> const std::string& {
+        auto cwd_it = process_cwd.find(event.pid);
+        if (cwd_it == process_cwd.end()) {
+            cwd_it = process_cwd.emplace(event.pid, tracee_cwd(static_cast<pid_t>(event.tid))).first;
+        }
+        return cwd_it->second;
+    };
+    auto resolve_path = [&](const ebpf_backend::EventHeader& event, const char* path) {
+        std::string resolved = path != nullptr ? path : "";
+        if (resolved.empty() || resolved[0] == '/') {
+            return resolved;
+        }
+        int dirfd = static_cast<int>(event.value);
+        std::string base = dirfd == AT_FDCWD ? cwd_of(event) : resolve_fd_path(static_cast<pid_t>(event.tid), dirfd);
+        return base.empty() ? resolved : resolve_relative_path(base, resolved);
+    };
+
+    unsigned long long event_count = 0;
+    unsigned long long forks = 0;
+
+    auto handle_event = [&](const ebpf_backend::EventHeader& event, const char* path) {
+        event_count++;
+        switch (event.type) {
+        case ebpf_backend::EVENT_OPEN:
+        case ebpf_backend::EVENT_CHDIR:
+            pending[event.tid] = PendingEntry{static_cast<ebpf_backend::EventType>(event.type),
+                                              resolve_path(event, path)};
+            break;
+        case ebpf_backend::EVENT_FCHDIR:
+            pending[event.tid] = PendingEntry{ebpf_backend::EVENT_CHDIR,
+                                              resolve_fd_path(static_cast<pid_t>(event.tid), static_cast<int>(event.value))};
+            break;
+        case ebpf_backend::EVENT_RESULT: {
+            auto pending_it = pending.find(event.tid);
+            if (pending_it == pending.end()) {
+                break;
+            }
+            PendingEntry entry = std::move(pending_it->second);
+            pending.erase(pending_it);
+            if (entry.path.empty()) {
+                break;
+            }
+            if (entry.type == ebpf_backend::EVENT_CHDIR) {
+                if (event.value == 0) {
+                    process_cwd[event.pid] = entry.path;
+                }
+                break;
+            }
+            FileOperation op;
+            op.pid = static_cast<pid_t>(event.pid);
+            op.path = std::move(entry.path);
+            op.sequence = 0;
+            op.thread_id = static_cast<pid_t>(event.tid);
+            op.thread_name = std::string(event.comm, strnlen(event.comm, sizeof(event.comm)));
+            op.kind = event.value >= 0 ? OperationKind::OPEN : OperationKind::OPEN_FAILED;
+            op.fd = event.value >= 0 ? static_cast<int>(event.value) : -1;
+            op.error = event.value >= 0 ? 0 : static_cast<int>(-event.value);
+            while (!operation_ring.try_push(std::move(op))) {
+                std::this_thread::yield();
+            }
+            break;
+        }
+        case ebpf_backend::EVENT_FORK: {
+            // New threads get an entry too; it is never looked up
+            forks++;
+            std::string cwd = cwd_of(event);
+            process_cwd[static_cast<uint32_t>(event.value)] = cwd;
+            break;
+        }
+        }
+    };
+
+    // As with fanotify, events are drained before a child is reaped
+    bool running = true;
+    while (running) {
+        struct pollfd pfd = {tracer.fd(), POLLIN, 0};
+        poll(&pfd, 1, 100);
+        tracer.consume(handle_event);
+
+        siginfo_t info;
+        while (true) {
+            info.si_pid = 0;
+            if (waitid(P_ALL, 0, &info, WEXITED | WNOHANG | WNOWAIT) == -1) {
+                // ECHILD: the whole tree has exited
+                running = false;
+                break;
+            }
+            if (info.si_pid == 0) {
+                break;
+            }
+            tracer.consume(handle_event);
+            waitpid(info.si_pid, nullptr, 0);
+            process_cwd.erase(static_cast<uint32_t>(info.si_pid));
+        }
+    }
+    tracer.consume(handle_event);
+
+    uint64_t dropped = tracer.dropped();
+    Logger::info("eBPF statistics: ", event_count, " events, ", forks, " tasks created, ",
+                 dropped, " events dropped on a full ring buffer");
+    if (dropped > 0) {
+        Logger::warning("The trace is incomplete: the command produced events faster than they were reported");
+    }
+    return true;
+}
+
+// Function to trace a command with the seccomp user-notification backend.
+// The child installs a filter that hands the opens to a listener before
+// exec and passes the listener to filetrace, which records the path and
+// lets the syscall continue. Syscalls outside the filter never leave the
+// kernel, and one listener serves the whole process tree. The result of
+// the open is not seen, so every attempt is reported as an open.
+bool run_notify_trace(const std::vector<std::string>& command) {
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) == -1) {
+        Logger::error("Failed to create socket pair: ", strerror(errno));
+        return false;
+    }
+
+    // Orphans are reparented to us and reaped below
+    prctl(PR_SET_CHILD_SUBREAPER, 1, 0, 0, 0);
+
+    pid_t child = fork();
+    if (child == -1) {
+        Logger::error("Fork failed: ", strerror(errno));
+        close(sockets[0]);
+        close(sockets[1]);
+        return false;
+    }
+    if (child == 0) {
+        close(sockets[0]);
+        int listener_fd = notify_backend::install_listener(notify_backend::notified_syscalls,
+                                                             notify_backend::notified_compat_syscalls);
+        if (listener_fd == -1 || !notify_backend::send_fd(sockets[1], listener_fd)) {
+            Logger::error("Failed to install seccomp listener: ", strerror(errno));
+            _exit(1);
+        }
+        close(listener_fd);
+        close(sockets[1]);
+        std::vector<char*> args;
+        for (const auto& arg : command) {
+            args.push_back(const_cast<char*>(arg.c_str()));
+        }
+        args.push_back(nullptr);
+        execvp(args[0], args.data());
+        Logger::error("Failed to execute ", command[0], ": ", strerror(errno));
+        _exit(127);
+    }
+    close(sockets[1]);
+    int listener_fd = notify_backend::receive_fd(sockets[0]);
+    close(sockets[0]);
+    if (listener_fd == -1) {
+        Logger::error("Failed to receive the seccomp listener (requires Linux 5.5 or later)");
+        waitpid(child, nullptr, 0);
+        return false;
+    }
+    notify_backend::NotificationListener listener(listener_fd);
+
+    // Thread group and name per notifying thread
+    struct TaskIdentity {
+        pid_t pid;
+        std::string name;
+    };
+    std::unordered_map<pid_t, TaskIdentity> tasks;
+    unsigned long long notifications = 0;
+    unsigned long long vanished = 0;
+
+    auto handle_notification = [&]() {
+        const struct seccomp_notif* request = listener.receive();
+        if (request == nullptr) {
+            // ENOENT: the task was killed before its notification was read
+            if (errno != EINTR) {
+                vanished++;
+            }
+            return;
+        }
+        notifications++;
+        pid_t tid = static_cast<pid_t>(request->pid);
+        uint64_t id = request->id;
+        syscall_table::Abi abi = request->data.arch == AUDIT_ARCH_I386 ? syscall_table::I386 : syscall_table::X86_64;
+        const syscall_table::PathArg& arg = syscall_table::describe(abi, request->data.nr).paths[0];
+        int dirfd = arg.dirfd >= 0 ? static_cast<int>(request->data.args[arg.dirfd]) : AT_FDCWD;
+
+        // The tracee is blocked until answered, so its memory, descriptors
+        // and cwd are read as the syscall will see them
+        std::string path = read_process_string(tid, request->data.args[arg.path]);
+        if (!path.empty() && path[0] != '/') {
+            std::string base = resolve_fd_path(tid, dirfd);
+            if (!base.empty()) {
+                path = resolve_relative_path(base, path);
+            }
+        }
+        auto task_it = tasks.find(tid);
+        if (task_it == tasks.end()) {
+            task_it = tasks.emplace(tid, TaskIdentity{process_attach::get_thread_group_id(tid),
+                                                      get_thread_name(tid)}).first;
+        }
+        bool valid = listener.is_valid(id);
+        if (!listener.continue_syscall(id) && errno != ENOENT) {
+            Logger::error("Failed to answer seccomp notification from ", tid, ": ", strerror(errno));
+        }
+        if (!valid || path.empty()) {
+            vanished += valid ? 0 : 1;
+            return;
+        }
+
+        FileOperation op;
+        op.pid = task_it->second.pid;
+        op.path = std::move(path);
+        op.sequence = 0;
+        op.thread_id = tid;
+        op.thread_name = task_it->second.name;
+        op.kind = OperationKind::OPEN;
+        op.fd = -1;
+        op.error = 0;
+        while (!operation_ring.try_push(std::move(op))) {
+            std::this_thread::yield();
+        }
+    };
+
+    bool running = true;
+    while (running) {
+        struct pollfd pfd = {listener.fd(), POLLIN, 0};
+        int timeout = 100;
+        while (poll(&pfd, 1, timeout) > 0 && (pfd.revents & POLLIN)) {
+            handle_notification();
+            timeout = 0;
+        }
+
+        while (true) {
+            int status;
+            pid_t reaped = waitpid(-1, &status, WNOHANG | __WALL);
+            if (reaped == -1) {
+                // ECHILD: the whole tree has exited
+                running = errno == EINTR;
+                break;
+            }
+            if (reaped == 0) {
+                break;
+            }
+            // Thread ids are not reused while their process lives
+            tasks.erase(reaped);
+        }
+    }
+
+    Logger::info("seccomp-notify statistics: ", notifications, " notifications, ", vanished,
+                 " from tasks that exited before they were answered");
+    return true;
+}
+
+// Function to observe a process tree by sampling /proc at a fixed interval
+// instead of intercepting its syscalls. A command is started untraced and
+// its whole tree sampled until it exits; with --pid the running process,
+// and with follow_children its descendants, are sampled until it exits or
+// the session is ended. Each path is reported when first seen; how often
+// and how long it was seen stays in the sampler for the report.
+bool run_sample_trace(const std::vector<std::string>& command, pid_t attach_pid, bool follow_children,
+                      unsigned int interval_ms, unsigned int duration, proc_sampler::ProcSampler& sampler) {
+    if (attach_pid > 0) {
+        struct sigaction sa = {};
+        sa.sa_handler = request_detach;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGINT, &sa, nullptr);
+        sigaction(SIGTERM, &sa, nullptr);
+        sigaction(SIGALRM, &sa, nullptr);
+        if (kill(attach_pid, 0) == -1 && errno == ESRCH) {
+            Logger::error("Failed to sample process ", attach_pid, ": no such process");
+            return false;
+        }
+        if (duration > 0) {
+            alarm(duration);
+        }
+    } else {
+        // Orphans are reparented to us and stay in the sampled tree
+        prctl(PR_SET_CHILD_SUBREAPER, 1, 0, 0, 0);
+        pid_t child = fork();
+        if (child == -1) {
+            Logger::error("Fork failed: ", strerror(errno));
+            return false;
+        }
+        if (child == 0) {
+            std::vector<char*> args;
+            for (const auto& arg : command) {
+                args.push_back(const_cast<char*>(arg.c_str()));
+            }
+            args.push_back(nullptr);
+            execvp(args[0], args.data());
+            Logger::error("Failed to execute ", command[0], ": ", strerror(errno));
+            _exit(127);
+        }
+    }
+
+    auto report = [](const std::string& path, const proc_sampler::Observation& observation) {
+        FileOperation op;
+        op.pid = observation.pid;
+        op.path = path;
+        op.sequence = 0;
+        op.thread_id = observation.pid;
+        op.thread_name = observation.process_name;
+        op.kind = OperationKind::OPEN;
+        op.fd = -1;
+        op.error = 0;
+        while (!operation_ring.try_push(std::move(op))) {
+            std::this_thread::yield();
+        }
+    };
+
+    const std::chrono::milliseconds interval(interval_ms);
+    auto next_sample = std::chrono::steady_clock::now();
+    while (!detach_requested) {
+        if (attach_pid > 0) {
+            if (kill(attach_pid, 0) == -1 && errno == ESRCH) {
+                break;
+            }
+            sampler.sample({attach_pid}, follow_children, report);
+        } else {
+            sampler.sample(process_attach::list_children(getpid()), true, report);
+            bool tree_exited = false;
+            while (true) {
+                pid_t reaped = waitpid(-1, nullptr, WNOHANG);
+                if (reaped == -1) {
+                    tree_exited = errno != EINTR;
+                    break;
+                }
+                if (reaped == 0) {
+                    break;
+                }
+            }
+            if (tree_exited) {
+                break;
+            }
+        }
+
+        // A sample that overran the interval delays the next one rather
+        // than being followed by a burst, so the rate never exceeds it
+        next_sample += interval;
+        auto now = std::chrono::steady_clock::now();
+        if (next_sample < now) {
+            next_sample = now;
+        }
+        std::this_thread::sleep_until(next_sample);
+    }
+
+    unsigned long long samples = sampler.sample_count();
+    Logger::info("Sampling statistics: ", samples, " samples of ", sampler.process_visits(),
+                 " processes in total, ", sampler.total_sample_ms(), " ms spent sampling (",
+                 (samples > 0 ? sampler.total_sample_ms() / samples : 0), " ms per sample), ",
+                 sampler.get_observations().size(), " files seen");
+    return true;
+}
+
+// Function to validate executable command
+bool validate_command(const std::string& command) {
+    try {
+        // Check if command is empty
+        if (command.empty()) {
+            Logger::error("Command cannot be empty");
+            return false;
         }
 
         // If command contains a path separator, check directly
@@ -496,6 +2622,174 @@ bool validate_command(const std::string& command) {
     }
 }
 
+// Function to launch command as a tracee of the calling thread and let it
+// run up to its first syscall stop. SIGCHLD must be blocked; the child
+// unblocks it and SIGUSR1. Returns the
+// child's pid, or -1 if it could not be forked.
+pid_t spawn_traced_command(const std::vector<std::string>& command) {
+    // Convert command vector to char* array for execvp
+    std::vector<char*> args;
+    args.reserve(command.size() + 1);
+    for (auto& arg : command) {
+        args.push_back(const_cast<char*>(arg.c_str()));
+    }
+    args.push_back(nullptr);
+
+    pid_t child = fork();
+    if (child == 0) {
+        sigset_t tracer_signals;
+        sigemptyset(&tracer_signals);
+        sigaddset(&tracer_signals, SIGCHLD);
+        sigaddset(&tracer_signals, SIGUSR1);
+        sigprocmask(SIG_UNBLOCK, &tracer_signals, nullptr);
+        ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+        // Stop to let parent set options
+        raise(SIGSTOP);
+
+        // Install the pre-filter only after the parent has enabled
+        // PTRACE_O_TRACESECCOMP, otherwise filtered syscalls fail with ENOSYS
+        std::vector<long> filtered = syscall_table::traced_syscalls(recorded_categories);
+        if (use_seccomp_filter &&
+            !seccomp_filter::install_filter(filtered,
+                                            syscall_table::traced_syscalls(recorded_categories,
+                                                                           syscall_table::I386),
+                                            seccomp_argument_tests(filtered))) {
+            Logger::error("Failed to install seccomp filter: ", strerror(errno));
+            exit(1);
+        }
+
+        if (use_preload) {
+            setenv("LD_PRELOAD", preload_backend::preload_list(preload_library, getenv("LD_PRELOAD")).c_str(), 1);
+            setenv(preload_backend::ring_env, preload_ring_name.c_str(), 1);
+        }
+
+        execvp(args[0], args.data());
+        Logger::error("Failed to execute ", command[0], ": ", strerror(errno));
+        exit(1);
+    }
+    if (child == -1) {
+        return -1;
+    }
+
+    // Create initial process entry in thread map
+    handle_thread_creation(0, child, true);
+
+    // Wait for child to stop (after SIGSTOP)
+    int status;
+    waitpid(child, &status, 0);
+    if (WIFSTOPPED(status)) {
+        // Set ptrace options for following forks
+        if (ptrace(PTRACE_SETOPTIONS, child, 0, get_ptrace_options()) == -1) {
+            Logger::error("Failed to set ptrace options: ", strerror(errno));
+        }
+        // Resume the child
+        resume_tracee(child);
+    }
+    return child;
+}
+
+// Function to read a --commands-from file: one shell command per line,
+// skipping blank lines and # comments
+bool read_batch_commands(const std::string& path, std::vector<std::string>& commands) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t start = line.find_first_not_of(" \t");
+        if (start != std::string::npos && line[start] != '#') {
+            commands.push_back(line.substr(start));
+        }
+    }
+    return true;
+}
+
+// Function to name the report of the index-th command of a batch:
+// trace.html becomes trace-3.html
+std::string batch_report_name(const std::string& output_file, size_t index) {
+    std::filesystem::path path(output_file);
+    std::filesystem::path name = path.stem().string() + "-" + std::to_string(index) + path.extension().string();
+    return (path.parent_path() / name).string();
+}
+
+// Function to trace a batch of shell commands on jobs tracer threads. Each
+// thread forks and traces its commands itself, since ptrace ties a tracee
+// to the thread that traced it, with its own thread_local tracing state.
+// With merge, every command records into one shared report; otherwise
+// each gets its own. Returns the number of commands that failed to run
+// or exited with a non-zero status.
+size_t run_batch(const std::vector<std::string>& commands, unsigned int jobs, const std::string& base_dir,
+                 bool show_failed, const std::string& output_file, bool merge) {
+    auto batch_start = std::chrono::steady_clock::now();
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> traced{0};
+    std::atomic<size_t> failed{0};
+    std::atomic<unsigned long long> stops{0};
+    ReportTarget merged;
+
+    auto tracer = [&]() {
+        TraceSession session;
+        if (!session.init(false)) {
+            Logger::error("Failed to set up a tracer event loop: ", session.get_last_error());
+            return;
+        }
+        for (size_t i = next++; i < commands.size(); i = next++) {
+            // Entries of the previous command's tracees are stale; their
+            // pids may be reused
+            thread_map.clear();
+            stop_retries.clear();
+
+            ReportTarget own;
+            ReportTarget& report = merge ? merged : own;
+            capture_done.store(false, std::memory_order_relaxed);
+            std::thread worker(report_worker, base_dir, show_failed, std::ref(report), std::ref(operation_ring),
+                               std::cref(capture_done), nullptr);
+
+            pid_t child = spawn_traced_command({"/bin/sh", "-c", commands[i]});
+            if (child == -1) {
+                Logger::error("Fork failed for command ", i + 1, ": ", strerror(errno));
+                failed++;
+            } else {
+                session.run(child);
+                int exit_status = thread_map[child].exit_status;
+                if (exit_status != 0) {
+                    Logger::warning("Command ", i + 1, " exited with status ", exit_status, ": ", commands[i]);
+                    failed++;
+                }
+            }
+            capture_done.store(true, std::memory_order_release);
+            worker.join();
+            traced++;
+            if (!merge) {
+                generate_html_output(own, batch_report_name(output_file, i + 1));
+            }
+        }
+        stops += session.stops();
+    };
+
+    std::vector<std::thread> tracers;
+    for (unsigned int j = 0; j < jobs; j++) {
+        tracers.emplace_back(tracer);
+    }
+    for (auto& thread : tracers) {
+        thread.join();
+    }
+
+    double batch_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - batch_start).count();
+    Logger::info("Batch statistics: ", traced.load(), " of ", commands.size(), " commands traced in ",
+                 batch_seconds, " s (", (batch_seconds > 0 ? traced / batch_seconds : 0), " commands/s) on ",
+                 jobs, " tracer threads, ", stops.load(), " stops, ", failed.load(), " failed");
+    if (merge) {
+        generate_html_output(merged, output_file);
+        Logger::info("Created visualization at ", output_file);
+    } else {
+        Logger::info("Created visualizations at ", batch_report_name(output_file, 1), " to ",
+                     batch_report_name(output_file, commands.size()));
+    }
+    return failed + (commands.size() - traced);
+}
+
 // Function to display help message
 void display_help(const cxxopts::Options& options) {
     std::cout << options.help() << std::endl;
@@ -504,6 +2798,18 @@ void display_help(const cxxopts::Options& options) {
     std::cout << "  filetrace --output-html trace.html gcc -c file.c # Custom output file" << std::endl;
     std::cout << "  filetrace -a make                               # Show all files" << std::endl;
     std::cout << "  filetrace -d /path/to/dir ls                    # Filter files in directory" << std::endl;
+    std::cout << "  filetrace --seccomp make -j8                    # Low-overhead tracing" << std::endl;
+    std::cout << "  filetrace --syscalls=open,stat,unlink make      # Record more than opens" << std::endl;
+    std::cout << "  filetrace --backend=preload make -j8            # Opens without ptrace stops" << std::endl;
+    std::cout << "  filetrace --backend=seccomp-notify make -j8     # Opens without ptrace" << std::endl;
+    std::cout << "  filetrace --backend=fanotify make -j8           # Native-speed tracing (root)" << std::endl;
+    std::cout << "  filetrace --backend=ebpf make -j8               # In-kernel filtering (root)" << std::endl;
+    std::cout << "  filetrace -p 1234 --follow-children --duration 30 # Attach to a running service" << std::endl;
+    std::cout << "  filetrace -p 1234 --sample-interval=100          # Sample open files, no interception" << std::endl;
+    std::cout << "  filetrace --jobs 8 --commands-from cmds.txt      # Trace a batch of commands" << std::endl;
+    std::cout << "  filetrace --control-fifo /tmp/ft.ctl make -j8   # echo pass > /tmp/ft.ctl to pause recording" << std::endl;
+    std::cout << "  filetrace --seccomp --start-on-exec=cc1 make    # Record from the first compiler run on" << std::endl;
+    std::cout << "  filetrace -p 1234 --flight-recorder=30s          # Keep the last 30 s, dump on SIGUSR2" << std::endl;
     std::cout << "  filetrace -- ./script.sh                        # Trace a script" << std::endl;
 }
 
@@ -517,6 +2823,36 @@ int main(int argc, char* argv[]) try {
             ("a,all", "Show all files (disable directory filtering)")
             ("d,directory", "Base directory for file filtering (default: current directory)",
              cxxopts::value<std::string>())
+            ("seccomp", "Use a seccomp-BPF pre-filter so tracees only stop on file/process syscalls")
+            ("show-failed", "Include failed opens in the report")
+            ("syscalls", "Syscall categories to record, comma-separated: open, stat, access, readlink, rename, unlink, mkdir, link, truncate, chdir, exec, handle or all (default: open,exec)",
+             cxxopts::value<std::string>())
+            ("backend", "Tracing backend: ptrace (syscall-precise), preload (LD_PRELOAD for dynamically linked programs, ptrace for the rest), seccomp-notify (seccomp user notifications, opens only), fanotify (native speed, opens only) or ebpf (in-kernel filtering, opens only)",
+             cxxopts::value<std::string>()->default_value("ptrace"))
+            ("p,pid", "Attach to the running process with this PID instead of launching a command",
+             cxxopts::value<pid_t>())
+            ("follow-children", "With --pid, also attach to the process's existing descendants")
+            ("duration", "With --pid, detach after this many seconds (default: until interrupted)",
+             cxxopts::value<unsigned int>())
+            ("sample-interval", "Instead of tracing, sample open and mapped files from /proc every this many milliseconds; misses short-lived opens",
+             cxxopts::value<unsigned int>())
+            ("commands-from", "Trace each line of this file as a shell command instead of a single command; writes one report per command, numbered after the output file",
+             cxxopts::value<std::string>())
+            ("jobs", "With --commands-from, trace this many commands at a time, each tracer on its own thread (default: 1)",
+             cxxopts::value<unsigned int>()->default_value("1"))
+            ("merge-reports", "With --commands-from, write one report of all commands to the output file")
+            ("control-fifo", "Create this FIFO and switch between recording and pass-through on the commands \"record\", \"pass\" and \"toggle\" written to it, as SIGUSR1 toggles",
+             cxxopts::value<std::string>())
+            ("start-on-open", "Record nothing until a path matching this glob is opened; a glob without '/' matches the file name",
+             cxxopts::value<std::vector<std::string>>())
+            ("start-on-exec", "Record nothing until a binary whose name matches this glob is executed",
+             cxxopts::value<std::vector<std::string>>())
+            ("stop-on-open", "Pause recording after a path matching this glob is opened",
+             cxxopts::value<std::vector<std::string>>())
+            ("stop-on-exec", "Pause recording when a binary whose name matches this glob is executed",
+             cxxopts::value<std::vector<std::string>>())
+            ("flight-recorder", "Keep only the most recent operations, a number of them (50000, at most 1048576) or those of a duration (30s), and write them out on SIGUSR2, when a traced process crashes and on exit",
+             cxxopts::value<std::string>())
             ("h,help", "Display this help message")
             ("v,version", "Display version information")
             ("command", "Command to execute", cxxopts::value<std::vector<std::string>>())
@@ -542,7 +2878,10 @@ int main(int argc, char* argv[]) try {
             }
 
             // Validate command presence
-            if (!result.count("command")) {
+            pid_t attach_pid = result.count("pid") ? result["pid"].as<pid_t>() : 0;
+            attach_mode = attach_pid > 0;
+            bool batch_mode = result.count("commands-from") > 0;
+            if (!attach_mode && !batch_mode && !result.count("command")) {
                 Logger::error("Error: No command specified");
                 display_help(options);
                 return 1;
@@ -558,6 +2897,8 @@ int main(int argc, char* argv[]) try {
 
             // Process directory filtering options
             path_utils::disable_directory_filtering = result.count("all") > 0;
+            use_seccomp_filter = result.count("seccomp") > 0;
+            bool show_failed = result.count("show-failed") > 0;
             std::string base_dir;
             if (result.count("directory")) {
                 base_dir = result["directory"].as<std::string>();
@@ -570,334 +2911,319 @@ int main(int argc, char* argv[]) try {
                 base_dir = path_utils::get_current_directory();
             }
 
-            // Process command and arguments
-            std::vector<std::string> command = result["command"].as<std::vector<std::string>>();
-            if (command.empty()) {
-                Logger::error("Error: Empty command specified");
-                display_help(options);
+            std::string backend = result["backend"].as<std::string>();
+            if (backend != "ptrace" && backend != "preload" && backend != "seccomp-notify" &&
+                backend != "fanotify" && backend != "ebpf") {
+                Logger::error("Error: Unknown backend: ", backend);
+                return 1;
+            }
+            unsigned int sample_interval = result.count("sample-interval") ?
+                result["sample-interval"].as<unsigned int>() : 0;
+            if (result.count("sample-interval") && sample_interval == 0) {
+                Logger::error("Error: --sample-interval must be at least 1 ms");
+                return 1;
+            }
+            if (sample_interval > 0 && (backend != "ptrace" || use_seccomp_filter)) {
+                Logger::error("Error: --sample-interval cannot be combined with --backend or --seccomp");
+                return 1;
+            }
+            if (result.count("syscalls")) {
+                std::string error;
+                if (!syscall_table::parse_categories(result["syscalls"].as<std::string>(), recorded_categories,
+                                                     error)) {
+                    Logger::error("Error: ", error);
+                    return 1;
+                }
+                // Only syscall stops see more than opens
+                if ((backend != "ptrace" && backend != "preload") || sample_interval > 0) {
+                    Logger::error("Error: --syscalls requires the ptrace or preload backend");
+                    return 1;
+                }
+            }
+            if (backend != "ptrace" && (attach_mode || use_seccomp_filter)) {
+                Logger::error("Error: --pid and --seccomp require the ptrace backend");
+                return 1;
+            }
+            if (result.count("control-fifo") && ((backend != "ptrace" && backend != "preload") || sample_interval > 0)) {
+                Logger::error("Error: --control-fifo requires the ptrace or preload backend");
+                return 1;
+            }
+            for (const auto& trigger : {std::make_pair("start-on-open", &recording_triggers.start_open),
+                                        std::make_pair("start-on-exec", &recording_triggers.start_exec),
+                                        std::make_pair("stop-on-open", &recording_triggers.stop_open),
+                                        std::make_pair("stop-on-exec", &recording_triggers.stop_exec)}) {
+                if (result.count(trigger.first)) {
+                    *trigger.second = result[trigger.first].as<std::vector<std::string>>();
+                }
+            }
+            bool has_triggers = recording_triggers.armed() || !recording_triggers.stop_open.empty() ||
+                                !recording_triggers.stop_exec.empty();
+            if (has_triggers && (backend != "ptrace" || sample_interval > 0)) {
+                Logger::error("Error: --start-on-* and --stop-on-* require the ptrace backend");
+                return 1;
+            }
+            if (recording_triggers.uses_opens() && !(recorded_categories & syscall_table::OPEN)) {
+                Logger::error("Error: --start-on-open and --stop-on-open require opens to be recorded");
                 return 1;
             }
+            if (recording_triggers.armed()) {
+                recording.store(false);
+            }
+            flight_recorder::Limit flight_limit;
+            bool use_flight_recorder = result.count("flight-recorder") > 0;
+            if (use_flight_recorder) {
+                std::string error;
+                if (!flight_recorder::parse_limit(result["flight-recorder"].as<std::string>(), flight_limit, error)) {
+                    Logger::error("Error: ", error);
+                    return 1;
+                }
+                if (sample_interval > 0 || batch_mode) {
+                    Logger::error("Error: --flight-recorder cannot be combined with --sample-interval or --commands-from");
+                    return 1;
+                }
+            }
 
-            // Validate command exists and is executable
-            if (!validate_command(command[0])) {
+            unsigned int jobs = result["jobs"].as<unsigned int>();
+            if ((result.count("jobs") || result.count("merge-reports")) && !batch_mode) {
+                Logger::error("Error: --jobs and --merge-reports require --commands-from");
                 return 1;
             }
+            if (batch_mode) {
+                if (attach_mode || result.count("command")) {
+                    Logger::error("Error: --commands-from cannot be combined with --pid or a command");
+                    return 1;
+                }
+                if (backend != "ptrace" || sample_interval > 0) {
+                    Logger::error("Error: --commands-from requires the ptrace backend");
+                    return 1;
+                }
+                if (result.count("control-fifo")) {
+                    Logger::error("Error: --control-fifo cannot be combined with --commands-from");
+                    return 1;
+                }
+                if (jobs == 0) {
+                    Logger::error("Error: --jobs must be at least 1");
+                    return 1;
+                }
+                std::vector<std::string> commands;
+                std::string commands_file = result["commands-from"].as<std::string>();
+                if (!read_batch_commands(commands_file, commands)) {
+                    Logger::error("Error: Cannot read commands from ", commands_file);
+                    return 1;
+                }
+                jobs = std::min<unsigned int>(jobs, std::max<size_t>(commands.size(), 1));
+                Logger::info("Tracing ", commands.size(), " commands from ", commands_file, " with ", jobs,
+                             " tracer threads");
+
+                // Each tracer thread notices SIGUSR1 at its next stop
+                struct sigaction toggle = {};
+                toggle.sa_handler = request_recording_toggle;
+                sigemptyset(&toggle.sa_mask);
+                sigaction(SIGUSR1, &toggle, nullptr);
+
+                // Blocked before the tracer threads start, which inherit it;
+                // their sessions wait in waitpid rather than on SIGCHLD
+                sigset_t sigchld;
+                sigemptyset(&sigchld);
+                sigaddset(&sigchld, SIGCHLD);
+                sigprocmask(SIG_BLOCK, &sigchld, nullptr);
+                return run_batch(commands, jobs, base_dir, show_failed, output_file,
+                                 result.count("merge-reports") > 0) == 0 ? 0 : 1;
+            }
+
+            // Process command and arguments
+            std::vector<std::string> command;
+            if (attach_mode) {
+                if (result.count("command")) {
+                    Logger::error("Error: --pid cannot be combined with a command");
+                    return 1;
+                }
+                if (use_seccomp_filter) {
+                    // The filter can only be installed by the tracee itself before exec
+                    Logger::error("Error: --seccomp cannot be combined with --pid");
+                    return 1;
+                }
+                command.push_back("pid " + std::to_string(attach_pid));
+            } else {
+                command = result["command"].as<std::vector<std::string>>();
+                if (command.empty()) {
+                    Logger::error("Error: Empty command specified");
+                    display_help(options);
+                    return 1;
+                }
+
+                // Validate command exists and is executable
+                if (!validate_command(command[0])) {
+                    return 1;
+                }
+            }
 
             Logger::info("Starting file trace with options:");
             Logger::info("  Output file: ", output_file);
             Logger::info("  Base directory: ", base_dir);
             Logger::info("  Directory filtering: ", (path_utils::disable_directory_filtering ? "disabled" : "enabled"));
+            Logger::info("  Backend: ", backend);
+            Logger::info("  Tracing mode: ",
+                         (sample_interval > 0 ? "sampling every " + std::to_string(sample_interval) + " ms" :
+                          use_seccomp_filter ? "seccomp pre-filter" : "every syscall"));
             Logger::info("  Command: ", command[0]);
-            std::vector<FileOperation> operations;
 
             Logger::info("Output will be saved to: ", output_file);
             Logger::info("Monitoring file operations...");
-            pid_t child = fork();
-
-            if (child == 0) {
-            // Child process
-            ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
-            // Stop to let parent set options
-            raise(SIGSTOP);
-            
-            // Convert command vector to char* array for execvp
-            std::vector<char*> args;
-            args.reserve(command.size() + 1);
-            for (auto& arg : command) {
-                args.push_back(const_cast<char*>(arg.c_str()));
-            }
-            args.push_back(nullptr);
-            
-            execvp(args[0], args.data());
-            Logger::error("Failed to execute ", command[0], ": ", strerror(errno));
-            exit(1);
-            } else if (child > 0) {
-        // Create initial process entry in thread map
-        handle_thread_creation(0, child, true);
-        // Parent process
-        int status;
-        user_regs_struct regs;
-        bool in_syscall = false;
-
-        // Wait for child to stop (after SIGSTOP)
-        waitpid(child, &status, 0);
-        if (WIFSTOPPED(status)) {
-            // Set ptrace options for following forks
-            if (ptrace(PTRACE_SETOPTIONS, child, 0,
-                      PTRACE_O_TRACEFORK | PTRACE_O_TRACEVFORK | PTRACE_O_TRACECLONE |
-                      PTRACE_O_TRACEEXIT | PTRACE_O_TRACEEXEC) == -1) {
-                Logger::error("Failed to set ptrace options: ", strerror(errno));
-            }
-            // Resume the child
-            ptrace(PTRACE_SYSCALL, child, nullptr, nullptr);
-        }
 
-        while (true) {
-            pid_t waited_pid = waitpid(-1, &status, __WALL);
-            if (waited_pid == -1) {
-                if (errno == ECHILD) {
-                    // Enhanced ECHILD error handling
-                    Logger::warning("No child processes found (ECHILD). Checking thread states...");
-                    bool any_active = false;
-                    std::vector<pid_t> threads_to_cleanup;
-                    
-                    // First pass: identify threads that need cleanup
-                    for (const auto& thread : thread_map) {
-                        if (thread.second.active) {
-                            if (kill(thread.first, 0) == -1) {
-                                if (errno == ESRCH) {
-                                    threads_to_cleanup.push_back(thread.first);
-                                } else {
-                                    Logger::warning("Error checking thread ", thread.first, 
-                                                  ": ", strerror(errno));
-                                }
-                            } else {
-                                any_active = true;
-                            }
-                        }
-                    }
-                    
-                    // Second pass: cleanup terminated threads
-                    for (pid_t tid : threads_to_cleanup) {
-                        Logger::debug("Cleaning up terminated thread ", tid);
-                        handle_thread_exit(tid, -1);
-                        
-                        // Attempt to detach if still attached
-                        if (ptrace(PTRACE_DETACH, tid, nullptr, nullptr) == -1 && errno != ESRCH) {
-                            Logger::warning("Failed to detach from thread ", tid, 
-                                          ": ", strerror(errno));
-                        }
-                    }
-                    
-                    if (!any_active) {
-                        Logger::info("All threads have terminated. Exiting...");
-                        break;
-                    }
-                    
-                    // Some threads might still be running but not traced
-                    usleep(10000); // Increased sleep to reduce CPU usage
-                    continue;
+            if (sample_interval > 0) {
+                ReportTarget report;
+                proc_sampler::ProcSampler sampler;
+                std::thread worker(report_worker, base_dir, show_failed, std::ref(report), std::ref(operation_ring),
+                                   std::cref(capture_done), nullptr);
+                bool sampled = run_sample_trace(command, attach_pid, result.count("follow-children") > 0,
+                                                sample_interval,
+                                                result.count("duration") ? result["duration"].as<unsigned int>() : 0,
+                                                sampler);
+                capture_done.store(true, std::memory_order_release);
+                worker.join();
+                if (!sampled) {
+                    return 1;
                 }
-                
-                Logger::error("waitpid failed: ", strerror(errno));
-                // Try to cleanup remaining threads before breaking
-                for (const auto& thread : thread_map) {
-                    if (thread.second.active) {
-                        handle_thread_exit(thread.first, -1);
-                    }
+                for (const auto& observation : sampler.get_observations()) {
+                    report.dir_tree.annotate_observations(observation.first, observation.second.first_seen_ms,
+                                                   observation.second.last_seen_ms, observation.second.count);
                 }
-                break;
+                generate_html_output(report, output_file);
+                Logger::info("Created visualization at ", output_file);
+                return 0;
             }
-            
-            if (WIFEXITED(status) || WIFSIGNALED(status)) {
-                // Handle thread/process termination
-                int exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
-                handle_thread_exit(waited_pid, exit_code);
-                
-                // Check if this was the main process
-                if (waited_pid == child && (WIFEXITED(status) || WIFSIGNALED(status))) {
-                    // Main process exited, cleanup remaining threads
-                    for (auto& thread : thread_map) {
-                        if (thread.second.active && thread.first != child) {
-                            if (ptrace(PTRACE_DETACH, thread.first, nullptr, nullptr) != -1) {
-                                handle_thread_exit(thread.first, -1);
-                            }
-                        }
-                    }
+
+            if (backend == "seccomp-notify" || backend == "fanotify" || backend == "ebpf") {
+                ReportTarget report;
+                if (use_flight_recorder) {
+                    enable_flight_recorder(report, flight_limit, output_file);
                 }
-                continue;
+                std::thread worker(report_worker, base_dir, show_failed, std::ref(report), std::ref(operation_ring),
+                                   std::cref(capture_done), nullptr);
+                bool traced = backend == "seccomp-notify" ? run_notify_trace(command) :
+                              backend == "fanotify" ? run_fanotify_trace(command, base_dir) :
+                              run_ebpf_trace(command);
+                capture_done.store(true, std::memory_order_release);
+                worker.join();
+                if (!traced) {
+                    return 1;
+                }
+                generate_html_output(report, output_file);
+                Logger::info("Created visualization at ", output_file);
+                return 0;
             }
 
-            if (WIFSTOPPED(status)) {
-                // Check for fork/clone/vfork events
-                if (status >> 8 == (SIGTRAP | (PTRACE_EVENT_FORK << 8)) ||
-                    status >> 8 == (SIGTRAP | (PTRACE_EVENT_VFORK << 8)) ||
-                    status >> 8 == (SIGTRAP | (PTRACE_EVENT_CLONE << 8))) {
-                    
-                    unsigned long new_pid;
-                    if (ptrace(PTRACE_GETEVENTMSG, waited_pid, nullptr, &new_pid) != -1) {
-                        bool is_process = (status >> 8 == (SIGTRAP | (PTRACE_EVENT_FORK << 8)) ||
-                                        status >> 8 == (SIGTRAP | (PTRACE_EVENT_VFORK << 8)));
-                        
-                        // Enhanced fork/clone event handling
-                        handle_thread_creation(waited_pid, new_pid, is_process);
-                        
-                        // Wait for the new process/thread to stop
-                        int new_status;
-                        if (waitpid(new_pid, &new_status, __WALL) != -1) {
-                            if (WIFSTOPPED(new_status)) {
-                                // Set options for the new process/thread
-                                if (ptrace(PTRACE_SETOPTIONS, new_pid, 0,
-                                        PTRACE_O_TRACEFORK | PTRACE_O_TRACEVFORK | PTRACE_O_TRACECLONE |
-                                        PTRACE_O_TRACEEXIT | PTRACE_O_TRACEEXEC) == -1) {
-                                    Logger::error("Failed to set ptrace options for new process/thread ", 
-                                                new_pid, ": ", strerror(errno));
-                                }
-                                
-                                // Resume the new process/thread
-                                if (ptrace(PTRACE_SYSCALL, new_pid, nullptr, nullptr) == -1) {
-                                    Logger::error("Failed to resume new process/thread ", 
-                                                new_pid, ": ", strerror(errno));
-                                }
-                            } else {
-                                Logger::warning("New process/thread ", new_pid, 
-                                              " not stopped as expected");
-                            }
-                        } else {
-                            Logger::error("Failed to wait for new process/thread ", 
-                                        new_pid, ": ", strerror(errno));
-                        }
-                    } else {
-                        Logger::error("Failed to get event message for process/thread creation: ", 
-                                    strerror(errno));
-                    }
-                    
-                    // Resume the parent process
-                    if (ptrace(PTRACE_SYSCALL, waited_pid, nullptr, nullptr) == -1) {
-                        Logger::error("Failed to resume parent process ", 
-                                    waited_pid, ": ", strerror(errno));
-                    }
-                    continue;
+            // The ring is created before the fork so that the child can
+            // name it in the environment it passes on
+            preload_backend::EventRing preload_ring;
+            if (backend == "preload") {
+                preload_library = preload_backend::locate_library();
+                if (preload_library.empty()) {
+                    Logger::error("Error: ", preload_backend::library_name, " not found next to filetrace");
+                    return 1;
                 }
-
-                // Validate thread state before continuing
-                auto thread_it = thread_map.find(waited_pid);
-                if (thread_it == thread_map.end()) {
-                    // New thread detected, create entry
-                    handle_thread_creation(child, waited_pid);
-                    thread_it = thread_map.find(waited_pid);
+                if (!preload_ring.init()) {
+                    Logger::error("Failed to create the preload event ring: ", preload_ring.get_last_error());
+                    return 1;
                 }
-                
-                if (!thread_it->second.active) {
-                    // Thread marked as inactive, detach from it
-                    if (ptrace(PTRACE_DETACH, waited_pid, nullptr, nullptr) == -1) {
-                        Logger::error("Failed to detach from terminated thread ", waited_pid, 
-                                    ": ", strerror(errno));
-                    }
-                    continue;
+                use_preload = true;
+                preload_ring_name = preload_ring.name();
+            }
+
+            // SIGCHLD is read from a signalfd by the tracer loop; blocked
+            // before the report worker starts so that it is not delivered
+            // to that thread instead. SIGUSR1 switches between recording
+            // and pass-through; it is blocked until the worker has started
+            // so that it interrupts the tracer's wait instead.
+            struct sigaction toggle = {};
+            toggle.sa_handler = request_recording_toggle;
+            sigemptyset(&toggle.sa_mask);
+            sigaction(SIGUSR1, &toggle, nullptr);
+            sigset_t tracer_signals;
+            sigemptyset(&tracer_signals);
+            sigaddset(&tracer_signals, SIGCHLD);
+            sigaddset(&tracer_signals, SIGUSR1);
+            sigprocmask(SIG_BLOCK, &tracer_signals, nullptr);
+            TraceSession session;
+            if (!session.init()) {
+                Logger::error("Failed to set up the tracer event loop: ", session.get_last_error());
+                return 1;
+            }
+            if (result.count("control-fifo")) {
+                std::string fifo = result["control-fifo"].as<std::string>();
+                if (mkfifo(fifo.c_str(), 0600) == -1 && errno != EEXIST) {
+                    Logger::error("Failed to create control FIFO ", fifo, ": ", strerror(errno));
+                    return 1;
                 }
-                // Validate thread state before accessing registers
-                if (kill(waited_pid, 0) == -1) {
-                    if (errno == ESRCH) {
-                        // Thread no longer exists
-                        handle_thread_exit(waited_pid, -1);
-                        continue;
-                    }
+                // Read-write, so that the FIFO never reports end of file
+                // between writers
+                int control_fd = open(fifo.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+                if (control_fd == -1 || !session.watch_control(control_fd)) {
+                    Logger::error("Failed to open control FIFO ", fifo, ": ",
+                                  control_fd == -1 ? strerror(errno) : session.get_last_error());
+                    return 1;
                 }
+            }
 
-                // Enhanced register access error recovery
-                int retry_count = 0;
-                const int max_retries = 5;  // Increased retry limit
-                bool registers_obtained = false;
-                
-                while (retry_count < max_retries) {
-                    if (ptrace(PTRACE_GETREGS, waited_pid, nullptr, &regs) != -1) {
-                        registers_obtained = true;
-                        break;
-                    }
-                    
-                    if (errno == ESRCH) {
-                        Logger::debug("Thread ", waited_pid, " terminated during register access");
-                        handle_thread_exit(waited_pid, -1);
-                        break;
-                    } else if (errno == EINVAL) {
-                        Logger::warning("Invalid thread state for ", waited_pid, 
-                                      ". Attempt ", (retry_count + 1), "/", max_retries);
-                        
-                        // Check if thread is still alive
-                        if (kill(waited_pid, 0) == -1 && errno == ESRCH) {
-                            Logger::debug("Thread ", waited_pid, " terminated during recovery");
-                            handle_thread_exit(waited_pid, -1);
-                            break;
-                        }
-                        
-                        // Exponential backoff for retries
-                        usleep(1000 * (1 << retry_count));
-                        retry_count++;
-                        continue;
-                    }
-                    
-                    Logger::error("Failed to get registers for thread ", waited_pid, 
-                                ": ", strerror(errno));
-                    break;
-                }
+            auto trace_start = std::chrono::steady_clock::now();
+            pid_t child = attach_pid;
+            if (attach_mode) {
+                // Seized tracees report a PTRACE_EVENT_STOP that the session
+                // resumes like any other event stop. SIGINT and the duration
+                // alarm interrupt its wait to end the session.
+                struct sigaction sa = {};
+                sa.sa_handler = request_detach;
+                sigemptyset(&sa.sa_mask);
+                sigaction(SIGINT, &sa, nullptr);
+                sigaction(SIGTERM, &sa, nullptr);
+                sigaction(SIGALRM, &sa, nullptr);
 
-                if (!registers_obtained) {
-                    Logger::error("Failed to recover thread ", waited_pid, " state after ", 
-                                retry_count, " attempts");
-                    handle_thread_exit(waited_pid, -1);
-                    continue;
-                }
-            
-                if (!in_syscall) {
-                    handle_syscall_entry(waited_pid, regs, operations, base_dir);
-                }
-                in_syscall = !in_syscall;
-            
-                // Validate thread state before continuing
-                if (kill(waited_pid, 0) == -1) {
-                    if (errno == ESRCH) {
-                        handle_thread_exit(waited_pid, -1);
-                        continue;
-                    }
+                if (!attach_process_tree(attach_pid, result.count("follow-children") > 0)) {
+                    detach_all_tracees();
+                    return 1;
                 }
-                
-                // Enhanced ptrace continuation error recovery
-                int continue_retry = 0;
-                const int max_continue_retries = 3;
-                bool continuation_successful = false;
-                
-                while (continue_retry < max_continue_retries) {
-                    if (ptrace(PTRACE_SYSCALL, waited_pid, nullptr, nullptr) != -1) {
-                        continuation_successful = true;
-                        break;
-                    }
-                    
-                    if (errno == ESRCH) {
-                        Logger::debug("Thread ", waited_pid, " terminated during continuation");
-                        handle_thread_exit(waited_pid, -1);
-                        break;
-                    } else if (errno == EINVAL || errno == EIO) {
-                        Logger::warning("Failed to continue thread ", waited_pid, 
-                                      " (attempt ", (continue_retry + 1), "/", max_continue_retries,
-                                      "): ", strerror(errno));
-                        
-                        // Verify thread state
-                        if (kill(waited_pid, 0) == -1) {
-                            if (errno == ESRCH) {
-                                Logger::debug("Thread ", waited_pid, " terminated during retry");
-                                handle_thread_exit(waited_pid, -1);
-                                break;
-                            }
-                        }
-                        
-                        usleep(1000 * (1 << continue_retry));
-                        continue_retry++;
-                        continue;
-                    }
-                    
-                    Logger::error("Failed to continue thread ", waited_pid, 
-                                ": ", strerror(errno));
-                    break;
+                if (result.count("duration")) {
+                    alarm(result["duration"].as<unsigned int>());
                 }
-                
-                if (!continuation_successful) {
-                    Logger::error("Failed to continue thread ", waited_pid, 
-                                " after ", continue_retry, " attempts");
-                    // Attempt to cleanup the thread
-                    handle_thread_exit(waited_pid, -1);
-                    continue;
+            } else {
+                child = spawn_traced_command(command);
+                if (child == -1) {
+                    Logger::error("Fork failed: ", strerror(errno));
+                    return 1;
                 }
             }
-        }
 
-        generate_html_output(operations, output_file);
-        Logger::info("Created visualization at ", output_file);
-            } else {
-                Logger::error("Fork failed: ", strerror(errno));
-                return 1;
+            // Report worker, fed through operation_ring by the session below
+            ReportTarget report;
+            if (use_flight_recorder) {
+                enable_flight_recorder(report, flight_limit, output_file);
             }
+            std::thread worker(report_worker, base_dir, show_failed, std::ref(report), std::ref(operation_ring),
+                               std::cref(capture_done), use_preload ? &preload_ring : nullptr);
+            sigset_t sigusr1;
+            sigemptyset(&sigusr1);
+            sigaddset(&sigusr1, SIGUSR1);
+            sigprocmask(SIG_UNBLOCK, &sigusr1, nullptr);
+            session.run(child);
 
+            double trace_seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - trace_start).count();
+            Logger::info("Tracer statistics: ", session.stops(), " stops in ", trace_seconds, " s (",
+                         (trace_seconds > 0 ? session.stops() / trace_seconds : 0), " stops/s), ",
+                         stop_retries.total_scheduled(), " stop retries, ", abandoned_retries, " abandoned");
+
+            // The worker has been building the tree all along; only the
+            // operations still in the ring remain
+            capture_done.store(true, std::memory_order_release);
+            worker.join();
+            if (use_preload) {
+                Logger::info("Preload statistics: ", preload_ring.total(), " opens from preloaded processes, ",
+                             session.execs_traced(), " execs traced through ptrace, ", preload_ring.dropped(),
+                             " events dropped on a full ring");
+            }
+            generate_html_output(report, output_file);
+            Logger::info("Created visualization at ", output_file);
             return 0;
         } catch (const std::exception& e) {
             Logger::error("Command line parsing error: ", e.what());
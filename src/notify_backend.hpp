@@ -0,0 +1,149 @@
+#ifndef NOTIFY_BACKEND_HPP
+#define NOTIFY_BACKEND_HPP
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <linux/seccomp.h>
+#include <linux/filter.h>
+#include <sys/ioctl.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include "seccomp_filter.hpp"
+#include "syscall_table.hpp"
+
+namespace notify_backend {
+
+// Syscalls reported through the listener: the open category of the
+// syscall table. Descriptor and working directory changes need no
+// tracking here: a notified tracee is blocked in its syscall, so /proc
+// shows its descriptors and cwd as the syscall sees them.
+inline const std::vector<long> notified_syscalls = syscall_table::syscalls_in(syscall_table::OPEN);
+inline const std::vector<long> notified_compat_syscalls =
+    syscall_table::syscalls_in(syscall_table::OPEN, syscall_table::I386);
+
+// Install a filter returning SECCOMP_RET_USER_NOTIF for syscalls, and for
+// compat_syscalls made by 32-bit code, in the calling process and return
+// its listener descriptor, -1 on failure. The filter is inherited by every
+// descendant, whose notifications all arrive on the one listener.
+inline int install_listener(const std::vector<long>& syscalls, const std::vector<long>& compat_syscalls = {}) {
+    std::vector<sock_filter> filter =
+        seccomp_filter::build_compat_filter(syscalls, compat_syscalls, SECCOMP_RET_USER_NOTIF);
+    struct sock_fprog prog;
+    prog.len = static_cast<unsigned short>(filter.size());
+    prog.filter = filter.data();
+
+    if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) == -1) {
+        return -1;
+    }
+    return static_cast<int>(syscall(SYS_seccomp, SECCOMP_SET_MODE_FILTER, SECCOMP_FILTER_FLAG_NEW_LISTENER, &prog));
+}
+
+// Pass a descriptor over a Unix socket
+inline bool send_fd(int socket, int fd) {
+    char byte = 0;
+    struct iovec iov = {&byte, 1};
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    return sendmsg(socket, &msg, 0) == 1;
+}
+
+// Receive a descriptor sent with send_fd, -1 if none arrived
+inline int receive_fd(int socket) {
+    char byte;
+    struct iovec iov = {&byte, 1};
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(socket, &msg, MSG_CMSG_CLOEXEC) != 1) {
+        return -1;
+    }
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == nullptr || cmsg->cmsg_type != SCM_RIGHTS) {
+        return -1;
+    }
+    int fd;
+    std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    return fd;
+}
+
+// Server side of a seccomp listener. Every notification must be answered,
+// or the tracee stays blocked in its syscall.
+class NotificationListener {
+public:
+    explicit NotificationListener(int listener_fd) : listener(listener_fd) {
+        // The kernel's structures may grow; size buffers as it asks
+        struct seccomp_notif_sizes sizes = {};
+        if (syscall(SYS_seccomp, SECCOMP_GET_NOTIF_SIZES, 0, &sizes) == -1) {
+            sizes.seccomp_notif = sizeof(struct seccomp_notif);
+            sizes.seccomp_notif_resp = sizeof(struct seccomp_notif_resp);
+        }
+        request_buffer.resize(std::max<size_t>(sizes.seccomp_notif, sizeof(struct seccomp_notif)));
+        response_buffer.resize(std::max<size_t>(sizes.seccomp_notif_resp, sizeof(struct seccomp_notif_resp)));
+    }
+
+    ~NotificationListener() {
+        if (listener != -1) {
+            close(listener);
+        }
+    }
+
+    NotificationListener(const NotificationListener&) = delete;
+    NotificationListener& operator=(const NotificationListener&) = delete;
+
+    // Listener descriptor; readable when a notification is pending
+    int fd() const {
+        return listener;
+    }
+
+    // Take the next notification; blocks if none is pending. Fails with
+    // ENOENT when the notifying task died before it was read.
+    const struct seccomp_notif* receive() {
+        std::fill(request_buffer.begin(), request_buffer.end(), 0);
+        auto* request = reinterpret_cast<struct seccomp_notif*>(request_buffer.data());
+        if (ioctl(listener, SECCOMP_IOCTL_NOTIF_RECV, request) == -1) {
+            return nullptr;
+        }
+        return request;
+    }
+
+    // Whether the task behind notification id is still blocked on it, so
+    // that what was read from its pid belongs to it and not to a reuse
+    bool is_valid(uint64_t id) const {
+        return ioctl(listener, SECCOMP_IOCTL_NOTIF_ID_VALID, &id) == 0;
+    }
+
+    // Let the notified syscall run as if no filter had trapped it
+    bool continue_syscall(uint64_t id) {
+        std::fill(response_buffer.begin(), response_buffer.end(), 0);
+        auto* response = reinterpret_cast<struct seccomp_notif_resp*>(response_buffer.data());
+        response->id = id;
+        response->flags = SECCOMP_USER_NOTIF_FLAG_CONTINUE;
+        return ioctl(listener, SECCOMP_IOCTL_NOTIF_SEND, response) == 0;
+    }
+
+private:
+    int listener;
+    std::vector<char> request_buffer;
+    std::vector<char> response_buffer;
+};
+
+} // namespace notify_backend
+
+#endif // NOTIFY_BACKEND_HPP
@@ -52,6 +52,16 @@ inline std::string normalize_path(const std::string& path) {
     return result;
 }
 
+// Normalize an absolute path lexically: collapse "//", "." and ".."
+// without touching the filesystem, so symlinks are left unresolved
+inline std::string lexical_normalize(const std::string& path) {
+    std::string result = std::filesystem::path(path).lexically_normal().string();
+    if (result.size() > 1 && result.back() == '/') {
+        result.pop_back();
+    }
+    return result;
+}
+
 // Check if path is within or equal to base directory
 inline bool is_within_directory(const std::string& path, const std::string& base_dir) {
     // If directory filtering is disabled, allow all paths
@@ -0,0 +1,327 @@
+#ifndef PRELOAD_BACKEND_HPP
+#define PRELOAD_BACKEND_HPP
+
+#include <atomic>
+#include <string>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <cstdint>
+#include <elf.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+
+namespace preload_backend {
+
+// Environment variable naming the shared-memory ring a tracee's preload
+// library writes to
+constexpr const char* ring_env = "FILETRACE_PRELOAD_RING";
+constexpr const char* library_name = "libfiletrace_preload.so";
+
+constexpr uint32_t ring_magic = 0x46545052;  // "FTPR"
+constexpr size_t path_size = PATH_MAX;
+
+// One open reported by the preload library. Records are fixed-size so
+// that producers in any process can claim a slot with a single atomic.
+struct EventRecord {
+    int32_t pid;     // Thread group id
+    int32_t tid;
+    int32_t result;  // Descriptor, or -errno of a failed open
+    char comm[16];
+    char path[path_size];  // Absolute, empty if it could not be resolved
+};
+
+// A slot's sequence, plus its index, tells its state: it equals the
+// position a producer may claim the slot for, or that position + 1 once
+// the record is committed. Keeping it relative to the index makes a
+// zero-filled ring a valid empty one.
+struct Slot {
+    std::atomic<uint64_t> sequence;
+    EventRecord record;
+};
+
+// Shared between filetrace and every preloaded tracee, followed by the
+// slots. Positions only grow; a slot is position & (capacity - 1).
+struct RingHeader {
+    uint32_t magic;
+    uint32_t capacity;
+    pid_t consumer_pid;
+    alignas(64) std::atomic<uint64_t> head;  // Next position producers claim
+    alignas(64) std::atomic<uint64_t> tail;  // Next position the consumer reads
+    std::atomic<uint64_t> dropped;           // Records lost to a full ring
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring positions must be lock-free across processes");
+
+inline size_t ring_bytes(uint32_t capacity) {
+    return sizeof(RingHeader) + static_cast<size_t>(capacity) * sizeof(Slot);
+}
+
+inline Slot* slots_of(RingHeader* ring) {
+    return reinterpret_cast<Slot*>(ring + 1);
+}
+
+// Producer side: map the ring named in the environment, nullptr if absent
+inline RingHeader* map_ring(const char* name) {
+    if (name == nullptr) {
+        return nullptr;
+    }
+    int fd = shm_open(name, O_RDWR | O_CLOEXEC, 0);
+    if (fd == -1) {
+        return nullptr;
+    }
+    struct stat st;
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(RingHeader)) {
+        mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+    auto* ring = static_cast<RingHeader*>(mapping);
+    if (ring->magic != ring_magic || ring_bytes(ring->capacity) > static_cast<size_t>(st.st_size)) {
+        munmap(mapping, static_cast<size_t>(st.st_size));
+        return nullptr;
+    }
+    return ring;
+}
+
+// Producer side: claim the next slot. A full ring is waited on briefly,
+// since the consumer polls; after that, or once filetrace has gone, the
+// record is dropped and nullptr returned.
+inline EventRecord* reserve(RingHeader* ring, uint64_t& position) {
+    Slot* slots = slots_of(ring);
+    const uint64_t mask = ring->capacity - 1;
+    int waits = 0;
+    position = ring->head.load(std::memory_order_relaxed);
+    while (true) {
+        Slot& slot = slots[position & mask];
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire) + (position & mask);
+        auto diff = static_cast<int64_t>(sequence - position);
+        if (diff == 0) {
+            if (ring->head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                return &slot.record;
+            }
+        } else if (diff < 0) {
+            if (++waits > 1000 || (waits % 100 == 0 && kill(ring->consumer_pid, 0) == -1 && errno == ESRCH)) {
+                ring->dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            sched_yield();
+            position = ring->head.load(std::memory_order_relaxed);
+        } else {
+            position = ring->head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// Producer side: publish the record reserve returned for position
+inline void commit(RingHeader* ring, uint64_t position) {
+    uint64_t index = position & (ring->capacity - 1);
+    slots_of(ring)[index].sequence.store(position + 1 - index, std::memory_order_release);
+}
+
+// Consumer side, owned by filetrace: creates the ring in POSIX shared
+// memory and unlinks it again on destruction
+class EventRing {
+public:
+    EventRing() = default;
+
+    ~EventRing() {
+        if (ring != nullptr) {
+            munmap(ring, ring_bytes(ring->capacity));
+        }
+        if (!shm_name.empty()) {
+            shm_unlink(shm_name.c_str());
+        }
+    }
+
+    EventRing(const EventRing&) = delete;
+    EventRing& operator=(const EventRing&) = delete;
+
+    // Create the ring with capacity rounded up to a power of two. Slots
+    // start out zero-filled and only take memory once written to.
+    bool init(uint32_t capacity = 8192) {
+        uint32_t rounded = 1;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        shm_name = "/filetrace-" + std::to_string(getpid());
+        int fd = shm_open(shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (fd == -1) {
+            last_error = "shm_open " + shm_name + ": " + strerror(errno);
+            shm_name.clear();
+            return false;
+        }
+        size_t bytes = ring_bytes(rounded);
+        void* mapping = MAP_FAILED;
+        if (ftruncate(fd, static_cast<off_t>(bytes)) == 0) {
+            mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            last_error = std::string("Mapping the event ring: ") + strerror(errno);
+            return false;
+        }
+
+        ring = static_cast<RingHeader*>(mapping);
+        ring->capacity = rounded;
+        ring->consumer_pid = getpid();
+        // Producers check the magic last
+        __atomic_store_n(&ring->magic, ring_magic, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // Value of ring_env for tracees
+    const std::string& name() const {
+        return shm_name;
+    }
+
+    // Pass every committed record to handler(const EventRecord&) in order.
+    // Stops at the first slot still being written, unless final is set:
+    // once every producer has exited, such a slot belongs to a process
+    // that died mid-record and is skipped.
+    template<typename Handler>
+    size_t drain(Handler handler, bool final = false) {
+        Slot* slots = slots_of(ring);
+        const uint64_t mask = ring->capacity - 1;
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        size_t drained = 0;
+        while (tail < head) {
+            uint64_t index = tail & mask;
+            Slot& slot = slots[index];
+            if (slot.sequence.load(std::memory_order_acquire) + index == tail + 1) {
+                handler(slot.record);
+                drained++;
+            } else if (!final) {
+                break;
+            }
+            slot.sequence.store(tail + ring->capacity - index, std::memory_order_release);
+            tail++;
+            ring->tail.store(tail, std::memory_order_relaxed);
+        }
+        consumed += drained;
+        return drained;
+    }
+
+    // Records drained so far
+    uint64_t total() const {
+        return consumed;
+    }
+
+    // Records producers gave up on
+    uint64_t dropped() const {
+        return ring->dropped.load(std::memory_order_relaxed);
+    }
+
+    const std::string& get_last_error() const {
+        return last_error;
+    }
+
+private:
+    RingHeader* ring = nullptr;
+    std::string shm_name;
+    uint64_t consumed = 0;
+    std::string last_error;
+};
+
+// The preload library next to the running executable or in ../lib, as
+// laid out by the build; empty if neither exists
+inline std::string locate_library() {
+    char exe[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (len <= 0) {
+        return "";
+    }
+    std::string dir(exe, static_cast<size_t>(len));
+    dir.erase(dir.find_last_of('/'));
+    for (const std::string& candidate : {dir + "/" + library_name, dir + "/../lib/" + library_name}) {
+        char resolved[PATH_MAX];
+        if (realpath(candidate.c_str(), resolved) != nullptr) {
+            return resolved;
+        }
+    }
+    return "";
+}
+
+// LD_PRELOAD value with library in front of any libraries already listed
+inline std::string preload_list(const std::string& library, const char* existing) {
+    if (existing == nullptr || *existing == '\0') {
+        return library;
+    }
+    return library + ":" + existing;
+}
+
+// ELF class and machine of an executable, 0 if unreadable
+inline uint32_t elf_kind(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    Elf64_Ehdr header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.e_ident, ELFMAG, SELFMAG) != 0) {
+        return 0;
+    }
+    return (static_cast<uint32_t>(header.e_ident[EI_CLASS]) << 16) | header.e_machine;
+}
+
+// Whether the dynamic loader has put the preload library into the image
+// pid is running: the image must be dynamically linked, built for our ELF
+// class and machine, not in secure-execution mode (setuid, setgid or file
+// capabilities), and still have the library and ring in its environment.
+// Anything else is traced through ptrace instead.
+inline bool preload_applies(pid_t pid, const std::string& library, const std::string& ring_name) {
+    std::string proc = "/proc/" + std::to_string(pid);
+    static const uint32_t own_kind = elf_kind("/proc/self/exe");
+    if (own_kind == 0 || elf_kind(proc + "/exe") != own_kind) {
+        return false;
+    }
+
+    // AT_BASE is the interpreter's load address, 0 for static executables
+    std::ifstream auxv_file(proc + "/auxv", std::ios::binary);
+    Elf64_auxv_t entry;
+    bool interpreted = false;
+    while (auxv_file.read(reinterpret_cast<char*>(&entry), sizeof(entry)) && entry.a_type != AT_NULL) {
+        if (entry.a_type == AT_SECURE && entry.a_un.a_val != 0) {
+            return false;
+        }
+        if (entry.a_type == AT_BASE) {
+            interpreted = entry.a_un.a_val != 0;
+        }
+    }
+    if (!interpreted) {
+        return false;
+    }
+
+    std::ifstream environ_file(proc + "/environ", std::ios::binary);
+    std::string environ_data((std::istreambuf_iterator<char>(environ_file)), std::istreambuf_iterator<char>());
+    std::string ring_entry = std::string(ring_env) + "=" + ring_name;
+    bool has_library = false;
+    bool has_ring = false;
+    size_t start = 0;
+    while (start < environ_data.size()) {
+        size_t end = environ_data.find('\0', start);
+        if (end == std::string::npos) {
+            end = environ_data.size();
+        }
+        std::string variable = environ_data.substr(start, end - start);
+        if (variable.compare(0, 11, "LD_PRELOAD=") == 0) {
+            has_library = variable.find(library, 11) != std::string::npos;
+        } else if (variable == ring_entry) {
+            has_ring = true;
+        }
+        start = end + 1;
+    }
+    return has_library && has_ring;
+}
+
+} // namespace preload_backend
+
+#endif // PRELOAD_BACKEND_HPP
@@ -0,0 +1,339 @@
+// Preload library for --backend=preload. Loaded into dynamically linked
+// tracees through LD_PRELOAD, it interposes the libc open entry points and
+// writes one record per open into the shared-memory ring filetrace drains,
+// so an open costs no ptrace stop. execve and posix_spawn keep the library
+// and the ring in the environment of the programs they start. Only calls
+// made through the dynamic symbol table are seen; libc's internal opens
+// and raw syscalls are not.
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/prctl.h>
+#include <unistd.h>
+
+#include "preload_backend.hpp"
+
+namespace {
+
+preload_backend::RingHeader* ring = nullptr;
+
+// Environment entries handed on to exec'd programs
+char library_path[PATH_MAX];
+char ring_entry[128];
+
+// Identity of the calling thread, looked up on its first open. The child
+// of a fork starts over, as its pid and tid differ.
+struct ThreadIdentity {
+    pid_t pid;
+    pid_t tid;
+    char comm[16];
+};
+__attribute__((tls_model("initial-exec"))) thread_local ThreadIdentity identity;
+
+void forget_identity() {
+    identity.tid = 0;
+}
+
+// Next definition of an interposed function, resolved on first use
+template<typename Function>
+Function next(Function& cache, const char* name) {
+    if (cache == nullptr) {
+        cache = reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+    }
+    return cache;
+}
+
+using open_function = int (*)(const char*, int, ...);
+using openat_function = int (*)(int, const char*, int, ...);
+using open_2_function = int (*)(const char*, int);
+using openat_2_function = int (*)(int, const char*, int);
+using creat_function = int (*)(const char*, mode_t);
+using fopen_function = FILE* (*)(const char*, const char*);
+using execve_function = int (*)(const char*, char* const[], char* const[]);
+using spawn_function = int (*)(pid_t*, const char*, const posix_spawn_file_actions_t*,
+                               const posix_spawnattr_t*, char* const[], char* const[]);
+
+open_function real_open;
+open_function real_open64;
+openat_function real_openat;
+openat_function real_openat64;
+open_2_function real_open_2;
+open_2_function real_open64_2;
+openat_2_function real_openat_2;
+openat_2_function real_openat64_2;
+creat_function real_creat;
+creat_function real_creat64;
+fopen_function real_fopen;
+fopen_function real_fopen64;
+execve_function real_execve;
+spawn_function real_posix_spawn;
+spawn_function real_posix_spawnp;
+
+bool needs_mode(int flags) {
+    return (flags & O_CREAT) || (flags & O_TMPFILE) == O_TMPFILE;
+}
+
+// Write the absolute form of path, relative to dirfd, into out
+bool absolute_path(int dirfd, const char* path, char* out, size_t size) {
+    size_t len = 0;
+    if (path[0] != '/') {
+        if (dirfd == AT_FDCWD) {
+            if (getcwd(out, size) == nullptr) {
+                return false;
+            }
+            len = strlen(out);
+        } else {
+            char link[32];
+            snprintf(link, sizeof(link), "/proc/self/fd/%d", dirfd);
+            ssize_t link_len = readlink(link, out, size - 1);
+            if (link_len <= 0 || out[0] != '/') {
+                return false;
+            }
+            len = static_cast<size_t>(link_len);
+        }
+        if (out[len - 1] != '/') {
+            out[len++] = '/';
+        }
+    }
+    size_t path_len = strlen(path);
+    if (len + path_len >= size) {
+        return false;
+    }
+    memcpy(out + len, path, path_len + 1);
+    return true;
+}
+
+// Record an open that returned result, -1 with errno set on failure.
+// errno is left as the open set it.
+void record_open(int dirfd, const char* path, int result) {
+    if (ring == nullptr || path == nullptr) {
+        return;
+    }
+    int saved_errno = errno;
+    if (identity.tid == 0) {
+        identity.pid = getpid();
+        identity.tid = gettid();
+        prctl(PR_GET_NAME, identity.comm, 0, 0, 0);
+    }
+
+    uint64_t position;
+    preload_backend::EventRecord* event = preload_backend::reserve(ring, position);
+    if (event != nullptr) {
+        event->pid = identity.pid;
+        event->tid = identity.tid;
+        event->result = result >= 0 ? result : -saved_errno;
+        memcpy(event->comm, identity.comm, sizeof(event->comm));
+        if (!absolute_path(dirfd, path, event->path, sizeof(event->path))) {
+            event->path[0] = '\0';
+        }
+        preload_backend::commit(ring, position);
+    }
+    errno = saved_errno;
+}
+
+// Copy of envp with the library in LD_PRELOAD and the ring variable set,
+// so that programs started with an environment of their own are traced
+// too. nullptr if envp already carries both. One allocation holds the
+// array and a rewritten LD_PRELOAD entry.
+char** restore_environment(char* const envp[]) {
+    size_t count = 0;
+    const char* preload = nullptr;
+    bool has_ring = false;
+    for (; envp != nullptr && envp[count] != nullptr; count++) {
+        if (strncmp(envp[count], "LD_PRELOAD=", 11) == 0) {
+            preload = envp[count] + 11;
+        } else if (strcmp(envp[count], ring_entry) == 0) {
+            has_ring = true;
+        }
+    }
+    bool has_library = preload != nullptr && strstr(preload, library_path) != nullptr;
+    if (has_library && has_ring) {
+        return nullptr;
+    }
+
+    size_t array_size = (count + 3) * sizeof(char*);
+    size_t entry_size = 11 + strlen(library_path) + (preload != nullptr ? 1 + strlen(preload) : 0) + 1;
+    auto** result = static_cast<char**>(malloc(array_size + entry_size));
+    if (result == nullptr) {
+        return nullptr;
+    }
+    char* preload_entry = reinterpret_cast<char*>(result) + array_size;
+    if (has_library) {
+        snprintf(preload_entry, entry_size, "LD_PRELOAD=%s", preload);
+    } else if (preload != nullptr && *preload != '\0') {
+        snprintf(preload_entry, entry_size, "LD_PRELOAD=%s:%s", library_path, preload);
+    } else {
+        snprintf(preload_entry, entry_size, "LD_PRELOAD=%s", library_path);
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (strncmp(envp[i], "LD_PRELOAD=", 11) != 0 &&
+            strncmp(envp[i], ring_entry, strchr(ring_entry, '=') - ring_entry + 1) != 0) {
+            result[n++] = envp[i];
+        }
+    }
+    result[n++] = preload_entry;
+    result[n++] = ring_entry;
+    result[n] = nullptr;
+    return result;
+}
+
+void free_environment(char** environment) {
+    int saved_errno = errno;
+    free(environment);
+    errno = saved_errno;
+}
+
+__attribute__((constructor)) void init_preload() {
+    const char* name = getenv(preload_backend::ring_env);
+    Dl_info info;
+    if (name == nullptr || strlen(name) + strlen(preload_backend::ring_env) + 2 > sizeof(ring_entry) ||
+        dladdr(reinterpret_cast<void*>(&init_preload), &info) == 0 || info.dli_fname == nullptr ||
+        strlen(info.dli_fname) >= sizeof(library_path)) {
+        return;
+    }
+    strcpy(library_path, info.dli_fname);
+    snprintf(ring_entry, sizeof(ring_entry), "%s=%s", preload_backend::ring_env, name);
+    pthread_atfork(nullptr, nullptr, forget_identity);
+    ring = preload_backend::map_ring(name);
+}
+
+} // namespace
+
+extern "C" {
+
+int open(const char* path, int flags, ...) {
+    mode_t mode = 0;
+    if (needs_mode(flags)) {
+        va_list args;
+        va_start(args, flags);
+        mode = static_cast<mode_t>(va_arg(args, int));
+        va_end(args);
+    }
+    int fd = next(real_open, "open")(path, flags, mode);
+    record_open(AT_FDCWD, path, fd);
+    return fd;
+}
+
+int open64(const char* path, int flags, ...) {
+    mode_t mode = 0;
+    if (needs_mode(flags)) {
+        va_list args;
+        va_start(args, flags);
+        mode = static_cast<mode_t>(va_arg(args, int));
+        va_end(args);
+    }
+    int fd = next(real_open64, "open64")(path, flags, mode);
+    record_open(AT_FDCWD, path, fd);
+    return fd;
+}
+
+int openat(int dirfd, const char* path, int flags, ...) {
+    mode_t mode = 0;
+    if (needs_mode(flags)) {
+        va_list args;
+        va_start(args, flags);
+        mode = static_cast<mode_t>(va_arg(args, int));
+        va_end(args);
+    }
+    int fd = next(real_openat, "openat")(dirfd, path, flags, mode);
+    record_open(dirfd, path, fd);
+    return fd;
+}
+
+int openat64(int dirfd, const char* path, int flags, ...) {
+    mode_t mode = 0;
+    if (needs_mode(flags)) {
+        va_list args;
+        va_start(args, flags);
+        mode = static_cast<mode_t>(va_arg(args, int));
+        va_end(args);
+    }
+    int fd = next(real_openat64, "openat64")(dirfd, path, flags, mode);
+    record_open(dirfd, path, fd);
+    return fd;
+}
+
+// Entry points of programs built with _FORTIFY_SOURCE
+int __open_2(const char* path, int flags) {
+    int fd = next(real_open_2, "__open_2")(path, flags);
+    record_open(AT_FDCWD, path, fd);
+    return fd;
+}
+
+int __open64_2(const char* path, int flags) {
+    int fd = next(real_open64_2, "__open64_2")(path, flags);
+    record_open(AT_FDCWD, path, fd);
+    return fd;
+}
+
+int __openat_2(int dirfd, const char* path, int flags) {
+    int fd = next(real_openat_2, "__openat_2")(dirfd, path, flags);
+    record_open(dirfd, path, fd);
+    return fd;
+}
+
+int __openat64_2(int dirfd, const char* path, int flags) {
+    int fd = next(real_openat64_2, "__openat64_2")(dirfd, path, flags);
+    record_open(dirfd, path, fd);
+    return fd;
+}
+
+int creat(const char* path, mode_t mode) {
+    int fd = next(real_creat, "creat")(path, mode);
+    record_open(AT_FDCWD, path, fd);
+    return fd;
+}
+
+int creat64(const char* path, mode_t mode) {
+    int fd = next(real_creat64, "creat64")(path, mode);
+    record_open(AT_FDCWD, path, fd);
+    return fd;
+}
+
+FILE* fopen(const char* path, const char* mode) {
+    FILE* file = next(real_fopen, "fopen")(path, mode);
+    record_open(AT_FDCWD, path, file != nullptr ? fileno(file) : -1);
+    return file;
+}
+
+FILE* fopen64(const char* path, const char* mode) {
+    FILE* file = next(real_fopen64, "fopen64")(path, mode);
+    record_open(AT_FDCWD, path, file != nullptr ? fileno(file) : -1);
+    return file;
+}
+
+int execve(const char* path, char* const argv[], char* const envp[]) noexcept {
+    char** environment = ring != nullptr ? restore_environment(envp) : nullptr;
+    int result = next(real_execve, "execve")(path, argv, environment != nullptr ? environment : envp);
+    free_environment(environment);
+    return result;
+}
+
+int posix_spawn(pid_t* pid, const char* path, const posix_spawn_file_actions_t* file_actions,
+                const posix_spawnattr_t* attr, char* const argv[], char* const envp[]) {
+    char** environment = ring != nullptr ? restore_environment(envp) : nullptr;
+    int result = next(real_posix_spawn, "posix_spawn")(pid, path, file_actions, attr, argv,
+                                                       environment != nullptr ? environment : envp);
+    free_environment(environment);
+    return result;
+}
+
+int posix_spawnp(pid_t* pid, const char* file, const posix_spawn_file_actions_t* file_actions,
+                 const posix_spawnattr_t* attr, char* const argv[], char* const envp[]) {
+    char** environment = ring != nullptr ? restore_environment(envp) : nullptr;
+    int result = next(real_posix_spawnp, "posix_spawnp")(pid, file, file_actions, attr, argv,
+                                                         environment != nullptr ? environment : envp);
+    free_environment(environment);
+    return result;
+}
+
+} // extern "C"
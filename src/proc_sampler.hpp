@@ -0,0 +1,173 @@
+#ifndef PROC_SAMPLER_HPP
+#define PROC_SAMPLER_HPP
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <unordered_map>
+#include <unordered_set>
+#include <fstream>
+#include <sstream>
+#include <dirent.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <limits.h>
+#include "process_attach.hpp"
+
+namespace proc_sampler {
+
+// What the sampler knows about one path. Times are milliseconds since the
+// sampler was created.
+struct Observation {
+    pid_t pid;                  // Process that held the file when first seen
+    std::string process_name;
+    double first_seen_ms;
+    double last_seen_ms;
+    unsigned long count;        // Samples the file was seen in
+};
+
+// Files a process holds open, from the links in /proc/<pid>/fd. Sockets,
+// pipes and anonymous inodes have no path and are left out.
+inline std::vector<std::string> list_open_files(pid_t pid) {
+    std::vector<std::string> files;
+    std::string fd_dir = "/proc/" + std::to_string(pid) + "/fd";
+    DIR* dir = opendir(fd_dir.c_str());
+    if (dir == nullptr) {
+        return files;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        char target[PATH_MAX];
+        ssize_t len = readlinkat(dirfd(dir), entry->d_name, target, sizeof(target) - 1);
+        if (len > 0 && target[0] == '/') {
+            files.emplace_back(target, static_cast<size_t>(len));
+        }
+    }
+    closedir(dir);
+    return files;
+}
+
+// Files mapped into a process, from /proc/<pid>/maps, each listed once
+inline std::vector<std::string> list_mapped_files(pid_t pid) {
+    std::vector<std::string> files;
+    std::ifstream maps("/proc/" + std::to_string(pid) + "/maps");
+    std::string line;
+    std::string previous;
+    while (std::getline(maps, line)) {
+        // address perms offset dev inode pathname; the path may hold spaces
+        std::istringstream fields(line);
+        std::string address, perms, offset, device;
+        unsigned long inode;
+        if (!(fields >> address >> perms >> offset >> device >> inode) || inode == 0) {
+            continue;
+        }
+        size_t path_start = line.find('/', static_cast<size_t>(fields.tellg()));
+        if (path_start == std::string::npos) {
+            continue;
+        }
+        std::string path = line.substr(path_start);
+        // Mappings of one file are adjacent
+        if (path != previous) {
+            files.push_back(path);
+            previous = path;
+        }
+    }
+    return files;
+}
+
+// Periodic observer of a process tree through /proc. Nothing is attached
+// to the processes: each sample only reads their task, fd and maps entries,
+// so the cost to the target is bounded by the sampling rate. Files opened
+// and closed between two samples are missed.
+class ProcSampler {
+public:
+    ProcSampler() : start(std::chrono::steady_clock::now()) {}
+
+    // Take one sample of the processes in roots and, if follow_children is
+    // set, of all their descendants. handler(path, const Observation&) is
+    // called for every path seen for the first time.
+    template<typename Handler>
+    void sample(const std::vector<pid_t>& roots, bool follow_children, Handler handler) {
+        auto sample_start = std::chrono::steady_clock::now();
+        double now_ms = std::chrono::duration<double, std::milli>(sample_start - start).count();
+        seen_this_sample.clear();
+
+        std::vector<pid_t> processes(roots);
+        for (size_t i = 0; i < processes.size(); i++) {
+            pid_t pid = processes[i];
+            std::string name;
+            auto observe = [&](const std::string& path) {
+                if (!seen_this_sample.insert(path).second) {
+                    return;
+                }
+                auto it = observations.find(path);
+                if (it != observations.end()) {
+                    it->second.last_seen_ms = now_ms;
+                    it->second.count++;
+                    return;
+                }
+                if (name.empty()) {
+                    name = process_name(pid);
+                }
+                it = observations.emplace(path, Observation{pid, name, now_ms, now_ms, 1}).first;
+                handler(it->first, it->second);
+            };
+            for (const auto& path : list_open_files(pid)) {
+                observe(path);
+            }
+            for (const auto& path : list_mapped_files(pid)) {
+                observe(path);
+            }
+            if (follow_children) {
+                for (pid_t child : process_attach::list_children(pid)) {
+                    processes.push_back(child);
+                }
+            }
+            processes_seen += 1;
+        }
+
+        samples++;
+        sample_time_ms += std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - sample_start).count();
+    }
+
+    // Every path seen so far
+    const std::unordered_map<std::string, Observation>& get_observations() const {
+        return observations;
+    }
+
+    unsigned long long sample_count() const {
+        return samples;
+    }
+
+    // Process visits summed over all samples
+    unsigned long long process_visits() const {
+        return processes_seen;
+    }
+
+    // Time spent inside sample(), summed
+    double total_sample_ms() const {
+        return sample_time_ms;
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+    std::unordered_map<std::string, Observation> observations;
+    std::unordered_set<std::string> seen_this_sample;
+    unsigned long long samples = 0;
+    unsigned long long processes_seen = 0;
+    double sample_time_ms = 0;
+
+    static std::string process_name(pid_t pid) {
+        std::ifstream comm("/proc/" + std::to_string(pid) + "/comm");
+        std::string name;
+        std::getline(comm, name);
+        return name;
+    }
+};
+
+} // namespace proc_sampler
+
+#endif // PROC_SAMPLER_HPP
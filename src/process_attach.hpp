@@ -0,0 +1,112 @@
+#ifndef PROCESS_ATTACH_HPP
+#define PROCESS_ATTACH_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/ptrace.h>
+#include <errno.h>
+#include <cstdlib>
+
+namespace process_attach {
+
+// Numeric entries of a /proc directory
+inline std::vector<pid_t> list_numeric_entries(const std::string& dir_path) {
+    std::vector<pid_t> ids;
+    DIR* dir = opendir(dir_path.c_str());
+    if (dir == nullptr) {
+        return ids;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        char* end;
+        long id = std::strtol(entry->d_name, &end, 10);
+        if (*end == '\0' && id > 0) {
+            ids.push_back(static_cast<pid_t>(id));
+        }
+    }
+    closedir(dir);
+    return ids;
+}
+
+// Threads of a process as listed in /proc/<pid>/task
+inline std::vector<pid_t> list_tasks(pid_t pid) {
+    return list_numeric_entries("/proc/" + std::to_string(pid) + "/task");
+}
+
+// Parent process of pid from /proc/<pid>/stat, 0 if unknown
+inline pid_t get_parent_pid(pid_t pid) {
+    std::ifstream stat_file("/proc/" + std::to_string(pid) + "/stat");
+    std::string stat;
+    if (!std::getline(stat_file, stat)) {
+        return 0;
+    }
+    // The command name may contain spaces; fields resume after its ')'
+    auto name_end = stat.rfind(')');
+    if (name_end == std::string::npos || name_end + 4 >= stat.size()) {
+        return 0;
+    }
+    return static_cast<pid_t>(std::strtol(stat.c_str() + name_end + 4, nullptr, 10));
+}
+
+// Process (thread group) a thread belongs to from /proc/<tid>/status,
+// 0 if unknown
+inline pid_t get_thread_group_id(pid_t tid) {
+    std::ifstream status_file("/proc/" + std::to_string(tid) + "/status");
+    std::string line;
+    while (std::getline(status_file, line)) {
+        if (line.compare(0, 5, "Tgid:") == 0) {
+            return static_cast<pid_t>(std::strtol(line.c_str() + 5, nullptr, 10));
+        }
+    }
+    return 0;
+}
+
+// Direct child processes of pid. Uses /proc/<pid>/task/<tid>/children where
+// the kernel provides it and scans every process's parent otherwise.
+inline std::vector<pid_t> list_children(pid_t pid) {
+    std::vector<pid_t> children;
+    bool children_file_found = false;
+    for (pid_t tid : list_tasks(pid)) {
+        std::ifstream children_file("/proc/" + std::to_string(pid) + "/task/" +
+                                    std::to_string(tid) + "/children");
+        if (!children_file.is_open()) {
+            continue;
+        }
+        children_file_found = true;
+        pid_t child;
+        while (children_file >> child) {
+            children.push_back(child);
+        }
+    }
+    if (children_file_found) {
+        return children;
+    }
+
+    for (pid_t candidate : list_numeric_entries("/proc")) {
+        if (get_parent_pid(candidate) == pid) {
+            children.push_back(candidate);
+        }
+    }
+    return children;
+}
+
+// Attach to a running thread without stopping it through a signal, then
+// interrupt it so it reports a PTRACE_EVENT_STOP to the tracer
+inline bool seize_task(pid_t tid, long options) {
+    if (ptrace(PTRACE_SEIZE, tid, nullptr, reinterpret_cast<void*>(options)) == -1) {
+        return false;
+    }
+    if (ptrace(PTRACE_INTERRUPT, tid, nullptr, nullptr) == -1) {
+        int saved_errno = errno;
+        ptrace(PTRACE_DETACH, tid, nullptr, nullptr);
+        errno = saved_errno;
+        return false;
+    }
+    return true;
+}
+
+} // namespace process_attach
+
+#endif // PROCESS_ATTACH_HPP
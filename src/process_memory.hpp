@@ -0,0 +1,104 @@
+#ifndef PROCESS_MEMORY_HPP
+#define PROCESS_MEMORY_HPP
+
+#include <string>
+#include <algorithm>
+#include <unordered_map>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+
+namespace process_memory {
+
+// Reads tracee memory in bulk. Uses process_vm_readv when the kernel allows
+// it and falls back to pread on a cached /proc/<pid>/mem descriptor.
+class ProcessMemoryReader {
+public:
+    explicit ProcessMemoryReader(bool use_vm_readv = true)
+        : vm_readv_available(use_vm_readv), page_size(sysconf(_SC_PAGESIZE)) {}
+
+    ~ProcessMemoryReader() {
+        for (const auto& entry : mem_fds) {
+            close(entry.second);
+        }
+    }
+
+    ProcessMemoryReader(const ProcessMemoryReader&) = delete;
+    ProcessMemoryReader& operator=(const ProcessMemoryReader&) = delete;
+
+    // Read up to len bytes at addr; returns bytes read or -1 on error
+    ssize_t read(pid_t pid, unsigned long addr, void* buf, size_t len) {
+        if (vm_readv_available) {
+            struct iovec local = {buf, len};
+            struct iovec remote = {reinterpret_cast<void*>(addr), len};
+            ssize_t n = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+            if (n != -1 || (errno != ENOSYS && errno != EPERM)) {
+                return n;
+            }
+            // Not permitted in this environment; stop trying
+            vm_readv_available = false;
+        }
+        return read_proc_mem(pid, addr, buf, len);
+    }
+
+    // Read a NUL-terminated string of at most PATH_MAX bytes (including the
+    // terminator). Reads one page-bounded chunk at a time so a string that
+    // ends just before an unmapped page is still read in full. Returns false
+    // if memory is unreadable or no terminator is found within PATH_MAX.
+    bool read_string(pid_t pid, unsigned long addr, std::string& out) {
+        char buffer[PATH_MAX];
+        size_t total = 0;
+        while (total < sizeof(buffer)) {
+            unsigned long chunk_addr = addr + total;
+            size_t to_page_end = page_size - (chunk_addr % page_size);
+            size_t chunk = std::min(to_page_end, sizeof(buffer) - total);
+
+            ssize_t n = read(pid, chunk_addr, buffer + total, chunk);
+            if (n <= 0) {
+                return false;
+            }
+            for (size_t i = total; i < total + static_cast<size_t>(n); i++) {
+                if (buffer[i] == '\0') {
+                    out.assign(buffer, i);
+                    return true;
+                }
+            }
+            total += n;
+        }
+        return false;
+    }
+
+    // Drop the cached /proc/<pid>/mem descriptor of an exited tracee
+    void forget(pid_t pid) {
+        auto it = mem_fds.find(pid);
+        if (it != mem_fds.end()) {
+            close(it->second);
+            mem_fds.erase(it);
+        }
+    }
+
+private:
+    bool vm_readv_available;
+    size_t page_size;
+    std::unordered_map<pid_t, int> mem_fds;
+
+    ssize_t read_proc_mem(pid_t pid, unsigned long addr, void* buf, size_t len) {
+        auto it = mem_fds.find(pid);
+        if (it == mem_fds.end()) {
+            std::string mem_path = "/proc/" + std::to_string(pid) + "/mem";
+            int fd = open(mem_path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd == -1) {
+                return -1;
+            }
+            it = mem_fds.emplace(pid, fd).first;
+        }
+        return pread(it->second, buf, len, static_cast<off_t>(addr));
+    }
+};
+
+} // namespace process_memory
+
+#endif // PROCESS_MEMORY_HPP
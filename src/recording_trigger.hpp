@@ -0,0 +1,76 @@
+#ifndef RECORDING_TRIGGER_HPP
+#define RECORDING_TRIGGER_HPP
+
+#include <string>
+#include <vector>
+#include <fnmatch.h>
+
+namespace recording_trigger {
+
+// Match a trigger glob against a path. A glob with a '/' is matched
+// against the whole path, with '*' also matching across '/'; one without
+// is matched against the last component only, so "config.h" and "*.h"
+// match in any directory.
+inline bool matches(const std::string& glob, const std::string& path) {
+    if (glob.find('/') != std::string::npos) {
+        return fnmatch(glob.c_str(), path.c_str(), 0) == 0;
+    }
+    size_t slash = path.rfind('/');
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    return fnmatch(glob.c_str(), name.c_str(), 0) == 0;
+}
+
+// Events that switch recording on and off: opens of paths matching a glob
+// and execs of binaries matching a name. Until a start trigger fires the
+// tracer only watches for it; a stop trigger pauses recording again until
+// the next start trigger.
+struct Triggers {
+    std::vector<std::string> start_open;
+    std::vector<std::string> start_exec;
+    std::vector<std::string> stop_open;
+    std::vector<std::string> stop_exec;
+
+    // Recording waits for a start trigger
+    bool armed() const {
+        return !start_open.empty() || !start_exec.empty();
+    }
+
+    // While paused, opens are decoded to look for a start trigger
+    bool watches_opens() const {
+        return !start_open.empty();
+    }
+
+    bool uses_opens() const {
+        return !start_open.empty() || !stop_open.empty();
+    }
+
+    bool starts_on_open(const std::string& path) const {
+        return any_matches(start_open, path);
+    }
+
+    bool starts_on_exec(const std::string& binary) const {
+        return any_matches(start_exec, binary);
+    }
+
+    bool stops_on_open(const std::string& path) const {
+        return any_matches(stop_open, path);
+    }
+
+    bool stops_on_exec(const std::string& binary) const {
+        return any_matches(stop_exec, binary);
+    }
+
+private:
+    static bool any_matches(const std::vector<std::string>& globs, const std::string& path) {
+        for (const auto& glob : globs) {
+            if (matches(glob, path)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+} // namespace recording_trigger
+
+#endif // RECORDING_TRIGGER_HPP
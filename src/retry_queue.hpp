@@ -0,0 +1,93 @@
+#ifndef RETRY_QUEUE_HPP
+#define RETRY_QUEUE_HPP
+
+#include <chrono>
+#include <vector>
+#include <unordered_map>
+#include <sys/types.h>
+
+namespace retry_queue {
+
+// Tracees whose stop could not be serviced yet, each retried once its
+// backoff expires. A tracee waits here in its ptrace stop while the tracer
+// goes on servicing the others, instead of the tracer sleeping for it.
+template<typename Task>
+class RetryQueue {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Retry task for tid after the backoff of its attempt-th retry: 1 ms,
+    // then doubling. A tid has at most one retry queued.
+    void schedule(pid_t tid, const Task& task, int attempt, Clock::time_point now = Clock::now()) {
+        entries[tid] = Entry{now + std::chrono::milliseconds(1 << attempt), task, attempt};
+        scheduled_total++;
+    }
+
+    // Drop the retry of a tracee that died or was detached
+    void cancel(pid_t tid) {
+        entries.erase(tid);
+    }
+
+    void clear() {
+        entries.clear();
+    }
+
+    bool empty() const {
+        return entries.empty();
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+    bool contains(pid_t tid) const {
+        return entries.count(tid) != 0;
+    }
+
+    // Time until the earliest retry is due, zero if one already is
+    Clock::duration time_to_next(Clock::time_point now = Clock::now()) const {
+        Clock::duration wait = Clock::duration::max();
+        for (const auto& entry : entries) {
+            wait = std::min(wait, entry.second.due - now);
+        }
+        return std::max(wait, Clock::duration::zero());
+    }
+
+    // Take the retries that are due off the queue and call
+    // run(tid, task, attempt) for each; run may schedule again
+    template<typename Run>
+    size_t run_due(Run run, Clock::time_point now = Clock::now()) {
+        std::vector<std::pair<pid_t, Entry>> due;
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (it->second.due <= now) {
+                due.emplace_back(it->first, it->second);
+                it = entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (auto& entry : due) {
+            run(entry.first, entry.second.task, entry.second.attempt);
+        }
+        return due.size();
+    }
+
+    // Retries scheduled since the queue was created
+    unsigned long long total_scheduled() const {
+        return scheduled_total;
+    }
+
+private:
+    struct Entry {
+        Clock::time_point due;
+        Task task;
+        int attempt;
+    };
+
+    std::unordered_map<pid_t, Entry> entries;
+    unsigned long long scheduled_total = 0;
+};
+
+} // namespace retry_queue
+
+#endif // RETRY_QUEUE_HPP
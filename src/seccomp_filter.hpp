@@ -0,0 +1,133 @@
+#ifndef SECCOMP_FILTER_HPP
+#define SECCOMP_FILTER_HPP
+
+#include <vector>
+#include <cstddef>
+#include <errno.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#include <linux/audit.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+
+namespace seccomp_filter {
+
+// A syscall that only takes the filter's action when one of bits is set in
+// the low 32 bits of argument arg; otherwise it is allowed
+struct ArgumentTest {
+    long nr;
+    unsigned int arg;
+    unsigned int bits;
+};
+
+// Instructions that load the syscall number and return action for the
+// listed syscalls, SECCOMP_RET_ALLOW for the rest. Syscalls with an
+// argument test load their argument and test it before returning.
+inline std::vector<sock_filter> syscall_block(const std::vector<long>& syscalls, unsigned int action,
+                                              const std::vector<ArgumentTest>& tests = {}) {
+    std::vector<sock_filter> block;
+    block.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr)));
+    for (long nr : syscalls) {
+        const ArgumentTest* test = nullptr;
+        for (const ArgumentTest& candidate : tests) {
+            if (candidate.nr == nr) {
+                test = &candidate;
+            }
+        }
+        if (test == nullptr) {
+            block.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, static_cast<unsigned int>(nr), 0, 1));
+            block.push_back(BPF_STMT(BPF_RET | BPF_K, action));
+            continue;
+        }
+        // Both outcomes return, so the clobbered accumulator is never
+        // compared against the syscalls after this one
+        block.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, static_cast<unsigned int>(nr), 0, 4));
+        unsigned int arg_offset = static_cast<unsigned int>(offsetof(struct seccomp_data, args) +
+                                                            test->arg * sizeof(__u64));
+        block.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, arg_offset));
+        block.push_back(BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, test->bits, 0, 1));
+        block.push_back(BPF_STMT(BPF_RET | BPF_K, action));
+        block.push_back(BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW));
+    }
+    block.push_back(BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW));
+    return block;
+}
+
+// Build a BPF program returning action (SECCOMP_RET_TRACE by default) for
+// the given syscalls and SECCOMP_RET_ALLOW for everything else
+inline std::vector<sock_filter> build_filter(const std::vector<long>& syscalls,
+                                             unsigned int action = SECCOMP_RET_TRACE,
+                                             const std::vector<ArgumentTest>& tests = {}) {
+    std::vector<sock_filter> filter;
+
+    // Only x86_64 syscall numbers are matched; other ABIs run unfiltered
+    filter.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch)));
+    filter.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, AUDIT_ARCH_X86_64, 1, 0));
+    filter.push_back(BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW));
+
+    std::vector<sock_filter> block = syscall_block(syscalls, action, tests);
+    filter.insert(filter.end(), block.begin(), block.end());
+    return filter;
+}
+
+// Same, also matching compat_syscalls made through the i386 ABI. The i386
+// check comes first and jumps over its block to the x86_64 program. tests
+// apply to the x86_64 syscalls.
+inline std::vector<sock_filter> build_compat_filter(const std::vector<long>& syscalls,
+                                                    const std::vector<long>& compat_syscalls,
+                                                    unsigned int action = SECCOMP_RET_TRACE,
+                                                    const std::vector<ArgumentTest>& tests = {}) {
+    std::vector<sock_filter> native = build_filter(syscalls, action, tests);
+    std::vector<sock_filter> compat = syscall_block(compat_syscalls, action);
+    std::vector<sock_filter> filter;
+    filter.push_back(native[0]);
+    if (compat.size() <= 0xff) {
+        filter.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, AUDIT_ARCH_I386, 0,
+                                  static_cast<unsigned char>(compat.size())));
+    } else {
+        // Conditional jump offsets are 8 bits; a longer block is jumped
+        // over with an unconditional jump, whose offset is 32 bits
+        filter.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, AUDIT_ARCH_I386, 1, 0));
+        filter.push_back(BPF_STMT(BPF_JMP | BPF_JA, static_cast<unsigned int>(compat.size())));
+    }
+    filter.insert(filter.end(), compat.begin(), compat.end());
+    // The accumulator still holds the arch
+    filter.insert(filter.end(), native.begin() + 1, native.end());
+    return filter;
+}
+
+// Install filter in the calling process. A filter longer than the kernel
+// accepts fails with EINVAL rather than having its length truncated.
+inline bool install_program(std::vector<sock_filter>& filter) {
+    if (filter.empty() || filter.size() > BPF_MAXINSNS) {
+        errno = EINVAL;
+        return false;
+    }
+    struct sock_fprog prog;
+    prog.len = static_cast<unsigned short>(filter.size());
+    prog.filter = filter.data();
+
+    if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) == -1) {
+        return false;
+    }
+    return prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog) == 0;
+}
+
+// Install the filter in the calling process. Must run in the child before
+// execve, after the tracer has set PTRACE_O_TRACESECCOMP; without a tracer
+// the filtered syscalls fail with ENOSYS.
+inline bool install_filter(const std::vector<long>& syscalls) {
+    std::vector<sock_filter> filter = build_filter(syscalls);
+    return install_program(filter);
+}
+
+// Same, also trapping compat_syscalls of 32-bit code
+inline bool install_filter(const std::vector<long>& syscalls, const std::vector<long>& compat_syscalls,
+                           const std::vector<ArgumentTest>& tests = {}) {
+    std::vector<sock_filter> filter = build_compat_filter(syscalls, compat_syscalls, SECCOMP_RET_TRACE, tests);
+    return install_program(filter);
+}
+
+} // namespace seccomp_filter
+
+#endif // SECCOMP_FILTER_HPP
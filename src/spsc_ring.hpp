@@ -0,0 +1,76 @@
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace spsc_ring {
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Slots are preallocated, so pushing moves into an existing object
+// instead of allocating. Capacity is rounded up to a power of two.
+template<typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity) : slots(round_up_pow2(capacity)), mask(slots.size() - 1) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer side; returns false without consuming item if the ring is full
+    bool try_push(T&& item) {
+        size_t tail = tail_index.load(std::memory_order_relaxed);
+        if (tail - cached_head == slots.size()) {
+            cached_head = head_index.load(std::memory_order_acquire);
+            if (tail - cached_head == slots.size()) {
+                return false;
+            }
+        }
+        slots[tail & mask] = std::move(item);
+        tail_index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side; returns false if the ring is empty
+    bool try_pop(T& item) {
+        size_t head = head_index.load(std::memory_order_relaxed);
+        if (head == cached_tail) {
+            cached_tail = tail_index.load(std::memory_order_acquire);
+            if (head == cached_tail) {
+                return false;
+            }
+        }
+        item = std::move(slots[head & mask]);
+        head_index.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const {
+        return slots.size();
+    }
+
+private:
+    static size_t round_up_pow2(size_t n) {
+        size_t size = 1;
+        while (size < n) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    std::vector<T> slots;
+    const size_t mask;
+
+    // Producer and consumer indices live on separate cache lines, each next
+    // to the side's cached copy of the other index
+    alignas(64) std::atomic<size_t> tail_index{0};
+    size_t cached_head = 0;
+    alignas(64) std::atomic<size_t> head_index{0};
+    size_t cached_tail = 0;
+};
+
+} // namespace spsc_ring
+
+#endif // SPSC_RING_HPP
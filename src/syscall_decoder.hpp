@@ -0,0 +1,108 @@
+#ifndef SYSCALL_DECODER_HPP
+#define SYSCALL_DECODER_HPP
+
+#include <sys/ptrace.h>
+#include <sys/user.h>
+#include <sys/types.h>
+#include <linux/audit.h>
+#include <errno.h>
+#include <atomic>
+#include <cstring>
+#include "syscall_table.hpp"
+
+namespace syscall_decoder {
+
+// Arguments and result of the syscall a tracee is stopped in
+struct SyscallStop {
+    bool is_entry = false;
+    syscall_table::Abi abi = syscall_table::X86_64;  // Entry stops only
+    long nr = -1;               // Entry stops only
+    unsigned long args[6] = {}; // Entry stops only
+    long ret = 0;               // Exit stops only
+    bool is_error = false;      // Exit stops only
+};
+
+// Code segment selector of 32-bit user code on x86_64
+constexpr unsigned long long compat_code_segment = 0x23;
+
+// ABI a stopped tracee is making syscalls with, from its registers
+inline syscall_table::Abi abi_of(const struct user_regs_struct& regs) {
+    return regs.cs == compat_code_segment ? syscall_table::I386 : syscall_table::X86_64;
+}
+
+// Cleared once the kernel rejects PTRACE_GET_SYSCALL_INFO (Linux < 5.3).
+// Shared by the tracer threads of --jobs; support is the same for all.
+inline std::atomic<bool> syscall_info_supported{true};
+
+// Decode a syscall stop with a single PTRACE_GET_SYSCALL_INFO request.
+// in_syscall is the tracer's per-tid entry/exit state; it is only consulted
+// on kernels without PTRACE_GET_SYSCALL_INFO, where PTRACE_GETREGS cannot
+// tell entry and exit apart.
+inline bool fetch(pid_t pid, bool in_syscall, SyscallStop& stop) {
+    if (syscall_info_supported.load(std::memory_order_relaxed)) {
+        struct __ptrace_syscall_info info;
+        if (ptrace(PTRACE_GET_SYSCALL_INFO, pid, sizeof(info), &info) > 0) {
+            switch (info.op) {
+                case PTRACE_SYSCALL_INFO_ENTRY:
+                    stop.is_entry = true;
+                    stop.abi = info.arch == AUDIT_ARCH_I386 ? syscall_table::I386 : syscall_table::X86_64;
+                    stop.nr = static_cast<long>(info.entry.nr);
+                    std::memcpy(stop.args, info.entry.args, sizeof(stop.args));
+                    return true;
+                case PTRACE_SYSCALL_INFO_SECCOMP:
+                    stop.is_entry = true;
+                    stop.abi = info.arch == AUDIT_ARCH_I386 ? syscall_table::I386 : syscall_table::X86_64;
+                    stop.nr = static_cast<long>(info.seccomp.nr);
+                    std::memcpy(stop.args, info.seccomp.args, sizeof(stop.args));
+                    return true;
+                case PTRACE_SYSCALL_INFO_EXIT:
+                    stop.is_entry = false;
+                    stop.ret = info.exit.rval;
+                    stop.is_error = info.exit.is_error != 0;
+                    return true;
+                default:
+                    // Not stopped in a syscall
+                    errno = EINVAL;
+                    return false;
+            }
+        }
+        if (errno != EIO) {
+            return false;
+        }
+        syscall_info_supported.store(false, std::memory_order_relaxed);
+    }
+
+    struct user_regs_struct regs;
+    if (ptrace(PTRACE_GETREGS, pid, nullptr, &regs) == -1) {
+        return false;
+    }
+    stop.is_entry = !in_syscall;
+    stop.abi = abi_of(regs);
+    if (stop.abi == syscall_table::I386) {
+        // 32-bit registers, zero-extended; the ABI passes arguments in
+        // ebx, ecx, edx, esi, edi and ebp
+        stop.nr = static_cast<int32_t>(regs.orig_rax);
+        stop.args[0] = static_cast<uint32_t>(regs.rbx);
+        stop.args[1] = static_cast<uint32_t>(regs.rcx);
+        stop.args[2] = static_cast<uint32_t>(regs.rdx);
+        stop.args[3] = static_cast<uint32_t>(regs.rsi);
+        stop.args[4] = static_cast<uint32_t>(regs.rdi);
+        stop.args[5] = static_cast<uint32_t>(regs.rbp);
+        stop.ret = static_cast<int32_t>(regs.rax);
+    } else {
+        stop.nr = static_cast<long>(regs.orig_rax);
+        stop.args[0] = regs.rdi;
+        stop.args[1] = regs.rsi;
+        stop.args[2] = regs.rdx;
+        stop.args[3] = regs.r10;
+        stop.args[4] = regs.r8;
+        stop.args[5] = regs.r9;
+        stop.ret = static_cast<long>(regs.rax);
+    }
+    stop.is_error = stop.ret < 0 && stop.ret > -4096;
+    return true;
+}
+
+} // namespace syscall_decoder
+
+#endif // SYSCALL_DECODER_HPP
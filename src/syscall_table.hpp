@@ -0,0 +1,314 @@
+#ifndef SYSCALL_TABLE_HPP
+#define SYSCALL_TABLE_HPP
+
+#include <array>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <cstdint>
+#include <cstddef>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+
+namespace syscall_table {
+
+// Event categories users choose from with --syscalls. Each is one bit of
+// a category mask.
+enum Category : uint32_t {
+    NONE = 0,
+    OPEN = 1u << 0,      // open, openat, openat2, creat
+    STAT = 1u << 1,      // stat, lstat, newfstatat, statx
+    ACCESS = 1u << 2,    // access, faccessat, faccessat2
+    READLINK = 1u << 3,  // readlink, readlinkat
+    RENAME = 1u << 4,    // rename, renameat, renameat2
+    UNLINK = 1u << 5,    // unlink, unlinkat, rmdir
+    MKDIR = 1u << 6,     // mkdir, mkdirat
+    LINK = 1u << 7,      // link, linkat, symlink, symlinkat
+    TRUNCATE = 1u << 8,  // truncate
+    CHDIR = 1u << 9,     // chdir
+    EXEC = 1u << 10,     // execve, execveat
+    HANDLE = 1u << 11,   // name_to_handle_at
+};
+
+constexpr uint32_t all_categories = (HANDLE << 1) - 1;
+
+// Recorded when --syscalls is not given
+constexpr uint32_t default_categories = OPEN | EXEC;
+
+// Categories io_uring can submit operations of; its rings are followed
+// when any of them is recorded
+constexpr uint32_t ring_categories = OPEN | STAT | RENAME | UNLINK | MKDIR | LINK;
+
+// --syscalls names, in bit order
+constexpr const char* category_names[] = {
+    "open", "stat", "access", "readlink", "rename", "unlink",
+    "mkdir", "link", "truncate", "chdir", "exec", "handle"
+};
+
+// What the tracer does at a syscall's entry stop
+enum class Handling : uint8_t {
+    IGNORE,       // Not traced
+    PATH,         // Records its path arguments, see SyscallDescriptor
+    CLOSE,        // Descriptor table maintenance
+    CLOSE_RANGE,
+    FCNTL,
+    DUP,
+    CHDIR,        // Working directory tracking; recorded under CHDIR too
+    FCHDIR,
+    URING_SETUP,  // io_uring ring tracking, see io_uring_tracker.hpp
+    URING_REGISTER,
+    URING_ENTER,
+    MMAP,         // Mapping of a ring into its creator
+};
+
+// One path argument: its position and the position of the directory
+// descriptor it is relative to, -1 for the working directory
+struct PathArg {
+    int8_t path = -1;
+    int8_t dirfd = -1;
+};
+
+struct SyscallDescriptor {
+    const char* name = nullptr;
+    Handling handling = Handling::IGNORE;
+    Category category = NONE;
+    PathArg paths[2] = {};     // Unused slots have path -1
+    int8_t flags_arg = -1;     // Open or dup3 flags, for O_CLOEXEC; -1 if none
+    int8_t how_arg = -1;       // struct open_how holding the open flags (openat2)
+    int8_t filter_arg = -1;    // If not -1, the seccomp pre-filter only stops when
+    uint32_t filter_bits = 0;  // args[filter_arg] has one of filter_bits set
+};
+
+// Syscall ABIs a tracee on x86_64 can use; each has its own table
+enum Abi : uint8_t {
+    X86_64 = 0,
+    I386 = 1,  // ia32 compat: 32-bit programs and int $0x80
+};
+
+constexpr size_t abi_count = 2;
+
+// i386 syscall numbers, from asm/unistd_32.h, which cannot be included
+// next to the x86_64 definitions
+namespace nr_i386 {
+constexpr long open = 5, close = 6, creat = 8, link = 9, unlink = 10, execve = 11, chdir = 12;
+constexpr long access = 33, rename = 38, mkdir = 39, rmdir = 40, dup = 41, fcntl = 55, dup2 = 63;
+constexpr long symlink = 83, readlink = 85, truncate = 92, stat = 106, lstat = 107, clone = 120;
+constexpr long fchdir = 133, truncate64 = 193, stat64 = 195, lstat64 = 196, fcntl64 = 221;
+constexpr long openat = 295, mkdirat = 296, fstatat64 = 300, unlinkat = 301, renameat = 302;
+constexpr long linkat = 303, symlinkat = 304, readlinkat = 305, faccessat = 307, dup3 = 330;
+constexpr long name_to_handle_at = 341, renameat2 = 353, execveat = 358, statx = 383, clone3 = 435;
+constexpr long close_range = 436, openat2 = 437, faccessat2 = 439;
+} // namespace nr_i386
+
+// Syscall numbers the tables cover; every number in use on either ABI is below
+constexpr size_t table_size = 512;
+
+namespace detail {
+
+constexpr SyscallDescriptor path_syscall(const char* name, Category category, PathArg first,
+                                         PathArg second = {}, int8_t flags_arg = -1) {
+    SyscallDescriptor descriptor;
+    descriptor.name = name;
+    descriptor.handling = Handling::PATH;
+    descriptor.category = category;
+    descriptor.paths[0] = first;
+    descriptor.paths[1] = second;
+    descriptor.flags_arg = flags_arg;
+    return descriptor;
+}
+
+constexpr SyscallDescriptor state_syscall(const char* name, Handling handling, Category category = NONE,
+                                          PathArg path = {}, int8_t flags_arg = -1) {
+    SyscallDescriptor descriptor;
+    descriptor.name = name;
+    descriptor.handling = handling;
+    descriptor.category = category;
+    descriptor.paths[0] = path;
+    descriptor.flags_arg = flags_arg;
+    return descriptor;
+}
+
+constexpr SyscallDescriptor with_how(SyscallDescriptor descriptor, int8_t how_arg) {
+    descriptor.how_arg = how_arg;
+    return descriptor;
+}
+
+constexpr SyscallDescriptor with_filter(SyscallDescriptor descriptor, int8_t arg, uint32_t bits) {
+    descriptor.filter_arg = arg;
+    descriptor.filter_bits = bits;
+    return descriptor;
+}
+
+// A syscall's number on each ABI, -1 where the ABI lacks it. Arguments are
+// in the same positions on both.
+struct Entry {
+    long numbers[abi_count];
+    SyscallDescriptor descriptor;
+};
+
+constexpr Entry entries[] = {
+    {{SYS_open, nr_i386::open}, path_syscall("open", OPEN, {0, -1}, {}, 1)},
+    {{SYS_openat, nr_i386::openat}, path_syscall("openat", OPEN, {1, 0}, {}, 2)},
+    {{SYS_openat2, nr_i386::openat2}, with_how(path_syscall("openat2", OPEN, {1, 0}), 2)},
+    {{SYS_creat, nr_i386::creat}, path_syscall("creat", OPEN, {0, -1})},
+
+    {{SYS_stat, nr_i386::stat}, path_syscall("stat", STAT, {0, -1})},
+    {{SYS_lstat, nr_i386::lstat}, path_syscall("lstat", STAT, {0, -1})},
+    {{-1, nr_i386::stat64}, path_syscall("stat64", STAT, {0, -1})},
+    {{-1, nr_i386::lstat64}, path_syscall("lstat64", STAT, {0, -1})},
+    {{SYS_newfstatat, nr_i386::fstatat64}, path_syscall("newfstatat", STAT, {1, 0})},
+    {{SYS_statx, nr_i386::statx}, path_syscall("statx", STAT, {1, 0})},
+
+    {{SYS_access, nr_i386::access}, path_syscall("access", ACCESS, {0, -1})},
+    {{SYS_faccessat, nr_i386::faccessat}, path_syscall("faccessat", ACCESS, {1, 0})},
+    {{SYS_faccessat2, nr_i386::faccessat2}, path_syscall("faccessat2", ACCESS, {1, 0})},
+
+    {{SYS_readlink, nr_i386::readlink}, path_syscall("readlink", READLINK, {0, -1})},
+    {{SYS_readlinkat, nr_i386::readlinkat}, path_syscall("readlinkat", READLINK, {1, 0})},
+
+    {{SYS_rename, nr_i386::rename}, path_syscall("rename", RENAME, {0, -1}, {1, -1})},
+    {{SYS_renameat, nr_i386::renameat}, path_syscall("renameat", RENAME, {1, 0}, {3, 2})},
+    {{SYS_renameat2, nr_i386::renameat2}, path_syscall("renameat2", RENAME, {1, 0}, {3, 2})},
+
+    {{SYS_unlink, nr_i386::unlink}, path_syscall("unlink", UNLINK, {0, -1})},
+    {{SYS_unlinkat, nr_i386::unlinkat}, path_syscall("unlinkat", UNLINK, {1, 0})},
+    {{SYS_rmdir, nr_i386::rmdir}, path_syscall("rmdir", UNLINK, {0, -1})},
+
+    {{SYS_mkdir, nr_i386::mkdir}, path_syscall("mkdir", MKDIR, {0, -1})},
+    {{SYS_mkdirat, nr_i386::mkdirat}, path_syscall("mkdirat", MKDIR, {1, 0})},
+
+    // A symlink's target is stored, not looked up; only the link is a path
+    {{SYS_link, nr_i386::link}, path_syscall("link", LINK, {0, -1}, {1, -1})},
+    {{SYS_linkat, nr_i386::linkat}, path_syscall("linkat", LINK, {1, 0}, {3, 2})},
+    {{SYS_symlink, nr_i386::symlink}, path_syscall("symlink", LINK, {1, -1})},
+    {{SYS_symlinkat, nr_i386::symlinkat}, path_syscall("symlinkat", LINK, {2, 1})},
+
+    {{SYS_truncate, nr_i386::truncate}, path_syscall("truncate", TRUNCATE, {0, -1})},
+    {{-1, nr_i386::truncate64}, path_syscall("truncate64", TRUNCATE, {0, -1})},
+
+    {{SYS_execve, nr_i386::execve}, path_syscall("execve", EXEC, {0, -1})},
+    {{SYS_execveat, nr_i386::execveat}, path_syscall("execveat", EXEC, {1, 0})},
+
+    {{SYS_name_to_handle_at, nr_i386::name_to_handle_at}, path_syscall("name_to_handle_at", HANDLE, {1, 0})},
+
+    // Traced whatever is recorded: they keep the per-process descriptor
+    // table and working directory current
+    {{SYS_close, nr_i386::close}, state_syscall("close", Handling::CLOSE)},
+    {{SYS_close_range, nr_i386::close_range}, state_syscall("close_range", Handling::CLOSE_RANGE)},
+    {{SYS_fcntl, nr_i386::fcntl}, state_syscall("fcntl", Handling::FCNTL)},
+    {{-1, nr_i386::fcntl64}, state_syscall("fcntl64", Handling::FCNTL)},
+    {{SYS_dup, nr_i386::dup}, state_syscall("dup", Handling::DUP)},
+    {{SYS_dup2, nr_i386::dup2}, state_syscall("dup2", Handling::DUP)},
+    {{SYS_dup3, nr_i386::dup3}, state_syscall("dup3", Handling::DUP, NONE, {}, 2)},
+    {{SYS_chdir, nr_i386::chdir}, state_syscall("chdir", Handling::CHDIR, CHDIR, {0, -1})},
+    {{SYS_fchdir, nr_i386::fchdir}, state_syscall("fchdir", Handling::FCHDIR)},
+
+    // io_uring submits operations without a syscall each. Rings are
+    // followed from their setup and mapping so that io_uring_enter can read
+    // what is submitted; only MAP_SHARED mappings can be rings. 32-bit
+    // rings are not followed.
+    {{SYS_io_uring_setup, -1}, state_syscall("io_uring_setup", Handling::URING_SETUP)},
+    {{SYS_io_uring_register, -1}, state_syscall("io_uring_register", Handling::URING_REGISTER)},
+    {{SYS_io_uring_enter, -1}, state_syscall("io_uring_enter", Handling::URING_ENTER)},
+    {{SYS_mmap, -1}, with_filter(state_syscall("mmap", Handling::MMAP), 3, MAP_SHARED)},
+};
+
+constexpr std::array<SyscallDescriptor, table_size> build_table(Abi abi) {
+    std::array<SyscallDescriptor, table_size> table = {};
+    for (const Entry& entry : entries) {
+        if (entry.numbers[abi] >= 0) {
+            table[static_cast<size_t>(entry.numbers[abi])] = entry.descriptor;
+        }
+    }
+    return table;
+}
+
+} // namespace detail
+
+// One table per ABI, indexed by syscall number
+inline constexpr std::array<std::array<SyscallDescriptor, table_size>, abi_count> tables = {
+    detail::build_table(X86_64), detail::build_table(I386)
+};
+
+// Descriptor of syscall nr on abi; an IGNORE entry for numbers outside
+// the table
+inline const SyscallDescriptor& describe(Abi abi, long nr) {
+    static constexpr SyscallDescriptor untraced = {};
+    return static_cast<unsigned long>(nr) < table_size ? tables[abi][static_cast<size_t>(nr)] : untraced;
+}
+
+// Whether a syscall's entry stop needs handling when recording categories
+inline bool is_traced(const SyscallDescriptor& descriptor, uint32_t categories) {
+    switch (descriptor.handling) {
+        case Handling::IGNORE:
+            return false;
+        case Handling::PATH:
+            return (descriptor.category & categories) != 0;
+        case Handling::URING_SETUP:
+        case Handling::URING_REGISTER:
+        case Handling::URING_ENTER:
+        case Handling::MMAP:
+            return (ring_categories & categories) != 0;
+        default:
+            return true;
+    }
+}
+
+// Syscalls of abi to stop on when recording categories; the seccomp
+// pre-filter is built from this list. Thread and process creation and exit
+// are reported by PTRACE_EVENT stops and waitpid, which do not need it.
+inline std::vector<long> traced_syscalls(uint32_t categories, Abi abi = X86_64) {
+    std::vector<long> syscalls;
+    for (size_t nr = 0; nr < table_size; nr++) {
+        if (is_traced(tables[abi][nr], categories)) {
+            syscalls.push_back(static_cast<long>(nr));
+        }
+    }
+    return syscalls;
+}
+
+// Path syscalls of abi in the given categories only
+inline std::vector<long> syscalls_in(uint32_t categories, Abi abi = X86_64) {
+    std::vector<long> syscalls;
+    for (size_t nr = 0; nr < table_size; nr++) {
+        const SyscallDescriptor& descriptor = tables[abi][nr];
+        if (descriptor.handling == Handling::PATH && (descriptor.category & categories) != 0) {
+            syscalls.push_back(static_cast<long>(nr));
+        }
+    }
+    return syscalls;
+}
+
+// Parse a comma-separated list of category names, or "all". Returns false
+// and names the offending entry in error on an unknown name.
+inline bool parse_categories(const std::string& list, uint32_t& categories, std::string& error) {
+    categories = NONE;
+    std::istringstream names(list);
+    std::string name;
+    while (std::getline(names, name, ',')) {
+        if (name == "all") {
+            categories |= all_categories;
+            continue;
+        }
+        uint32_t bit = 0;
+        for (size_t i = 0; i < sizeof(category_names) / sizeof(category_names[0]); i++) {
+            if (name == category_names[i]) {
+                bit = 1u << i;
+            }
+        }
+        if (bit == 0) {
+            error = "Unknown syscall category: " + name;
+            return false;
+        }
+        categories |= bit;
+    }
+    if (categories == NONE) {
+        error = "No syscall categories given";
+        return false;
+    }
+    return true;
+}
+
+} // namespace syscall_table
+
+#endif // SYSCALL_TABLE_HPP
@@ -0,0 +1,229 @@
+#ifndef TRACER_EVENTS_HPP
+#define TRACER_EVENTS_HPP
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <unordered_map>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+
+namespace tracer_events {
+
+// Sources that ended a wait
+enum Wakeup : uint32_t {
+    NONE = 0,               // Interrupted by a handled signal
+    CHILD = 1u << 0,        // SIGCHLD: a tracee stopped or exited
+    EXITED = 1u << 1,       // A watched process exited
+    PERIODIC = 1u << 2,     // The periodic timer expired
+    DEADLINE = 1u << 3,     // The one-shot deadline passed
+    CONTROL = 1u << 4,      // The control descriptor has input
+};
+
+// What the tracer waits on between stops, in one epoll set: a signalfd
+// for SIGCHLD, a pidfd per watched process, a periodic timerfd, a
+// one-shot deadline timerfd and optionally a control descriptor. Nothing in it wakes the tracer while tracees
+// run without stopping.
+class TracerEvents {
+public:
+    TracerEvents() = default;
+
+    ~TracerEvents() {
+        for (const auto& entry : pidfds) {
+            close(entry.first);
+        }
+        for (int fd : {signal_fd, periodic_fd, deadline_fd, epoll_fd}) {
+            if (fd != -1) {
+                close(fd);
+            }
+        }
+    }
+
+    TracerEvents(const TracerEvents&) = delete;
+    TracerEvents& operator=(const TracerEvents&) = delete;
+
+    // Set up the epoll set with the periodic timer firing every period.
+    // SIGCHLD must already be blocked in every thread of the tracer, or it
+    // is delivered instead of queued for the signalfd. SIGCHLD is for the
+    // whole process, so a tracer sharing the process with other tracers
+    // leaves it out with watch_sigchld and waits for its tracees itself.
+    bool init(std::chrono::milliseconds period, bool watch_sigchld = true) {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd == -1) {
+            last_error = std::string("epoll_create1: ") + strerror(errno);
+            return false;
+        }
+
+        if (watch_sigchld) {
+            sigset_t sigchld;
+            sigemptyset(&sigchld);
+            sigaddset(&sigchld, SIGCHLD);
+            signal_fd = signalfd(-1, &sigchld, SFD_NONBLOCK | SFD_CLOEXEC);
+            if (signal_fd == -1) {
+                last_error = std::string("signalfd: ") + strerror(errno);
+                return false;
+            }
+        }
+
+        periodic_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        deadline_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (periodic_fd == -1 || deadline_fd == -1) {
+            last_error = std::string("timerfd_create: ") + strerror(errno);
+            return false;
+        }
+        struct itimerspec spec = {};
+        spec.it_value = to_timespec(period);
+        spec.it_interval = spec.it_value;
+        if (timerfd_settime(periodic_fd, 0, &spec, nullptr) == -1) {
+            last_error = std::string("timerfd_settime: ") + strerror(errno);
+            return false;
+        }
+
+        for (int fd : {signal_fd, periodic_fd, deadline_fd}) {
+            if (fd != -1 && !add(fd)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Watch process pid for its exit through a pidfd. Fails on kernels
+    // without pidfd_open (Linux < 5.3) and for processes already reaped.
+    bool watch_process(pid_t pid) {
+        if (by_pid.count(pid) != 0) {
+            return true;
+        }
+        int fd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+        if (fd == -1) {
+            last_error = std::string("pidfd_open: ") + strerror(errno);
+            return false;
+        }
+        if (!add(fd)) {
+            close(fd);
+            return false;
+        }
+        pidfds[fd] = pid;
+        by_pid[pid] = fd;
+        return true;
+    }
+
+    void unwatch_process(pid_t pid) {
+        auto it = by_pid.find(pid);
+        if (it != by_pid.end()) {
+            close(it->second);  // Closing removes it from the epoll set
+            pidfds.erase(it->second);
+            by_pid.erase(it);
+        }
+    }
+
+    size_t watched_processes() const {
+        return by_pid.size();
+    }
+
+    // Also wake for input on fd, which the caller reads
+    bool watch_control(int fd) {
+        if (!add(fd)) {
+            return false;
+        }
+        control_fd = fd;
+        return true;
+    }
+
+    // Fire DEADLINE once after delay; a zero delay fires at once
+    void set_deadline(std::chrono::nanoseconds delay) {
+        struct itimerspec spec = {};
+        spec.it_value = to_timespec(delay);
+        if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) {
+            spec.it_value.tv_nsec = 1;  // Zero would disarm
+        }
+        timerfd_settime(deadline_fd, 0, &spec, nullptr);
+    }
+
+    void clear_deadline() {
+        struct itimerspec spec = {};
+        timerfd_settime(deadline_fd, 0, &spec, nullptr);
+    }
+
+    // Wait until a source fires, or only poll them unless block is set.
+    // Returns the sources that fired; watched processes that exited are
+    // appended to exited and no longer watched.
+    uint32_t wait(std::vector<pid_t>& exited, bool block = true) {
+        struct epoll_event events[16];
+        int count = epoll_wait(epoll_fd, events, 16, block ? -1 : 0);
+        if (count <= 0) {
+            return NONE;
+        }
+        uint32_t woke = NONE;
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            if (fd == signal_fd) {
+                // SIGCHLDs coalesce; drain them all, waitpid finds who
+                struct signalfd_siginfo info;
+                while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                }
+                woke |= CHILD;
+            } else if (fd == control_fd) {
+                woke |= CONTROL;
+            } else if (fd == periodic_fd || fd == deadline_fd) {
+                uint64_t expirations;
+                if (read(fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                    woke |= fd == periodic_fd ? PERIODIC : DEADLINE;
+                }
+            } else {
+                auto it = pidfds.find(fd);
+                if (it != pidfds.end()) {
+                    exited.push_back(it->second);
+                    unwatch_process(it->second);
+                    woke |= EXITED;
+                }
+            }
+        }
+        return woke;
+    }
+
+    const std::string& get_last_error() const {
+        return last_error;
+    }
+
+private:
+    int epoll_fd = -1;
+    int signal_fd = -1;
+    int periodic_fd = -1;
+    int deadline_fd = -1;
+    int control_fd = -1;  // Owned by the caller
+    std::unordered_map<int, pid_t> pidfds;
+    std::unordered_map<pid_t, int> by_pid;
+    std::string last_error;
+
+    bool add(int fd) {
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+            last_error = std::string("epoll_ctl: ") + strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    template<typename Duration>
+    static struct timespec to_timespec(Duration duration) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+        struct timespec ts;
+        ts.tv_sec = static_cast<time_t>(ns / 1000000000);
+        ts.tv_nsec = static_cast<long>(ns % 1000000000);
+        return ts;
+    }
+};
+
+} // namespace tracer_events
+
+#endif // TRACER_EVENTS_HPP
@@ -0,0 +1,23 @@
+/* 32-bit tracee for the ia32 compat decoding tests. Freestanding, so that
+ * it builds with -m32 without a 32-bit libc: it makes its syscalls through
+ * int $0x80 with i386 numbers, opening /dev/null with open and a missing
+ * relative path with openat, then exits. */
+
+#define NR_EXIT 1
+#define NR_OPEN 5
+#define NR_OPENAT 295
+#define AT_FDCWD (-100)
+
+static long syscall3(long nr, long a, long b, long c) {
+    long ret;
+    __asm__ volatile("int $0x80" : "=a"(ret) : "a"(nr), "b"(a), "c"(b), "d"(c) : "memory");
+    return ret;
+}
+
+void _start(void) {
+    long fd = syscall3(NR_OPEN, (long)"/dev/null", 0, 0);
+    syscall3(NR_OPENAT, AT_FDCWD, (long)"filetrace_compat_missing", 0);
+    syscall3(NR_EXIT, fd >= 0 ? 0 : 1, 0, 0);
+    for (;;) {
+    }
+}
@@ -0,0 +1,61 @@
+/* Tracee for the trace session tests. It switches filetrace between
+ * recording and pass-through through the control FIFO given as argv[1],
+ * changing its working directory and replacing descriptor 10 while
+ * recording is paused, then opens relative to both once it is recording
+ * again. argv[2] holds the subdirectories a and b. */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DIR_FD 10
+
+static void control(const char* fifo, const char* command) {
+    int fd = open(fifo, O_WRONLY);
+    if (fd >= 0) {
+        write(fd, command, strlen(command));
+        close(fd);
+    }
+    /* Long enough for the tracer to apply it */
+    struct timespec delay = {0, 300000000};
+    nanosleep(&delay, NULL);
+}
+
+static void enter(const char* dir) {
+    chdir(dir);
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    close(DIR_FD);
+    dup2(fd, DIR_FD);
+    close(fd);
+}
+
+static void create(int dirfd, const char* name) {
+    int fd = openat(dirfd, name, O_WRONLY | O_CREAT, 0600);
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+int main(int argc, char** argv) {
+    char a[4096], b[4096];
+    if (argc < 3) {
+        return 2;
+    }
+    snprintf(a, sizeof(a), "%s/a", argv[2]);
+    snprintf(b, sizeof(b), "%s/b", argv[2]);
+
+    /* Followed while recording: cwd and descriptor 10 are a */
+    enter(a);
+    create(AT_FDCWD, "first");
+    create(DIR_FD, "first_at");
+
+    control(argv[1], "pass");
+    enter(b);
+    control(argv[1], "record");
+
+    create(AT_FDCWD, "rel");
+    create(DIR_FD, "at");
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include "ebpf_backend.hpp"
+
+static const ebpf_backend::MapFds test_maps = {3, 4, 5, 6};
+
+// Conditional jumps land inside the program, and the shared exit and the
+// dropped-event counter both end in an exit instruction
+TEST(EbpfBackendTest, ProgramJumpsStayInProgram) {
+    auto program = ebpf_backend::build_path_entry_program(test_maps, ebpf_backend::EVENT_OPEN, 16, 24, 32);
+    ASSERT_GE(program.size(), 2u);
+    EXPECT_EQ(program.back().code, BPF_JMP | BPF_EXIT);
+    size_t exits = 0;
+    for (size_t i = 0; i < program.size(); i++) {
+        uint8_t code = program[i].code;
+        if (code == (BPF_JMP | BPF_EXIT)) {
+            exits++;
+        } else if (BPF_CLASS(code) == BPF_JMP && BPF_OP(code) != BPF_CALL) {
+            size_t target = i + 1 + program[i].off;
+            EXPECT_GT(target, i);
+            EXPECT_LT(target, program.size());
+        }
+    }
+    EXPECT_EQ(exits, 2u);
+}
+
+TEST(EbpfBackendTest, ProgramsReferenceTheirMaps) {
+    auto uses_map = [](const std::vector<bpf_insn>& program, int fd) {
+        for (const auto& instruction : program) {
+            if (instruction.code == (BPF_LD | BPF_DW | BPF_IMM) && instruction.src_reg == BPF_PSEUDO_MAP_FD &&
+                instruction.imm == fd) {
+                return true;
+            }
+        }
+        return false;
+    };
+    auto fork_program = ebpf_backend::build_fork_program(test_maps, 20);
+    EXPECT_TRUE(uses_map(fork_program, test_maps.traced));
+    EXPECT_TRUE(uses_map(fork_program, test_maps.events));
+
+    // Path events are assembled in the scratch buffer, and every program
+    // that writes to the ring counts what does not fit
+    auto open_program = ebpf_backend::build_path_entry_program(test_maps, ebpf_backend::EVENT_OPEN, 16, 24, 32);
+    EXPECT_TRUE(uses_map(open_program, test_maps.scratch));
+    EXPECT_TRUE(uses_map(open_program, test_maps.dropped));
+    EXPECT_TRUE(uses_map(fork_program, test_maps.dropped));
+    EXPECT_FALSE(uses_map(ebpf_backend::build_task_exit_program(test_maps), test_maps.dropped));
+}
+
+// Programs look up the task id that the exit program deletes, not the
+// thread group id, so a leader's exit leaves its other threads traced
+TEST(EbpfBackendTest, TracedMapIsKeyedByTaskId) {
+    auto shifts_before_lookup = [](const std::vector<bpf_insn>& program) {
+        for (const auto& instruction : program) {
+            if (instruction.code == (BPF_JMP | BPF_CALL) && instruction.imm == BPF_FUNC_map_lookup_elem) {
+                return false;
+            }
+            if (instruction.code == (BPF_ALU64 | BPF_RSH | BPF_K)) {
+                return true;
+            }
+        }
+        return false;
+    };
+    EXPECT_FALSE(shifts_before_lookup(
+        ebpf_backend::build_path_entry_program(test_maps, ebpf_backend::EVENT_OPEN, 16, 24, 32)));
+    EXPECT_FALSE(shifts_before_lookup(ebpf_backend::build_fork_program(test_maps, 20)));
+
+    // A thread that execs moves its entry to the id it takes over
+    auto exec_program = ebpf_backend::build_exec_program(test_maps, 8, 12);
+    EXPECT_EQ(exec_program.back().code, BPF_JMP | BPF_EXIT);
+    bool deletes = false;
+    bool updates = false;
+    for (const auto& instruction : exec_program) {
+        deletes |= instruction.code == (BPF_JMP | BPF_CALL) && instruction.imm == BPF_FUNC_map_delete_elem;
+        updates |= instruction.code == (BPF_JMP | BPF_CALL) && instruction.imm == BPF_FUNC_map_update_elem;
+    }
+    EXPECT_TRUE(deletes);
+    EXPECT_TRUE(updates);
+}
+
+TEST(EbpfBackendTest, ReportsOpensOfTracedProcess) {
+    ebpf_backend::EbpfTracer tracer;
+    if (!tracer.load(1 << 16)) {
+        GTEST_SKIP() << "eBPF tracing unavailable: " << tracer.get_last_error();
+    }
+    ASSERT_TRUE(tracer.trace_process(getpid())) << tracer.get_last_error();
+
+    auto missing = std::filesystem::temp_directory_path() / "filetrace_ebpf_test_missing";
+    int fd = open(missing.c_str(), O_RDONLY);
+    ASSERT_EQ(fd, -1);
+
+    bool saw_open = false;
+    bool saw_result = false;
+    tracer.consume([&](const ebpf_backend::EventHeader& event, const char* path) {
+        if (event.tid != static_cast<uint32_t>(gettid())) {
+            return;
+        }
+        if (event.type == ebpf_backend::EVENT_OPEN && path != nullptr && missing == path) {
+            saw_open = true;
+        } else if (event.type == ebpf_backend::EVENT_RESULT && saw_open) {
+            saw_result = event.value == -ENOENT;
+        }
+    });
+    EXPECT_TRUE(saw_open);
+    EXPECT_TRUE(saw_result);
+    EXPECT_EQ(tracer.dropped(), 0u);
+}
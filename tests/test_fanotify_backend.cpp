@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+#include "fanotify_backend.hpp"
+
+TEST(FanotifyBackendTest, ListsRootMount) {
+    auto mount_points = fanotify_backend::list_mount_points();
+    EXPECT_NE(std::find(mount_points.begin(), mount_points.end(), "/"), mount_points.end());
+}
+
+TEST(FanotifyBackendTest, ReportsOpensWithPath) {
+    fanotify_backend::FanotifyMonitor monitor;
+    if (!monitor.init()) {
+        GTEST_SKIP() << "fanotify unavailable: " << monitor.get_last_error();
+    }
+
+    auto test_dir = std::filesystem::temp_directory_path() / "filetrace_fanotify_test";
+    std::filesystem::create_directory(test_dir);
+    auto test_file = test_dir / "written.txt";
+    ASSERT_TRUE(monitor.mark_mount(test_dir.string())) << monitor.get_last_error();
+
+    std::ofstream(test_file) << "content";
+
+    bool saw_open = false;
+    bool saw_close_write = false;
+    std::string expected = std::filesystem::canonical(test_file).string();
+    ASSERT_TRUE(monitor.read_events(
+        [](pid_t tid) { return tid == getpid() || tid == gettid(); },
+        [&](const fanotify_backend::FileEvent& event) {
+            if (event.path == expected) {
+                saw_open |= event.open;
+                saw_close_write |= event.close_write;
+            }
+        }));
+    EXPECT_TRUE(saw_open);
+    EXPECT_TRUE(saw_close_write);
+
+    std::filesystem::remove_all(test_dir);
+}
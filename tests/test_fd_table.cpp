@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include "fd_table.hpp"
+
+class FdTableTest : public ::testing::Test {
+protected:
+    fd_table::FdTable table;
+
+    void SetUp() override {
+        table.set(3, "/tmp/dir", false);
+        table.set(4, "/tmp/dir/file.txt", true);
+    }
+};
+
+TEST_F(FdTableTest, FindsRecordedDescriptors) {
+    ASSERT_NE(table.find(3), nullptr);
+    EXPECT_EQ(*table.find(3), "/tmp/dir");
+    EXPECT_EQ(table.find(5), nullptr);
+
+    table.close(3);
+    EXPECT_EQ(table.find(3), nullptr);
+    EXPECT_EQ(table.size(), 1u);
+}
+
+TEST_F(FdTableTest, DuplicateCopiesPath) {
+    table.duplicate(3, 10, false);
+    ASSERT_NE(table.find(10), nullptr);
+    EXPECT_EQ(*table.find(10), "/tmp/dir");
+
+    // dup2 onto an open descriptor replaces it
+    table.duplicate(3, 4, false);
+    EXPECT_EQ(*table.find(4), "/tmp/dir");
+
+    // Duplicating an unknown descriptor leaves newfd unknown, not stale
+    table.duplicate(7, 10, false);
+    EXPECT_EQ(table.find(10), nullptr);
+}
+
+TEST_F(FdTableTest, CloseRange) {
+    table.set(5, "/tmp/other", false);
+
+    table.close_range(4, ~0U, true);
+    EXPECT_EQ(table.size(), 3u);
+
+    table.close_range(4, 4, false);
+    EXPECT_EQ(table.find(4), nullptr);
+    EXPECT_NE(table.find(3), nullptr);
+    EXPECT_NE(table.find(5), nullptr);
+}
+
+TEST_F(FdTableTest, ExecDropsCloexecDescriptors) {
+    table.set_cloexec(3, true);
+    table.set(5, "/tmp/kept", false);
+    table.drop_cloexec();
+
+    EXPECT_EQ(table.find(3), nullptr);
+    EXPECT_EQ(table.find(4), nullptr);
+    ASSERT_NE(table.find(5), nullptr);
+    EXPECT_EQ(*table.find(5), "/tmp/kept");
+}
@@ -6,7 +6,9 @@
 #include <filesystem>
 #include <thread>
 #include <atomic>
+#include <sstream>
 #include "../src/path_utils.hpp"
+#include "../src/directory_tree.hpp"
 
 class FileMonitoringTest : public ::testing::Test {
 protected:
@@ -111,3 +113,20 @@ TEST_F(FileMonitoringTest, ConcurrentFileOperations) {
         << "All concurrent file stat operations should succeed";
 }
 
+
+TEST_F(FileMonitoringTest, LexicalNormalizationLeavesSymlinks) {
+    EXPECT_EQ(path_utils::lexical_normalize("/a//b/./c/../d"), "/a/b/d");
+    EXPECT_EQ(path_utils::lexical_normalize("/a/b/"), "/a/b");
+    EXPECT_EQ(path_utils::lexical_normalize("/.."), "/");
+
+    // The symlink itself is reported, not its target
+    EXPECT_EQ(path_utils::lexical_normalize(symlink_file.string()), symlink_file.string());
+
+    // and so is it in the report tree
+    DirectoryTree tree;
+    tree.insert_file(symlink_file.string(), 1, getpid(), "test");
+    std::stringstream html;
+    tree.generate_html(html);
+    EXPECT_NE(html.str().find("symlink.txt"), std::string::npos);
+    EXPECT_EQ(html.str().find("existing.txt"), std::string::npos);
+}
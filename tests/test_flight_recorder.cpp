@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "flight_recorder.hpp"
+
+namespace {
+using Recorder = flight_recorder::FlightRecorder<std::string>;
+using std::chrono::milliseconds;
+
+std::vector<std::string> kept(const Recorder& recorder, Recorder::Clock::time_point now) {
+    std::vector<std::string> items;
+    recorder.for_each([&](const std::string& item) { items.push_back(item); }, now);
+    return items;
+}
+}
+
+TEST(FlightRecorderTest, KeepsTheMostRecentItems) {
+    Recorder recorder(3);
+    auto now = Recorder::Clock::now();
+    EXPECT_TRUE(kept(recorder, now).empty());
+
+    recorder.record("a", now);
+    recorder.record("b", now);
+    EXPECT_EQ(kept(recorder, now), (std::vector<std::string>{"a", "b"}));
+
+    for (const char* item : {"c", "d", "e"}) {
+        recorder.record(item, now);
+    }
+    EXPECT_EQ(kept(recorder, now), (std::vector<std::string>{"c", "d", "e"}));
+    EXPECT_EQ(recorder.size(), 3u);
+    EXPECT_EQ(recorder.capacity(), 3u);
+    EXPECT_EQ(recorder.total_recorded(), 5u);
+}
+
+TEST(FlightRecorderTest, WindowSkipsOldItems) {
+    Recorder recorder(8, milliseconds(100));
+    auto now = Recorder::Clock::now();
+    recorder.record("old", now);
+    recorder.record("recent", now + milliseconds(150));
+    EXPECT_EQ(kept(recorder, now + milliseconds(200)), (std::vector<std::string>{"recent"}));
+    EXPECT_EQ(kept(recorder, now + milliseconds(50)).size(), 2u);
+}
+
+TEST(FlightRecorderTest, ParsesEventsOrDuration) {
+    flight_recorder::Limit limit;
+    std::string error;
+    ASSERT_TRUE(flight_recorder::parse_limit("50000", limit, error)) << error;
+    EXPECT_EQ(limit.events, 50000u);
+    EXPECT_EQ(limit.window, milliseconds(0));
+
+    ASSERT_TRUE(flight_recorder::parse_limit("30s", limit, error)) << error;
+    EXPECT_EQ(limit.events, flight_recorder::window_capacity);
+    EXPECT_EQ(limit.window, milliseconds(30000));
+    ASSERT_TRUE(flight_recorder::parse_limit("250ms", limit, error)) << error;
+    EXPECT_EQ(limit.window, milliseconds(250));
+    ASSERT_TRUE(flight_recorder::parse_limit("2m", limit, error)) << error;
+    EXPECT_EQ(limit.window, milliseconds(120000));
+
+    ASSERT_TRUE(flight_recorder::parse_limit(std::to_string(flight_recorder::max_events), limit, error)) << error;
+    EXPECT_EQ(limit.events, flight_recorder::max_events);
+
+    for (const char* spec : {"", "0", "s", "10x", "-5", "1.5s", "1048577", "999999999999"}) {
+        EXPECT_FALSE(flight_recorder::parse_limit(spec, limit, error)) << spec;
+    }
+}
+
+TEST(FlightRecorderTest, CrashSignals) {
+    EXPECT_TRUE(flight_recorder::is_crash_signal(SIGSEGV));
+    EXPECT_TRUE(flight_recorder::is_crash_signal(SIGABRT));
+    EXPECT_FALSE(flight_recorder::is_crash_signal(SIGTERM));
+    EXPECT_FALSE(flight_recorder::is_crash_signal(SIGKILL));
+}
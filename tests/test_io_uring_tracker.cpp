@@ -0,0 +1,211 @@
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "io_uring_tracker.hpp"
+
+namespace {
+// A ring of this process, set up and mapped the way liburing does
+class RingFixture : public ::testing::Test {
+protected:
+    int fd = -1;
+    struct io_uring_params params = {};
+    char* sq_ring = nullptr;
+    char* cq_ring = nullptr;
+    struct io_uring_sqe* sqes = nullptr;
+    size_t sq_size = 0, cq_size = 0;
+
+    void SetUp() override {
+        fd = static_cast<int>(syscall(SYS_io_uring_setup, 4, &params));
+        if (fd == -1) {
+            GTEST_SKIP() << "io_uring unavailable: " << strerror(errno);
+        }
+        sq_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            sq_size = cq_size = std::max(sq_size, cq_size);
+        }
+        sq_ring = map(sq_size, IORING_OFF_SQ_RING);
+        cq_ring = (params.features & IORING_FEAT_SINGLE_MMAP) ? sq_ring : map(cq_size, IORING_OFF_CQ_RING);
+        sqes = reinterpret_cast<struct io_uring_sqe*>(
+            map(params.sq_entries * sizeof(struct io_uring_sqe), IORING_OFF_SQES));
+        ASSERT_NE(sq_ring, nullptr);
+        ASSERT_NE(cq_ring, nullptr);
+        ASSERT_NE(sqes, nullptr);
+    }
+
+    void TearDown() override {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+
+    char* map(size_t size, unsigned long long offset) {
+        void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                          static_cast<off_t>(offset));
+        return addr == MAP_FAILED ? nullptr : static_cast<char*>(addr);
+    }
+
+    uint32_t& sq(uint32_t offset) {
+        return *reinterpret_cast<uint32_t*>(sq_ring + offset);
+    }
+
+    // Queue an entry as an application would, without entering the kernel
+    struct io_uring_sqe* queue(uint8_t opcode, uint64_t user_data) {
+        uint32_t tail = sq(params.sq_off.tail);
+        uint32_t index = tail & (params.sq_entries - 1);
+        struct io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->user_data = user_data;
+        reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.array)[index] = index;
+        __atomic_store_n(&sq(params.sq_off.tail), tail + 1, __ATOMIC_RELEASE);
+        return sqe;
+    }
+
+    void track(io_uring_tracker::RingTable& rings) {
+        rings.add(fd, params);
+        rings.map(fd, IORING_OFF_SQ_RING, reinterpret_cast<unsigned long>(sq_ring));
+        rings.map(fd, IORING_OFF_CQ_RING, reinterpret_cast<unsigned long>(cq_ring));
+        rings.map(fd, IORING_OFF_SQES, reinterpret_cast<unsigned long>(sqes));
+    }
+};
+
+io_uring_tracker::Submission submission(uint64_t user_data, uint32_t cq_tail) {
+    io_uring_tracker::Submission s;
+    s.tid = getpid();
+    s.user_data = user_data;
+    s.op = io_uring_tracker::describe_op(IORING_OP_OPENAT);
+    s.open_flags = 0;
+    s.fixed_slot = false;
+    s.cq_tail = cq_tail;
+    return s;
+}
+}
+
+TEST(IoUringTrackerTest, DescribesPathOperations) {
+    const io_uring_tracker::OpDescriptor* openat = io_uring_tracker::describe_op(IORING_OP_OPENAT);
+    ASSERT_NE(openat, nullptr);
+    EXPECT_EQ(openat->category, syscall_table::OPEN);
+    EXPECT_EQ(openat->paths[0].path, io_uring_tracker::Field::ADDR);
+    EXPECT_EQ(openat->paths[0].dirfd, io_uring_tracker::Field::FD);
+
+    // renameat takes its second directory descriptor in len
+    const io_uring_tracker::OpDescriptor* renameat = io_uring_tracker::describe_op(IORING_OP_RENAMEAT);
+    ASSERT_NE(renameat, nullptr);
+    EXPECT_EQ(renameat->paths[1].dirfd, io_uring_tracker::Field::LEN);
+
+    EXPECT_EQ(io_uring_tracker::describe_op(IORING_OP_READ), nullptr);
+    EXPECT_EQ(io_uring_tracker::describe_op(IORING_OP_NOP), nullptr);
+}
+
+TEST(IoUringTrackerTest, ReadsSlotsAcrossTheWrap) {
+    uint32_t ring[4] = {10, 11, 12, 13};
+    uint32_t out[3] = {};
+    process_memory::ProcessMemoryReader reader;
+    ASSERT_TRUE(io_uring_tracker::read_slots(reader, getpid(), reinterpret_cast<unsigned long>(ring),
+                                             sizeof(uint32_t), 4, 7, 3, reinterpret_cast<char*>(out)));
+    EXPECT_EQ(out[0], 13u);
+    EXPECT_EQ(out[1], 10u);
+    EXPECT_EQ(out[2], 11u);
+}
+
+TEST(IoUringTrackerTest, RegisteredIndexOutlivesDescriptor) {
+    io_uring_tracker::RingTable rings;
+    struct io_uring_params params = {};
+    params.cq_entries = 8;
+    rings.add(5, params);
+    EXPECT_TRUE(rings.is_ring(5));
+    EXPECT_FALSE(rings.is_ring(6));
+
+    rings.register_index(100, 0, 5);
+    rings.close(5);
+    EXPECT_FALSE(rings.is_ring(5));
+    EXPECT_NE(rings.find_registered(100, 0), nullptr);
+    // Indexes belong to the thread that registered them
+    EXPECT_EQ(rings.find_registered(101, 0), nullptr);
+
+    rings.unregister_index(100, 0);
+    EXPECT_EQ(rings.find_registered(100, 0), nullptr);
+}
+
+TEST_F(RingFixture, ReadsPendingSubmissions) {
+    io_uring_tracker::RingTable rings;
+    track(rings);
+    io_uring_tracker::Ring* ring = rings.find(fd);
+    ASSERT_NE(ring, nullptr);
+    ASSERT_TRUE(ring->mapped());
+
+    const char* path = "/dev/null";
+    struct io_uring_sqe* open_sqe = queue(IORING_OP_OPENAT, 7);
+    open_sqe->fd = AT_FDCWD;
+    open_sqe->addr = reinterpret_cast<unsigned long>(path);
+    open_sqe->open_flags = O_RDONLY | O_CLOEXEC;
+    queue(IORING_OP_NOP, 8);
+
+    process_memory::ProcessMemoryReader reader;
+    std::vector<struct io_uring_sqe> read;
+    uint32_t cq_tail;
+    ASSERT_TRUE(io_uring_tracker::read_submissions(reader, getpid(), *ring, 8, read, cq_tail));
+    ASSERT_EQ(read.size(), 2u);
+    EXPECT_EQ(read[0].opcode, IORING_OP_OPENAT);
+    EXPECT_EQ(read[0].addr, reinterpret_cast<unsigned long>(path));
+    EXPECT_EQ(read[0].fd, AT_FDCWD);
+    EXPECT_EQ(read[1].user_data, 8u);
+
+    // Only as many as io_uring_enter is asked to submit
+    ASSERT_TRUE(io_uring_tracker::read_submissions(reader, getpid(), *ring, 1, read, cq_tail));
+    EXPECT_EQ(read.size(), 1u);
+
+    // The open's completion carries its descriptor
+    auto pending = submission(7, cq_tail);
+    pending.path = path;
+    io_uring_tracker::track(*ring, pending, [](io_uring_tracker::Submission&, bool, int32_t) {
+        ADD_FAILURE() << "Nothing should be evicted";
+    });
+    ASSERT_EQ(syscall(SYS_io_uring_enter, fd, 2, 2, IORING_ENTER_GETEVENTS, nullptr, 0), 2);
+
+    int completed = 0;
+    int32_t result = -1;
+    io_uring_tracker::reap_completions(reader, getpid(), *ring,
+                                       [&](io_uring_tracker::Submission& s, bool known, int32_t res) {
+        EXPECT_TRUE(known);
+        EXPECT_EQ(s.path, path);
+        result = res;
+        completed++;
+    });
+    EXPECT_EQ(completed, 1);
+    EXPECT_GE(result, 0);
+    EXPECT_TRUE(ring->in_flight.empty());
+    if (result >= 0) {
+        close(result);
+    }
+}
+
+TEST_F(RingFixture, FlushesSubmissionsPastTheCompletionQueue) {
+    io_uring_tracker::RingTable rings;
+    track(rings);
+    io_uring_tracker::Ring* ring = rings.find(fd);
+    ASSERT_NE(ring, nullptr);
+
+    std::vector<uint64_t> evicted;
+    auto done = [&](io_uring_tracker::Submission& s, bool known, int32_t) {
+        EXPECT_FALSE(known);
+        evicted.push_back(s.user_data);
+    };
+    for (uint64_t i = 0; i < params.cq_entries + 2; i++) {
+        io_uring_tracker::track(*ring, submission(i, 0), done);
+    }
+    ASSERT_EQ(evicted.size(), 2u);
+    EXPECT_EQ(evicted[0], 0u);
+    EXPECT_EQ(evicted[1], 1u);
+
+    evicted.clear();
+    io_uring_tracker::flush(*ring, done);
+    EXPECT_EQ(evicted.size(), params.cq_entries);
+    EXPECT_TRUE(ring->in_flight.empty());
+}
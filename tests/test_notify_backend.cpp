@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string>
+#include "notify_backend.hpp"
+#include "process_memory.hpp"
+
+TEST(NotifyBackendTest, FilterNotifiesListedSyscalls) {
+    auto filter = seccomp_filter::build_filter({SYS_openat}, SECCOMP_RET_USER_NOTIF);
+    ASSERT_EQ(filter.size(), 3u + 1u + 2u + 1u);
+    EXPECT_EQ(filter[4].k, static_cast<unsigned int>(SYS_openat));
+    EXPECT_EQ(filter[5].k, static_cast<unsigned int>(SECCOMP_RET_USER_NOTIF));
+    EXPECT_EQ(filter.back().k, static_cast<unsigned int>(SECCOMP_RET_ALLOW));
+}
+
+// The child opens a file under the filter; the parent sees the path and
+// lets the open go ahead
+TEST(NotifyBackendTest, ContinuesNotifiedOpen) {
+    int sockets[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets), 0);
+    const char* path = "/dev/null";
+    pid_t child = fork();
+    if (child == 0) {
+        close(sockets[0]);
+        int listener_fd = notify_backend::install_listener({SYS_openat});
+        if (listener_fd == -1 || !notify_backend::send_fd(sockets[1], listener_fd)) {
+            _exit(2);
+        }
+        close(listener_fd);
+        int fd = static_cast<int>(syscall(SYS_openat, AT_FDCWD, path, O_RDONLY));
+        _exit(fd >= 0 ? 0 : 1);
+    }
+    close(sockets[1]);
+    int listener_fd = notify_backend::receive_fd(sockets[0]);
+    close(sockets[0]);
+    if (listener_fd == -1) {
+        waitpid(child, nullptr, 0);
+        GTEST_SKIP() << "seccomp user notification unavailable";
+    }
+
+    {
+        notify_backend::NotificationListener listener(listener_fd);
+        const struct seccomp_notif* request = listener.receive();
+        ASSERT_NE(request, nullptr);
+        EXPECT_EQ(static_cast<pid_t>(request->pid), child);
+        EXPECT_EQ(request->data.nr, SYS_openat);
+
+        process_memory::ProcessMemoryReader reader;
+        std::string read_path;
+        ASSERT_TRUE(reader.read_string(child, request->data.args[1], read_path));
+        EXPECT_EQ(read_path, path);
+
+        uint64_t id = request->id;
+        EXPECT_TRUE(listener.is_valid(id));
+        EXPECT_TRUE(listener.continue_syscall(id));
+    }
+
+    int status;
+    waitpid(child, &status, 0);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+}
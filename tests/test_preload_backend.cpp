@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstring>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "preload_backend.hpp"
+
+namespace {
+void write_event(preload_backend::RingHeader* ring, int tid, const char* path) {
+    uint64_t position;
+    preload_backend::EventRecord* event = preload_backend::reserve(ring, position);
+    ASSERT_NE(event, nullptr);
+    event->pid = getpid();
+    event->tid = tid;
+    event->result = 3;
+    std::strcpy(event->path, path);
+    preload_backend::commit(ring, position);
+}
+}
+
+TEST(PreloadBackendTest, DeliversRecordsInOrder) {
+    preload_backend::EventRing ring;
+    ASSERT_TRUE(ring.init(4)) << ring.get_last_error();
+    preload_backend::RingHeader* producer = preload_backend::map_ring(ring.name().c_str());
+    ASSERT_NE(producer, nullptr);
+
+    // Wraps around the four slots twice
+    std::vector<std::string> paths;
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 3; i++) {
+            write_event(producer, i, ("/tmp/file" + std::to_string(round * 3 + i)).c_str());
+        }
+        ring.drain([&](const preload_backend::EventRecord& event) { paths.push_back(event.path); });
+    }
+    ASSERT_EQ(paths.size(), 9u);
+    for (int i = 0; i < 9; i++) {
+        EXPECT_EQ(paths[i], "/tmp/file" + std::to_string(i));
+    }
+    EXPECT_EQ(ring.total(), 9u);
+    EXPECT_EQ(ring.dropped(), 0u);
+}
+
+TEST(PreloadBackendTest, DropsWhenFull) {
+    preload_backend::EventRing ring;
+    ASSERT_TRUE(ring.init(2));
+    preload_backend::RingHeader* producer = preload_backend::map_ring(ring.name().c_str());
+    ASSERT_NE(producer, nullptr);
+
+    write_event(producer, 1, "/a");
+    write_event(producer, 2, "/b");
+    uint64_t position;
+    EXPECT_EQ(preload_backend::reserve(producer, position), nullptr);
+    EXPECT_EQ(ring.dropped(), 1u);
+    EXPECT_EQ(ring.drain([](const preload_backend::EventRecord&) {}), 2u);
+}
+
+TEST(PreloadBackendTest, FinalDrainSkipsUncommittedSlot) {
+    preload_backend::EventRing ring;
+    ASSERT_TRUE(ring.init(8));
+    preload_backend::RingHeader* producer = preload_backend::map_ring(ring.name().c_str());
+    ASSERT_NE(producer, nullptr);
+
+    // A producer that dies between reserve and commit
+    uint64_t position;
+    ASSERT_NE(preload_backend::reserve(producer, position), nullptr);
+    write_event(producer, 1, "/after");
+
+    std::vector<std::string> paths;
+    auto collect = [&](const preload_backend::EventRecord& event) { paths.push_back(event.path); };
+    EXPECT_EQ(ring.drain(collect), 0u);
+    EXPECT_EQ(ring.drain(collect, true), 1u);
+    ASSERT_EQ(paths.size(), 1u);
+    EXPECT_EQ(paths[0], "/after");
+}
+
+TEST(PreloadBackendTest, CollectsFromConcurrentProducers) {
+    preload_backend::EventRing ring;
+    ASSERT_TRUE(ring.init(64));
+    preload_backend::RingHeader* producer = preload_backend::map_ring(ring.name().c_str());
+    ASSERT_NE(producer, nullptr);
+
+    const int producers = 4;
+    const int per_producer = 2000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < producers; t++) {
+        threads.emplace_back([=]() {
+            for (int i = 0; i < per_producer; i++) {
+                uint64_t position;
+                preload_backend::EventRecord* event;
+                while ((event = preload_backend::reserve(producer, position)) == nullptr) {
+                }
+                event->tid = t;
+                event->result = i;
+                preload_backend::commit(producer, position);
+            }
+        });
+    }
+
+    std::vector<int> next(producers, 0);
+    size_t received = 0;
+    bool in_order = true;
+    while (received < static_cast<size_t>(producers * per_producer)) {
+        received += ring.drain([&](const preload_backend::EventRecord& event) {
+            in_order &= event.result == next[event.tid]++;
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_TRUE(in_order);
+    EXPECT_EQ(received, static_cast<size_t>(producers * per_producer));
+}
+
+TEST(PreloadBackendTest, BuildsPreloadList) {
+    EXPECT_EQ(preload_backend::preload_list("/lib/a.so", nullptr), "/lib/a.so");
+    EXPECT_EQ(preload_backend::preload_list("/lib/a.so", "/lib/b.so"), "/lib/a.so:/lib/b.so");
+}
+
+// A process without the library in its environment is traced by ptrace
+TEST(PreloadBackendTest, DoesNotApplyWithoutEnvironment) {
+    EXPECT_FALSE(preload_backend::preload_applies(getpid(), "/nonexistent/libfiletrace_preload.so", "/filetrace-0"));
+}
+
+TEST(PreloadBackendTest, AppliesToDynamicChildWithEnvironment) {
+    const std::string library = "/nonexistent/libfiletrace_preload.so";
+    const std::string ring_name = "/filetrace-test";
+    int ready[2];
+    ASSERT_EQ(pipe(ready), 0);
+    pid_t child = fork();
+    if (child == 0) {
+        // ld.so ignores a missing preload library after a warning
+        close(ready[0]);
+        dup2(ready[1], STDOUT_FILENO);
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDERR_FILENO);
+        setenv("LD_PRELOAD", library.c_str(), 1);
+        setenv(preload_backend::ring_env, ring_name.c_str(), 1);
+        execlp("sh", "sh", "-c", "echo; exec sleep 5", nullptr);
+        _exit(127);
+    }
+    close(ready[1]);
+    char line;
+    ASSERT_EQ(read(ready[0], &line, 1), 1);
+    close(ready[0]);
+    // Wait until sh has exec'd sleep
+    std::string exe_link = "/proc/" + std::to_string(child) + "/exe";
+    for (int i = 0; i < 500; i++) {
+        char target[PATH_MAX] = {};
+        if (readlink(exe_link.c_str(), target, sizeof(target) - 1) > 0 && std::strstr(target, "sleep") != nullptr) {
+            break;
+        }
+        usleep(1000);
+    }
+
+    EXPECT_TRUE(preload_backend::preload_applies(child, library, ring_name));
+    EXPECT_FALSE(preload_backend::preload_applies(child, library, "/filetrace-other"));
+
+    kill(child, SIGKILL);
+    waitpid(child, nullptr, 0);
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include "proc_sampler.hpp"
+
+namespace {
+bool contains(const std::vector<std::string>& paths, const std::string& path) {
+    return std::find(paths.begin(), paths.end(), path) != paths.end();
+}
+
+std::string make_temp_file() {
+    char name[] = "/tmp/filetrace_sampler_XXXXXX";
+    int fd = mkstemp(name);
+    close(fd);
+    char resolved[PATH_MAX];
+    return realpath(name, resolved) != nullptr ? resolved : name;
+}
+}
+
+TEST(ProcSamplerTest, ListsOpenFiles) {
+    std::string path = make_temp_file();
+    int fd = open(path.c_str(), O_RDONLY);
+    ASSERT_NE(fd, -1);
+    EXPECT_TRUE(contains(proc_sampler::list_open_files(getpid()), path));
+    close(fd);
+    EXPECT_FALSE(contains(proc_sampler::list_open_files(getpid()), path));
+    unlink(path.c_str());
+}
+
+TEST(ProcSamplerTest, ListsMappedFilesOnce) {
+    std::string path = make_temp_file();
+    int fd = open(path.c_str(), O_RDWR);
+    ASSERT_NE(fd, -1);
+    ASSERT_EQ(ftruncate(fd, 2 * getpagesize()), 0);
+    // Split into two adjacent mappings with different protections
+    auto* mapping = static_cast<char*>(mmap(nullptr, 2 * getpagesize(), PROT_READ, MAP_SHARED, fd, 0));
+    ASSERT_NE(mapping, MAP_FAILED);
+    ASSERT_EQ(mprotect(mapping + getpagesize(), getpagesize(), PROT_READ | PROT_WRITE), 0);
+    close(fd);
+
+    auto mapped = proc_sampler::list_mapped_files(getpid());
+    EXPECT_EQ(std::count(mapped.begin(), mapped.end(), path), 1);
+    munmap(mapping, 2 * getpagesize());
+    EXPECT_FALSE(contains(proc_sampler::list_mapped_files(getpid()), path));
+    unlink(path.c_str());
+}
+
+TEST(ProcSamplerTest, CountsObservationsAcrossSamples) {
+    std::string path = make_temp_file();
+    int fd = open(path.c_str(), O_RDONLY);
+    ASSERT_NE(fd, -1);
+
+    proc_sampler::ProcSampler sampler;
+    int reported = 0;
+    auto handler = [&](const std::string& seen, const proc_sampler::Observation&) {
+        reported += seen == path;
+    };
+    sampler.sample({getpid()}, false, handler);
+    usleep(2000);
+    sampler.sample({getpid()}, false, handler);
+    close(fd);
+    sampler.sample({getpid()}, false, handler);
+
+    EXPECT_EQ(reported, 1);
+    EXPECT_EQ(sampler.sample_count(), 3u);
+    auto it = sampler.get_observations().find(path);
+    ASSERT_NE(it, sampler.get_observations().end());
+    EXPECT_EQ(it->second.pid, getpid());
+    EXPECT_EQ(it->second.count, 2u);
+    EXPECT_GT(it->second.last_seen_ms, it->second.first_seen_ms);
+    unlink(path.c_str());
+}
+
+TEST(ProcSamplerTest, FollowsChildren) {
+    std::string path = make_temp_file();
+    int ready[2];
+    ASSERT_EQ(pipe(ready), 0);
+    pid_t child = fork();
+    if (child == 0) {
+        int fd = open(path.c_str(), O_RDONLY);
+        char byte = fd != -1;
+        (void)!write(ready[1], &byte, 1);
+        pause();
+        _exit(0);
+    }
+    char byte = 0;
+    ASSERT_EQ(read(ready[0], &byte, 1), 1);
+    close(ready[0]);
+    close(ready[1]);
+    ASSERT_EQ(byte, 1);
+
+    proc_sampler::ProcSampler without_children;
+    without_children.sample({getpid()}, false, [](const std::string&, const proc_sampler::Observation&) {});
+    EXPECT_EQ(without_children.get_observations().count(path), 0u);
+
+    proc_sampler::ProcSampler with_children;
+    with_children.sample({getpid()}, true, [](const std::string&, const proc_sampler::Observation&) {});
+    auto it = with_children.get_observations().find(path);
+    ASSERT_NE(it, with_children.get_observations().end());
+    EXPECT_EQ(it->second.pid, child);
+
+    kill(child, SIGKILL);
+    waitpid(child, nullptr, 0);
+    unlink(path.c_str());
+}
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "process_attach.hpp"
+
+namespace {
+bool contains(const std::vector<pid_t>& ids, pid_t id) {
+    return std::find(ids.begin(), ids.end(), id) != ids.end();
+}
+}
+
+TEST(ProcessAttachTest, ListsOwnThreads) {
+    std::atomic<pid_t> worker_tid{0};
+    std::atomic<bool> done{false};
+    std::thread worker([&]() {
+        worker_tid = gettid();
+        while (!done) {
+            std::this_thread::yield();
+        }
+    });
+    while (worker_tid == 0) {
+        std::this_thread::yield();
+    }
+
+    auto tasks = process_attach::list_tasks(getpid());
+    EXPECT_TRUE(contains(tasks, getpid()));
+    EXPECT_TRUE(contains(tasks, worker_tid.load()));
+
+    done = true;
+    worker.join();
+}
+
+TEST(ProcessAttachTest, FindsParentAndChildren) {
+    EXPECT_EQ(process_attach::get_parent_pid(getpid()), getppid());
+
+    pid_t child = fork();
+    if (child == 0) {
+        pause();
+        _exit(0);
+    }
+    EXPECT_EQ(process_attach::get_parent_pid(child), getpid());
+    EXPECT_TRUE(contains(process_attach::list_children(getpid()), child));
+
+    kill(child, SIGKILL);
+    waitpid(child, nullptr, 0);
+}
+
+TEST(ProcessAttachTest, MissingProcess) {
+    EXPECT_TRUE(process_attach::list_tasks(-1).empty());
+    EXPECT_EQ(process_attach::get_parent_pid(-1), 0);
+}
@@ -281,3 +281,19 @@ TEST_F(ProcessHierarchyTest, TestConcurrentFileAccess) {
         }
     }
 }
+
+TEST_F(ProcessHierarchyTest, TestUnsuccessfulOpenMarkedInTree) {
+    tree.insert_file("/test/opened.txt", 1, getpid(), "parent");
+    tree.insert_file("/test/missing.txt", 2, getpid(), "parent", ENOENT);
+
+    std::stringstream ss;
+    tree.generate_html(ss);
+    std::string output = ss.str();
+
+    // Only the unsuccessful open carries the marker class and its error text
+    const std::string marker = "tree-node file failed";
+    EXPECT_EQ(output.find(marker), output.rfind(marker));
+    EXPECT_TRUE(output.find(marker) != std::string::npos);
+    EXPECT_TRUE(output.find(strerror(ENOENT)) != std::string::npos);
+    EXPECT_TRUE(output.find("opened.txt") != std::string::npos);
+}
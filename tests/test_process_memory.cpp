@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/ptrace.h>
+#include <sys/mman.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cstring>
+#include <limits.h>
+#include "process_memory.hpp"
+
+class ProcessMemoryTest : public ::testing::TestWithParam<bool> {
+protected:
+    long page_size = sysconf(_SC_PAGESIZE);
+    char* region = nullptr;
+    pid_t child = -1;
+
+    void SetUp() override {
+        // Two pages, the second one unmapped so reads past the first fault
+        region = static_cast<char*>(mmap(nullptr, page_size * 2, PROT_READ | PROT_WRITE,
+                                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        ASSERT_NE(region, MAP_FAILED);
+        munmap(region + page_size, page_size);
+    }
+
+    void TearDown() override {
+        if (child > 0) {
+            kill(child, SIGKILL);
+            waitpid(child, nullptr, 0);
+        }
+        munmap(region, page_size);
+    }
+
+    // Fork a stopped tracee that shares the parent's memory layout
+    void start_tracee() {
+        child = fork();
+        if (child == 0) {
+            ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+            raise(SIGSTOP);
+            _exit(0);
+        }
+        int status;
+        waitpid(child, &status, 0);
+        ASSERT_TRUE(WIFSTOPPED(status));
+    }
+
+    unsigned long addr_of(const char* p) {
+        return reinterpret_cast<unsigned long>(p);
+    }
+};
+
+TEST_P(ProcessMemoryTest, ReadsShortString) {
+    std::strcpy(region, "/usr/include/stdio.h");
+    start_tracee();
+
+    process_memory::ProcessMemoryReader reader(GetParam());
+    std::string path;
+    ASSERT_TRUE(reader.read_string(child, addr_of(region), path));
+    EXPECT_EQ(path, "/usr/include/stdio.h");
+}
+
+TEST_P(ProcessMemoryTest, ReadsStringEndingAtUnmappedPage) {
+    // String terminator is the last byte before the unmapped page
+    const std::string expected = "/tmp/edge_of_page.txt";
+    char* start = region + page_size - expected.size() - 1;
+    std::strcpy(start, expected.c_str());
+    start_tracee();
+
+    process_memory::ProcessMemoryReader reader(GetParam());
+    std::string path;
+    ASSERT_TRUE(reader.read_string(child, addr_of(start), path));
+    EXPECT_EQ(path, expected);
+}
+
+TEST_P(ProcessMemoryTest, ReadsPathMaxLengthString) {
+    std::vector<char> long_path(PATH_MAX, 'a');
+    long_path[0] = '/';
+    long_path[PATH_MAX - 1] = '\0';
+    start_tracee();
+
+    process_memory::ProcessMemoryReader reader(GetParam());
+    std::string path;
+    ASSERT_TRUE(reader.read_string(child, addr_of(long_path.data()), path));
+    EXPECT_EQ(path.size(), static_cast<size_t>(PATH_MAX - 1));
+}
+
+TEST_P(ProcessMemoryTest, RejectsUnterminatedString) {
+    std::vector<char> too_long(PATH_MAX + 16, 'b');
+    too_long.back() = '\0';
+    start_tracee();
+
+    process_memory::ProcessMemoryReader reader(GetParam());
+    std::string path;
+    EXPECT_FALSE(reader.read_string(child, addr_of(too_long.data()), path));
+}
+
+TEST_P(ProcessMemoryTest, FailsOnUnmappedAddress) {
+    start_tracee();
+
+    process_memory::ProcessMemoryReader reader(GetParam());
+    std::string path;
+    EXPECT_FALSE(reader.read_string(child, addr_of(region + page_size), path));
+}
+
+INSTANTIATE_TEST_SUITE_P(Readers, ProcessMemoryTest, ::testing::Values(true, false),
+    [](const ::testing::TestParamInfo<bool>& info) {
+        return info.param ? "ProcessVmReadv" : "ProcMem";
+    });
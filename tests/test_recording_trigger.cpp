@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+#include "recording_trigger.hpp"
+
+using recording_trigger::matches;
+
+TEST(RecordingTriggerTest, GlobWithoutSlashMatchesLastComponent) {
+    EXPECT_TRUE(matches("config.h", "/src/build/config.h"));
+    EXPECT_TRUE(matches("*.h", "/src/include/util.h"));
+    EXPECT_TRUE(matches("cc1*", "cc1plus"));
+    EXPECT_FALSE(matches("*.h", "/src/include.h/util.c"));
+    EXPECT_FALSE(matches("config.h", "/src/config.hpp"));
+}
+
+TEST(RecordingTriggerTest, GlobWithSlashMatchesWholePath) {
+    EXPECT_TRUE(matches("/etc/*", "/etc/passwd"));
+    EXPECT_TRUE(matches("*/requests/*.json", "/srv/app/requests/42.json"));
+    // '*' crosses directories
+    EXPECT_TRUE(matches("/srv/*.json", "/srv/app/requests/42.json"));
+    EXPECT_FALSE(matches("/etc/*", "/usr/etc/passwd"));
+}
+
+TEST(RecordingTriggerTest, ArmedOnlyByStartTriggers) {
+    recording_trigger::Triggers triggers;
+    EXPECT_FALSE(triggers.armed());
+    EXPECT_FALSE(triggers.uses_opens());
+
+    triggers.stop_open.push_back("*.done");
+    EXPECT_FALSE(triggers.armed());
+    EXPECT_FALSE(triggers.watches_opens());
+    EXPECT_TRUE(triggers.uses_opens());
+    EXPECT_TRUE(triggers.stops_on_open("/tmp/build.done"));
+    EXPECT_FALSE(triggers.starts_on_open("/tmp/build.done"));
+
+    triggers.start_exec.push_back("cc1");
+    EXPECT_TRUE(triggers.armed());
+    EXPECT_FALSE(triggers.watches_opens());
+    EXPECT_TRUE(triggers.starts_on_exec("cc1"));
+    EXPECT_FALSE(triggers.starts_on_exec("cc1plus"));
+    EXPECT_FALSE(triggers.stops_on_exec("cc1"));
+
+    triggers.start_open.push_back("/srv/*");
+    EXPECT_TRUE(triggers.watches_opens());
+    EXPECT_TRUE(triggers.starts_on_open("/srv/index.html"));
+}
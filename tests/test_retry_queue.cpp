@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "retry_queue.hpp"
+
+namespace {
+using Queue = retry_queue::RetryQueue<int>;
+using std::chrono::milliseconds;
+}
+
+TEST(RetryQueueTest, BacksOffExponentially) {
+    Queue queue;
+    auto now = Queue::Clock::now();
+    queue.schedule(10, 1, 0, now);
+    queue.schedule(11, 2, 3, now);
+    EXPECT_EQ(queue.time_to_next(now), milliseconds(1));
+
+    std::vector<int> ran;
+    auto run = [&](pid_t, int task, int) { ran.push_back(task); };
+    EXPECT_EQ(queue.run_due(run, now), 0u);
+    EXPECT_EQ(queue.run_due(run, now + milliseconds(1)), 1u);
+    ASSERT_EQ(ran.size(), 1u);
+    EXPECT_EQ(ran[0], 1);
+
+    // The third retry waits 8 ms
+    EXPECT_EQ(queue.time_to_next(now + milliseconds(1)), milliseconds(7));
+    EXPECT_EQ(queue.run_due(run, now + milliseconds(8)), 1u);
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.total_scheduled(), 2u);
+}
+
+TEST(RetryQueueTest, KeepsOneRetryPerTid) {
+    Queue queue;
+    auto now = Queue::Clock::now();
+    queue.schedule(10, 1, 0, now);
+    queue.schedule(10, 2, 1, now);
+    EXPECT_EQ(queue.size(), 1u);
+
+    int seen_task = 0, seen_attempt = -1;
+    queue.run_due([&](pid_t, int task, int attempt) {
+        seen_task = task;
+        seen_attempt = attempt;
+    }, now + milliseconds(2));
+    EXPECT_EQ(seen_task, 2);
+    EXPECT_EQ(seen_attempt, 1);
+}
+
+TEST(RetryQueueTest, RunMayReschedule) {
+    Queue queue;
+    auto now = Queue::Clock::now();
+    queue.schedule(10, 1, 0, now);
+    queue.run_due([&](pid_t tid, int task, int attempt) {
+        queue.schedule(tid, task, attempt + 1, now);
+    }, now + milliseconds(1));
+    EXPECT_TRUE(queue.contains(10));
+    EXPECT_EQ(queue.time_to_next(now), milliseconds(2));
+}
+
+TEST(RetryQueueTest, CancelDropsRetry) {
+    Queue queue;
+    auto now = Queue::Clock::now();
+    queue.schedule(10, 1, 0, now);
+    queue.cancel(10);
+    EXPECT_FALSE(queue.contains(10));
+    EXPECT_EQ(queue.run_due([](pid_t, int, int) { ADD_FAILURE(); }, now + milliseconds(10)), 0u);
+    // Nothing queued: no deadline
+    EXPECT_EQ(queue.time_to_next(now), Queue::Clock::duration::max());
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+#include <algorithm>
+#include "seccomp_filter.hpp"
+#include "syscall_table.hpp"
+
+class SeccompFilterTest : public ::testing::Test {
+protected:
+    // Run fn in a forked child and return its exit code
+    template<typename Fn>
+    int run_in_child(Fn fn) {
+        pid_t child = fork();
+        if (child == 0) {
+            _exit(fn());
+        }
+        int status;
+        waitpid(child, &status, 0);
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+};
+
+TEST_F(SeccompFilterTest, FilterLayout) {
+    auto filter = seccomp_filter::build_filter({SYS_open, SYS_openat});
+
+    // Arch check (3), syscall number load (1), two instructions per syscall, default allow
+    ASSERT_EQ(filter.size(), 3u + 1u + 2u * 2u + 1u);
+    EXPECT_EQ(filter[1].k, static_cast<unsigned int>(AUDIT_ARCH_X86_64));
+    EXPECT_EQ(filter[4].k, static_cast<unsigned int>(SYS_open));
+    EXPECT_EQ(filter[5].k, static_cast<unsigned int>(SECCOMP_RET_TRACE));
+    EXPECT_EQ(filter[6].k, static_cast<unsigned int>(SYS_openat));
+    EXPECT_EQ(filter.back().k, static_cast<unsigned int>(SECCOMP_RET_ALLOW));
+}
+
+TEST_F(SeccompFilterTest, CompatFilterLayout) {
+    auto filter = seccomp_filter::build_compat_filter({SYS_open}, {syscall_table::nr_i386::open});
+
+    // Arch load, i386 check, i386 block (load, one syscall, allow), then
+    // the x86_64 program without its arch load
+    ASSERT_EQ(filter.size(), 2u + 4u + 2u + 1u + 2u + 1u);
+    EXPECT_EQ(filter[1].k, static_cast<unsigned int>(AUDIT_ARCH_I386));
+    EXPECT_EQ(filter[1].jf, 4u);
+    EXPECT_EQ(filter[3].k, static_cast<unsigned int>(syscall_table::nr_i386::open));
+    EXPECT_EQ(filter[6].k, static_cast<unsigned int>(AUDIT_ARCH_X86_64));
+    EXPECT_EQ(filter[9].k, static_cast<unsigned int>(SYS_open));
+}
+
+// An i386 block too long for a conditional jump's 8-bit offset is
+// jumped over unconditionally instead of into its middle
+TEST_F(SeccompFilterTest, LongCompatBlockIsJumpedOver) {
+    std::vector<long> compat(200);
+    for (size_t i = 0; i < compat.size(); i++) {
+        compat[i] = static_cast<long>(i);
+    }
+    auto filter = seccomp_filter::build_compat_filter({SYS_open}, compat);
+
+    EXPECT_EQ(filter[1].k, static_cast<unsigned int>(AUDIT_ARCH_I386));
+    EXPECT_EQ(filter[1].jt, 1u);
+    EXPECT_EQ(filter[1].jf, 0u);
+    ASSERT_EQ(filter[2].code, BPF_JMP | BPF_JA);
+    size_t target = 3 + filter[2].k;
+    ASSERT_LT(target, filter.size());
+    EXPECT_EQ(filter[target].k, static_cast<unsigned int>(AUDIT_ARCH_X86_64));
+    EXPECT_EQ(filter[3].code, BPF_LD | BPF_W | BPF_ABS);
+
+    // The filter still loads and runs: an i386-free process is unaffected
+    int result = run_in_child([&] {
+        if (!seccomp_filter::install_program(filter)) return 1;
+        return getppid() > 0 ? 0 : 2;
+    });
+    EXPECT_EQ(result, 0);
+}
+
+TEST_F(SeccompFilterTest, OversizedFilterIsRejected) {
+    std::vector<sock_filter> filter(BPF_MAXINSNS + 1, BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW));
+    errno = 0;
+    EXPECT_FALSE(seccomp_filter::install_program(filter));
+    EXPECT_EQ(errno, EINVAL);
+}
+
+TEST_F(SeccompFilterTest, ArgumentTestLayout) {
+    auto filter = seccomp_filter::build_filter({SYS_mmap, SYS_openat}, SECCOMP_RET_TRACE,
+                                               {{SYS_mmap, 3, MAP_SHARED}});
+
+    // mmap: compare, argument load, bit test, trace, allow
+    ASSERT_EQ(filter.size(), 3u + 1u + 5u + 2u + 1u);
+    EXPECT_EQ(filter[4].k, static_cast<unsigned int>(SYS_mmap));
+    EXPECT_EQ(filter[4].jf, 4u);
+    EXPECT_EQ(filter[5].k, offsetof(struct seccomp_data, args) + 3 * sizeof(__u64));
+    EXPECT_EQ(filter[6].k, static_cast<unsigned int>(MAP_SHARED));
+    EXPECT_EQ(filter[9].k, static_cast<unsigned int>(SYS_openat));
+}
+
+TEST_F(SeccompFilterTest, ArgumentTestSelectsCalls) {
+    // dup(fd) is only trapped for descriptors with bit 8 set
+    int code = run_in_child([]() {
+        if (!seccomp_filter::install_filter({SYS_dup}, {}, {{SYS_dup, 0, 0x100}})) return 1;
+        if (syscall(SYS_dup, 0x100 | 5) != -1 || errno != ENOSYS) return 2;
+        if (syscall(SYS_dup, 0x80 | 5) != -1 || errno != EBADF) return 3;
+        return 0;
+    });
+    EXPECT_EQ(code, 0);
+}
+
+TEST_F(SeccompFilterTest, DefaultListCoversFileSyscalls) {
+    const auto traced = syscall_table::traced_syscalls(syscall_table::default_categories);
+    for (long nr : {SYS_open, SYS_openat, SYS_execve}) {
+        EXPECT_NE(std::find(traced.begin(), traced.end(), nr), traced.end())
+            << "Syscall " << nr << " should be traced";
+    }
+    EXPECT_EQ(std::find(traced.begin(), traced.end(), SYS_read), traced.end());
+    EXPECT_EQ(std::find(traced.begin(), traced.end(), SYS_write), traced.end());
+
+    // Creation and exit are followed through PTRACE_EVENT_* stops and waitpid
+    EXPECT_EQ(std::find(traced.begin(), traced.end(), SYS_clone), traced.end());
+    EXPECT_EQ(std::find(traced.begin(), traced.end(), SYS_exit_group), traced.end());
+}
+
+TEST_F(SeccompFilterTest, OnlyListedSyscallsAreTrapped) {
+    // Without a tracer, SECCOMP_RET_TRACE makes the syscall fail with ENOSYS
+    int code = run_in_child([]() {
+        if (!seccomp_filter::install_filter({SYS_getppid})) return 1;
+        if (syscall(SYS_getppid) != -1 || errno != ENOSYS) return 2;
+        if (syscall(SYS_getpid) <= 0) return 3;
+        return 0;
+    });
+    EXPECT_EQ(code, 0);
+}
+
+// int $0x80 from 64-bit code enters the i386 ABI
+TEST_F(SeccompFilterTest, CompatSyscallsAreTrapped) {
+    const long i386_getppid = 64;
+    const long i386_getpid = 20;
+    int code = run_in_child([=]() {
+        if (!seccomp_filter::install_filter({SYS_getppid}, {i386_getppid})) return 1;
+        long ret;
+        __asm__ volatile("int $0x80" : "=a"(ret) : "a"(i386_getppid) : "memory");
+        if (ret != -ENOSYS) return 2;
+        __asm__ volatile("int $0x80" : "=a"(ret) : "a"(i386_getpid) : "memory");
+        if (ret != getpid()) return 3;
+        if (syscall(SYS_getppid) != -1 || errno != ENOSYS) return 4;
+        return 0;
+    });
+    EXPECT_EQ(code, 0);
+}
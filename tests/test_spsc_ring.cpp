@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include "spsc_ring.hpp"
+
+TEST(SpscRingTest, RejectsPushWhenFull) {
+    spsc_ring::SpscRing<int> ring(3);
+    ASSERT_EQ(ring.capacity(), 4u);
+
+    for (int i = 0; i < 4; i++) {
+        int item = i;
+        EXPECT_TRUE(ring.try_push(std::move(item)));
+    }
+    int overflow = 4;
+    EXPECT_FALSE(ring.try_push(std::move(overflow)));
+
+    int item;
+    ASSERT_TRUE(ring.try_pop(item));
+    EXPECT_EQ(item, 0);
+    overflow = 4;
+    EXPECT_TRUE(ring.try_push(std::move(overflow)));
+}
+
+TEST(SpscRingTest, PopFromEmptyRing) {
+    spsc_ring::SpscRing<std::string> ring(8);
+    std::string item;
+    EXPECT_FALSE(ring.try_pop(item));
+}
+
+TEST(SpscRingTest, PreservesOrderAcrossThreads) {
+    const int count = 100000;
+    spsc_ring::SpscRing<std::string> ring(64);
+
+    std::thread producer([&]() {
+        for (int i = 0; i < count; i++) {
+            std::string item = std::to_string(i);
+            while (!ring.try_push(std::move(item))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int expected = 0;
+    std::string item;
+    while (expected < count) {
+        if (ring.try_pop(item)) {
+            ASSERT_EQ(item, std::to_string(expected));
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    EXPECT_FALSE(ring.try_pop(item));
+}
@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "syscall_decoder.hpp"
+#include "process_memory.hpp"
+
+class SyscallDecoderTest : public ::testing::Test {
+protected:
+    pid_t child = -1;
+
+    void SetUp() override {
+        syscall_decoder::syscall_info_supported = true;
+        child = fork();
+        if (child == 0) {
+            ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+            raise(SIGSTOP);
+            syscall(SYS_openat, AT_FDCWD, "/nonexistent/filetrace_decoder", O_RDONLY);
+            _exit(0);
+        }
+        int status;
+        waitpid(child, &status, 0);
+        ASSERT_TRUE(WIFSTOPPED(status));
+        ASSERT_EQ(ptrace(PTRACE_SETOPTIONS, child, 0, PTRACE_O_TRACESYSGOOD), 0);
+    }
+
+    void TearDown() override {
+        syscall_decoder::syscall_info_supported = true;
+        kill(child, SIGKILL);
+        waitpid(child, nullptr, 0);
+    }
+
+    // Advance the tracee to its next syscall stop
+    void next_syscall_stop() {
+        int status;
+        ASSERT_EQ(ptrace(PTRACE_SYSCALL, child, nullptr, nullptr), 0);
+        ASSERT_EQ(waitpid(child, &status, 0), child);
+        ASSERT_TRUE(WIFSTOPPED(status));
+        ASSERT_EQ(WSTOPSIG(status), SIGTRAP | 0x80);
+    }
+
+    // Walk syscall stops, tracking entry/exit per tid, until the openat entry
+    void run_to_openat_entry(syscall_decoder::SyscallStop& stop, bool& in_syscall) {
+        in_syscall = false;
+        for (int i = 0; i < 100; i++) {
+            next_syscall_stop();
+            ASSERT_TRUE(syscall_decoder::fetch(child, in_syscall, stop));
+            in_syscall = stop.is_entry;
+            if (stop.is_entry && stop.nr == SYS_openat) {
+                return;
+            }
+        }
+        FAIL() << "openat entry not reached";
+    }
+};
+
+TEST_F(SyscallDecoderTest, DecodesEntryArgumentsAndExitResult) {
+    syscall_decoder::SyscallStop stop;
+    bool in_syscall;
+    run_to_openat_entry(stop, in_syscall);
+    EXPECT_EQ(static_cast<int>(stop.args[0]), AT_FDCWD);
+    EXPECT_EQ(static_cast<int>(stop.args[2]), O_RDONLY);
+
+    next_syscall_stop();
+    syscall_decoder::SyscallStop exit_stop;
+    ASSERT_TRUE(syscall_decoder::fetch(child, in_syscall, exit_stop));
+    EXPECT_FALSE(exit_stop.is_entry);
+    EXPECT_TRUE(exit_stop.is_error);
+    EXPECT_EQ(exit_stop.ret, -ENOENT);
+}
+
+TEST_F(SyscallDecoderTest, RegisterFallbackUsesTracerState) {
+    syscall_decoder::syscall_info_supported = false;
+
+    syscall_decoder::SyscallStop stop;
+    bool in_syscall;
+    run_to_openat_entry(stop, in_syscall);
+    EXPECT_EQ(static_cast<int>(stop.args[0]), AT_FDCWD);
+
+    next_syscall_stop();
+    syscall_decoder::SyscallStop exit_stop;
+    ASSERT_TRUE(syscall_decoder::fetch(child, in_syscall, exit_stop));
+    EXPECT_FALSE(exit_stop.is_entry);
+    EXPECT_EQ(exit_stop.ret, -ENOENT);
+}
+
+// A 32-bit tracee's syscalls are decoded with i386 numbers and argument
+// registers, through PTRACE_GET_SYSCALL_INFO and the register fallback
+TEST(SyscallDecoderCompatTest, DecodesIa32Tracee) {
+#ifndef COMPAT_HELPER
+    GTEST_SKIP() << "no -m32 toolchain to build the 32-bit helper";
+#else
+    for (bool use_syscall_info : {true, false}) {
+        syscall_decoder::syscall_info_supported = use_syscall_info;
+        pid_t child = fork();
+        if (child == 0) {
+            ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+            raise(SIGSTOP);
+            execl(COMPAT_HELPER, COMPAT_HELPER, nullptr);
+            _exit(127);
+        }
+        int status;
+        waitpid(child, &status, 0);
+        ASSERT_TRUE(WIFSTOPPED(status));
+        ASSERT_EQ(ptrace(PTRACE_SETOPTIONS, child, 0, PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACEEXEC), 0);
+
+        process_memory::ProcessMemoryReader reader;
+        std::vector<std::string> opens;
+        std::vector<long> results;
+        bool in_syscall = false;
+        bool exec_seen = false;
+        while (true) {
+            ASSERT_EQ(ptrace(PTRACE_SYSCALL, child, nullptr, nullptr), 0);
+            ASSERT_EQ(waitpid(child, &status, 0), child);
+            if (WIFEXITED(status)) {
+                EXPECT_EQ(WEXITSTATUS(status), 0);
+                break;
+            }
+            ASSERT_TRUE(WIFSTOPPED(status));
+            if (status >> 8 == (SIGTRAP | (PTRACE_EVENT_EXEC << 8))) {
+                exec_seen = true;
+                continue;
+            }
+            if (WSTOPSIG(status) != (SIGTRAP | 0x80)) {
+                continue;
+            }
+            syscall_decoder::SyscallStop stop;
+            ASSERT_TRUE(syscall_decoder::fetch(child, in_syscall, stop));
+            in_syscall = stop.is_entry;
+            // The execve entry and exit belong to the 64-bit image
+            if (!exec_seen) {
+                continue;
+            }
+            if (stop.is_entry) {
+                EXPECT_EQ(stop.abi, syscall_table::I386);
+                const auto& descriptor = syscall_table::describe(stop.abi, stop.nr);
+                if (descriptor.category == syscall_table::OPEN) {
+                    std::string path;
+                    ASSERT_TRUE(reader.read_string(child, stop.args[descriptor.paths[0].path], path));
+                    opens.push_back(std::string(descriptor.name) + " " + path);
+                }
+            } else if (opens.size() > results.size()) {
+                results.push_back(stop.ret);
+            }
+        }
+
+        ASSERT_EQ(opens.size(), 2u) << "syscall info: " << use_syscall_info;
+        EXPECT_EQ(opens[0], "open /dev/null");
+        EXPECT_EQ(opens[1], "openat filetrace_compat_missing");
+        ASSERT_EQ(results.size(), 2u);
+        EXPECT_GE(results[0], 0);
+        EXPECT_EQ(results[1], -ENOENT);
+    }
+    syscall_decoder::syscall_info_supported = true;
+#endif
+}
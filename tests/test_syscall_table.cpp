@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <string>
+#include "syscall_table.hpp"
+
+namespace {
+bool contains(const std::vector<long>& syscalls, long nr) {
+    return std::find(syscalls.begin(), syscalls.end(), nr) != syscalls.end();
+}
+}
+
+// Dispatch is resolved at compile time
+static_assert(syscall_table::tables[syscall_table::X86_64][SYS_openat].handling == syscall_table::Handling::PATH,
+              "openat is a path syscall");
+static_assert(syscall_table::tables[syscall_table::X86_64][SYS_read].handling == syscall_table::Handling::IGNORE,
+              "read is not traced");
+static_assert(syscall_table::tables[syscall_table::I386][syscall_table::nr_i386::openat].paths[0].path == 1,
+              "i386 openat takes its path second");
+
+TEST(SyscallTableTest, DescribesPathArguments) {
+    const auto& openat = syscall_table::describe(syscall_table::X86_64, SYS_openat);
+    EXPECT_STREQ(openat.name, "openat");
+    EXPECT_EQ(openat.category, syscall_table::OPEN);
+    EXPECT_EQ(openat.paths[0].path, 1);
+    EXPECT_EQ(openat.paths[0].dirfd, 0);
+    EXPECT_EQ(openat.paths[1].path, -1);
+    EXPECT_EQ(openat.flags_arg, 2);
+
+    const auto& renameat2 = syscall_table::describe(syscall_table::X86_64, SYS_renameat2);
+    EXPECT_EQ(renameat2.category, syscall_table::RENAME);
+    EXPECT_EQ(renameat2.paths[1].path, 3);
+    EXPECT_EQ(renameat2.paths[1].dirfd, 2);
+
+    const auto& stat = syscall_table::describe(syscall_table::X86_64, SYS_stat);
+    EXPECT_EQ(stat.paths[0].path, 0);
+    EXPECT_EQ(stat.paths[0].dirfd, -1);
+
+    // The link is the path of a symlink, not its target
+    EXPECT_EQ(syscall_table::describe(syscall_table::X86_64, SYS_symlinkat).paths[0].path, 2);
+}
+
+TEST(SyscallTableTest, I386TableUsesI386Numbers) {
+    // i386 open is x86_64 fstat
+    EXPECT_STREQ(syscall_table::describe(syscall_table::I386, 5).name, "open");
+    EXPECT_EQ(syscall_table::describe(syscall_table::X86_64, 5).handling, syscall_table::Handling::IGNORE);
+    EXPECT_STREQ(syscall_table::describe(syscall_table::I386, syscall_table::nr_i386::fstatat64).name, "newfstatat");
+
+    // Syscalls only the i386 ABI has
+    EXPECT_EQ(syscall_table::describe(syscall_table::I386, syscall_table::nr_i386::stat64).category,
+              syscall_table::STAT);
+    EXPECT_EQ(syscall_table::describe(syscall_table::I386, syscall_table::nr_i386::fcntl64).handling,
+              syscall_table::Handling::FCNTL);
+
+    auto compat = syscall_table::traced_syscalls(syscall_table::OPEN, syscall_table::I386);
+    EXPECT_TRUE(contains(compat, syscall_table::nr_i386::openat));
+    EXPECT_TRUE(contains(compat, syscall_table::nr_i386::dup3));
+    EXPECT_FALSE(contains(compat, SYS_openat));
+}
+
+TEST(SyscallTableTest, OutOfRangeNumbersAreIgnored) {
+    EXPECT_EQ(syscall_table::describe(syscall_table::X86_64, -1).handling, syscall_table::Handling::IGNORE);
+    EXPECT_EQ(syscall_table::describe(syscall_table::I386, 100000).handling, syscall_table::Handling::IGNORE);
+}
+
+TEST(SyscallTableTest, TracedSyscallsFollowCategories) {
+    auto opens = syscall_table::traced_syscalls(syscall_table::OPEN);
+    EXPECT_TRUE(contains(opens, SYS_openat2));
+    EXPECT_TRUE(contains(opens, SYS_creat));
+    EXPECT_FALSE(contains(opens, SYS_newfstatat));
+    // State-keeping syscalls are traced whatever is recorded
+    EXPECT_TRUE(contains(opens, SYS_close));
+    EXPECT_TRUE(contains(opens, SYS_chdir));
+
+    // Rings are followed whenever an operation io_uring can submit is recorded
+    EXPECT_TRUE(contains(opens, SYS_io_uring_enter));
+    EXPECT_TRUE(contains(opens, SYS_mmap));
+    EXPECT_EQ(syscall_table::describe(syscall_table::X86_64, SYS_mmap).filter_arg, 3);
+    auto execs = syscall_table::traced_syscalls(syscall_table::EXEC);
+    EXPECT_FALSE(contains(execs, SYS_io_uring_enter));
+    EXPECT_FALSE(contains(execs, SYS_mmap));
+
+    auto stats = syscall_table::traced_syscalls(syscall_table::STAT);
+    EXPECT_TRUE(contains(stats, SYS_statx));
+    EXPECT_FALSE(contains(stats, SYS_openat));
+
+    auto all = syscall_table::traced_syscalls(syscall_table::all_categories);
+    for (long nr : {SYS_faccessat2, SYS_readlinkat, SYS_unlinkat, SYS_mkdirat, SYS_linkat, SYS_truncate,
+                    SYS_execveat, SYS_name_to_handle_at}) {
+        EXPECT_TRUE(contains(all, nr)) << "Syscall " << nr << " should be traced";
+    }
+
+    auto notified = syscall_table::syscalls_in(syscall_table::OPEN);
+    EXPECT_TRUE(contains(notified, SYS_open));
+    EXPECT_FALSE(contains(notified, SYS_close));
+}
+
+TEST(SyscallTableTest, ParsesCategories) {
+    uint32_t categories;
+    std::string error;
+    ASSERT_TRUE(syscall_table::parse_categories("open,stat,exec", categories, error));
+    EXPECT_EQ(categories, syscall_table::OPEN | syscall_table::STAT | syscall_table::EXEC);
+
+    ASSERT_TRUE(syscall_table::parse_categories("all", categories, error));
+    EXPECT_EQ(categories, syscall_table::all_categories);
+
+    EXPECT_FALSE(syscall_table::parse_categories("open,bogus", categories, error));
+    EXPECT_NE(error.find("bogus"), std::string::npos);
+    EXPECT_FALSE(syscall_table::parse_categories("", categories, error));
+}
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+// Run filetrace on args and return what it logged
+std::string run_filetrace(const std::string& args) {
+    std::string output;
+#ifdef FILETRACE_BIN
+    FILE* pipe = popen((std::string(FILETRACE_BIN) + " " + args + " 2>&1").c_str(), "r");
+    if (pipe == nullptr) {
+        return output;
+    }
+    char buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, length);
+    }
+    pclose(pipe);
+#else
+    (void)args;
+#endif
+    return output;
+}
+
+// State letter of /proc/<pid>/stat, or 0 if it cannot be read
+char process_state(pid_t pid) {
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    std::getline(stat, line);
+    size_t comm_end = line.rfind(')');
+    return comm_end == std::string::npos || comm_end + 2 >= line.size() ? 0 : line[comm_end + 2];
+}
+
+bool recorded(const std::string& log, const std::filesystem::path& path) {
+    return log.find("Adding file operation: " + path.string() + " ") != std::string::npos;
+}
+}
+
+// Descriptors and working directory changed while recording was paused
+// are not taken from what was followed before the pause
+TEST(TraceSessionTest, ResolvesAgainstChangesMadeWhilePaused) {
+#if !defined(FILETRACE_BIN) || !defined(SESSION_HELPER)
+    GTEST_SKIP() << "filetrace and the session helper are not built";
+#else
+    auto dir = std::filesystem::canonical(std::filesystem::temp_directory_path()) / "filetrace_session_test";
+    for (const char* mode : {"", "--seccomp"}) {
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir / "a");
+        std::filesystem::create_directories(dir / "b");
+        auto fifo = dir / "control";
+        auto report = dir / "report.html";
+
+        std::string log = run_filetrace(std::string(mode) + " -a -o " + report.string() + " --control-fifo " +
+                                        fifo.string() + " -- " + SESSION_HELPER + " " + fifo.string() + " " +
+                                        dir.string());
+        ASSERT_NE(log.find("Recording paused"), std::string::npos) << mode << "\n" << log;
+        EXPECT_TRUE(recorded(log, dir / "a" / "first")) << mode;
+        EXPECT_TRUE(recorded(log, dir / "a" / "first_at")) << mode;
+        EXPECT_TRUE(recorded(log, dir / "b" / "rel")) << mode;
+        EXPECT_TRUE(recorded(log, dir / "b" / "at")) << mode;
+        EXPECT_FALSE(recorded(log, dir / "a" / "rel")) << mode;
+        EXPECT_FALSE(recorded(log, dir / "a" / "at")) << mode;
+    }
+    std::filesystem::remove_all(dir);
+#endif
+}
+
+// A start-on-open glob is matched against the open resolved from the
+// working directory the tracee has now, not the one it had when one of
+// its opens was last checked
+TEST(TraceSessionTest, StartTriggerFollowsDirectoryChanges) {
+#ifndef FILETRACE_BIN
+    GTEST_SKIP() << "filetrace is not built";
+#else
+    auto dir = std::filesystem::canonical(std::filesystem::temp_directory_path()) / "filetrace_trigger_test";
+    for (const char* mode : {"", "--seccomp"}) {
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir / "a");
+        std::filesystem::create_directories(dir / "b");
+        // A failed redirection would end the shell
+        std::ofstream(dir / "a" / "seen");
+        std::ofstream(dir / "b" / "target");
+        std::string script = "cd " + (dir / "a").string() + " && : < seen; cd " + (dir / "b").string() +
+                             " && : < target";
+        std::string log = run_filetrace(std::string(mode) + " -a -o " + (dir / "report.html").string() +
+                                        " --start-on-open='" + (dir / "b").string() + "/*' -- sh -c '" + script +
+                                        "'");
+        EXPECT_NE(log.find("Start trigger"), std::string::npos) << mode << "\n" << log;
+        EXPECT_TRUE(recorded(log, dir / "b" / "target")) << mode;
+    }
+    std::filesystem::remove_all(dir);
+#endif
+}
+
+// Failed opens dropped without --show-failed take no sequence number, so
+// the report numbers what it shows without gaps
+TEST(TraceSessionTest, DroppedFailuresLeaveNoSequenceGaps) {
+#ifndef FILETRACE_BIN
+    GTEST_SKIP() << "filetrace is not built";
+#else
+    auto dir = std::filesystem::canonical(std::filesystem::temp_directory_path()) / "filetrace_sequence_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    std::ofstream(dir / "present");
+    std::string script = "cat " + (dir / "missing").string() + " 2>/dev/null; : < " + (dir / "present").string();
+    std::string log = run_filetrace("-a -o " + (dir / "report.html").string() + " -- sh -c '" + script + "'");
+    EXPECT_NE(log.find("Skipping failed operation: " + (dir / "missing").string()), std::string::npos) << log;
+    EXPECT_TRUE(recorded(log, dir / "present"));
+
+    const std::string adding = "Adding file operation: ";
+    size_t expected = 0;
+    for (size_t pos = log.find(adding); pos != std::string::npos; pos = log.find(adding, pos + 1)) {
+        size_t line_end = log.find('\n', pos);
+        std::string line = log.substr(pos, line_end - pos);
+        EXPECT_NE(line.find(" [" + std::to_string(++expected) + "] "), std::string::npos) << line;
+    }
+    EXPECT_GT(expected, 0u);
+    EXPECT_NE(log.find("Generating HTML output with " + std::to_string(expected) + " operations"),
+              std::string::npos) << log;
+    std::filesystem::remove_all(dir);
+#endif
+}
+
+// A SIGSTOP sent to a process attached with --pid stops it until SIGCONT
+// instead of being swallowed by the tracer
+TEST(TraceSessionTest, AttachedProcessStaysStoppedUntilContinued) {
+#ifndef FILETRACE_BIN
+    GTEST_SKIP() << "filetrace is not built";
+#else
+    pid_t child = fork();
+    ASSERT_NE(child, -1);
+    if (child == 0) {
+        execlp("sleep", "sleep", "10", nullptr);
+        _exit(127);
+    }
+    std::string log;
+    std::thread tracer([&] {
+        log = run_filetrace("-o /dev/null --duration 2 --pid " + std::to_string(child));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    kill(child, SIGSTOP);
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    char stopped = process_state(child);
+    kill(child, SIGCONT);
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    char continued = process_state(child);
+    tracer.join();
+    kill(child, SIGKILL);
+    waitpid(child, nullptr, 0);
+
+    ASSERT_NE(log.find("Attached to"), std::string::npos) << log;
+    EXPECT_TRUE(stopped == 'T' || stopped == 't') << "state " << stopped;
+    EXPECT_EQ(continued, 'S');
+#endif
+}
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+#include "tracer_events.hpp"
+
+namespace {
+// SIGCHLD is only queued for the signalfd while it is blocked
+class TracerEventsTest : public ::testing::Test {
+protected:
+    sigset_t previous;
+
+    void SetUp() override {
+        sigset_t sigchld;
+        sigemptyset(&sigchld);
+        sigaddset(&sigchld, SIGCHLD);
+        pthread_sigmask(SIG_BLOCK, &sigchld, &previous);
+    }
+
+    void TearDown() override {
+        // Drop a SIGCHLD still pending before restoring the mask
+        sigset_t sigchld;
+        sigemptyset(&sigchld);
+        sigaddset(&sigchld, SIGCHLD);
+        struct timespec zero = {0, 0};
+        sigtimedwait(&sigchld, nullptr, &zero);
+        pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    }
+};
+}
+
+TEST_F(TracerEventsTest, WakesForChildExit) {
+    tracer_events::TracerEvents events;
+    ASSERT_TRUE(events.init(std::chrono::seconds(60))) << events.get_last_error();
+
+    pid_t child = fork();
+    ASSERT_NE(child, -1);
+    if (child == 0) {
+        _exit(0);
+    }
+    std::vector<pid_t> exited;
+    uint32_t woke = events.wait(exited);
+    EXPECT_TRUE(woke & tracer_events::CHILD);
+    EXPECT_EQ(waitpid(child, nullptr, 0), child);
+
+    // Drained: nothing is left to report
+    EXPECT_EQ(events.wait(exited, false), tracer_events::NONE);
+}
+
+TEST_F(TracerEventsTest, LeavesSigchldToOtherTracers) {
+    tracer_events::TracerEvents events;
+    ASSERT_TRUE(events.init(std::chrono::seconds(60), false)) << events.get_last_error();
+
+    pid_t child = fork();
+    ASSERT_NE(child, -1);
+    if (child == 0) {
+        _exit(0);
+    }
+    EXPECT_EQ(waitpid(child, nullptr, 0), child);
+    std::vector<pid_t> exited;
+    events.set_deadline(std::chrono::milliseconds(1));
+    EXPECT_EQ(events.wait(exited), static_cast<uint32_t>(tracer_events::DEADLINE));
+}
+
+TEST_F(TracerEventsTest, DeadlineAndPeriodicTimer) {
+    tracer_events::TracerEvents events;
+    ASSERT_TRUE(events.init(std::chrono::milliseconds(20))) << events.get_last_error();
+    std::vector<pid_t> exited;
+
+    events.set_deadline(std::chrono::milliseconds(1));
+    auto start = std::chrono::steady_clock::now();
+    uint32_t woke = events.wait(exited);
+    EXPECT_TRUE(woke & tracer_events::DEADLINE);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+
+    // The deadline fires once; the periodic timer keeps firing
+    woke = events.wait(exited);
+    EXPECT_EQ(woke, static_cast<uint32_t>(tracer_events::PERIODIC));
+    woke = events.wait(exited);
+    EXPECT_EQ(woke, static_cast<uint32_t>(tracer_events::PERIODIC));
+
+    events.set_deadline(std::chrono::milliseconds(1));
+    events.clear_deadline();
+    EXPECT_EQ(events.wait(exited), static_cast<uint32_t>(tracer_events::PERIODIC));
+}
+
+TEST_F(TracerEventsTest, WakesForControlInput) {
+    tracer_events::TracerEvents events;
+    ASSERT_TRUE(events.init(std::chrono::seconds(60))) << events.get_last_error();
+
+    int control[2];
+    ASSERT_EQ(pipe(control), 0);
+    ASSERT_TRUE(events.watch_control(control[0])) << events.get_last_error();
+    std::vector<pid_t> exited;
+    EXPECT_EQ(events.wait(exited, false), tracer_events::NONE);
+
+    ASSERT_EQ(write(control[1], "pass\n", 5), 5);
+    EXPECT_EQ(events.wait(exited), static_cast<uint32_t>(tracer_events::CONTROL));
+    close(control[0]);
+    close(control[1]);
+}
+
+TEST_F(TracerEventsTest, ReportsWatchedProcessExit) {
+    tracer_events::TracerEvents events;
+    ASSERT_TRUE(events.init(std::chrono::seconds(60))) << events.get_last_error();
+
+    int go[2];
+    ASSERT_EQ(pipe(go), 0);
+    pid_t child = fork();
+    ASSERT_NE(child, -1);
+    if (child == 0) {
+        char byte;
+        close(go[1]);
+        read(go[0], &byte, 1);
+        _exit(0);
+    }
+    close(go[0]);
+    if (!events.watch_process(child)) {
+        close(go[1]);
+        waitpid(child, nullptr, 0);
+        GTEST_SKIP() << "pidfd unavailable: " << events.get_last_error();
+    }
+    EXPECT_TRUE(events.watch_process(child));  // Already watched
+    EXPECT_EQ(events.watched_processes(), 1u);
+
+    std::vector<pid_t> exited;
+    EXPECT_EQ(events.wait(exited, false), tracer_events::NONE);
+    close(go[1]);
+
+    // SIGCHLD and the pidfd may become ready in separate waits
+    uint32_t woke = tracer_events::NONE;
+    while (!(woke & tracer_events::EXITED)) {
+        woke = events.wait(exited);
+    }
+    ASSERT_EQ(exited.size(), 1u);
+    EXPECT_EQ(exited[0], child);
+    EXPECT_EQ(events.watched_processes(), 0u);
+    EXPECT_EQ(waitpid(child, nullptr, 0), child);
+}